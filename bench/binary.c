@@ -0,0 +1,73 @@
+/*
+    Startup benchmark: getting a document ready to query by parsing its
+    text vs mapping its binary form
+
+    Usage: ./binary <file> [binary file]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/binary.h"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Touches every node, as a full iteration would
+static size_t walk(const JSONBinaryNode *node) {
+    size_t count = 1;
+    if (node->type == JSON_BINARY_ARRAY) {
+        for_each_binary_node(node, child) count += walk(child);
+    } else if (node->type == JSON_BINARY_OBJECT) {
+        for_each_binary_pair(node, key, value) count += walk(value);
+    }
+    return count;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <file> [binary file]\n", argv[0]);
+        return 1;
+    }
+    const char *binary = argc > 2 ? argv[2] : "binary.bin";
+
+    Arena a = {0};
+    JSONError error;
+
+    double start = now();
+    JSONElement root = json_parse_file(&a, argv[1], &error);
+    if (error.code) return 1;
+    double parse = now() - start;
+
+    start = now();
+    if (json_binary_save(root, binary, &error)) return 1;
+    double save = now() - start;
+    arena_free(&a);
+
+    JSONBinary doc;
+    start = now();
+    if (json_binary_load(&doc, binary, &error)) return 1;
+    const JSONBinaryNode *first = json_binary_at(json_binary_root(&doc), 0);
+    double load = now() - start;
+
+    start = now();
+    size_t nodes = walk(json_binary_root(&doc));
+    double iterate = now() - start;
+
+    printf("%zu nodes, %.1f MiB binary\n", nodes,
+           doc.header->size / (double)(1 << 20));
+    printf("json_parse_file        %10.3f ms\n", parse * 1e3);
+    printf("json_binary_save       %10.3f ms\n", save * 1e3);
+    printf("json_binary_load       %10.3f ms  %.0fx faster%s\n", load * 1e3,
+           parse / load, first ? "" : " (root isn't an array)");
+    printf("iterate mapped nodes   %10.3f ms\n", iterate * 1e3);
+
+    json_binary_close(&doc);
+    remove(binary);
+    return 0;
+}
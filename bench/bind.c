@@ -0,0 +1,207 @@
+/*
+    Struct binding benchmark: filling an event struct from each of a batch
+    of messages with json_parse_buffer and json_object_get vs json_decode,
+    and writing them back with json_encode
+
+    Usage: ./bind [events] [rounds]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/bind.h"
+#include "../include/object.h"
+
+typedef struct {
+    double lat;
+    double lon;
+} Geo;
+
+typedef struct {
+    JSONString id;
+    JSONString ip;
+    int port;
+    Geo geo;
+} Client;
+
+typedef struct {
+    long long ts;
+    JSONString type;
+    JSONString user;
+    int status;
+    double latency;
+    bool cached;
+    Client client;
+    JSONString *tags;
+    size_t tag_count;
+} Event;
+
+static const JSONField geo_fields[] = {
+    JSON_BIND_FIELD(Geo, lat, JSON_FIELD_DOUBLE),
+    JSON_BIND_FIELD(Geo, lon, JSON_FIELD_DOUBLE),
+};
+static JSONStruct geo_struct = JSON_BIND(Geo, geo_fields);
+
+static const JSONField client_fields[] = {
+    JSON_BIND_FIELD(Client, id, JSON_FIELD_STRING),
+    JSON_BIND_FIELD(Client, ip, JSON_FIELD_STRING),
+    JSON_BIND_FIELD(Client, port, JSON_FIELD_INT),
+    JSON_BIND_STRUCT(Client, geo, geo_struct),
+};
+static JSONStruct client_struct = JSON_BIND(Client, client_fields);
+
+static const JSONField event_fields[] = {
+    JSON_BIND_FIELD(Event, ts, JSON_FIELD_INT64),
+    JSON_BIND_FIELD(Event, type, JSON_FIELD_STRING),
+    JSON_BIND_FIELD(Event, user, JSON_FIELD_STRING),
+    JSON_BIND_FIELD(Event, status, JSON_FIELD_INT),
+    JSON_BIND_FIELD(Event, latency, JSON_FIELD_DOUBLE),
+    JSON_BIND_FIELD(Event, cached, JSON_FIELD_BOOL),
+    JSON_BIND_STRUCT(Event, client, client_struct),
+    JSON_BIND_ARRAY(Event, tags, tag_count, JSON_FIELD_STRING, NULL),
+};
+static JSONStruct event_struct = JSON_BIND(Event, event_fields);
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// One event per line, with a field the struct doesn't bind
+static char *generate(size_t events, size_t *length) {
+    static const char *types[] = {"click", "view", "purchase", "login"};
+    char *content = malloc(events * 400);
+    size_t n = 0;
+
+    for (size_t i = 0; i < events; i++) {
+        n += sprintf(
+            content + n,
+            "{\"ts\": %zu, \"type\": \"%s\", \"user\": \"user-%zu\", "
+            "\"status\": %d, \"latency\": %zu.%02zu, \"cached\": %s, "
+            "\"client\": {\"id\": \"c%06zu\", \"ip\": \"10.0.%zu.%zu\", "
+            "\"port\": %zu, \"geo\": {\"lat\": %zu.25, \"lon\": -%zu.5}}, "
+            "\"tags\": [\"web\", \"beta\", \"region-%zu\"], "
+            "\"debug\": {\"trace\": [%zu, %zu], \"note\": \"\\\"none\\\"\"}}\n",
+            1700000000000 + i, types[i % 4], i % 997, i % 7 ? 200 : 404,
+            i % 300, i % 100, i % 3 ? "false" : "true", i, i % 256, i % 100,
+            1024 + i % 60000, i % 90, i % 180, i % 8, i, i * 2);
+    }
+
+    *length = n;
+    return content;
+}
+
+static void walk(Arena *a, JSONObject *object, Event *e) {
+    long long value;
+    memset(e, 0, sizeof(*e));
+
+    json_object_get_int(a, object, "ts", &e->ts);
+    json_object_get_string(a, object, "type", &e->type);
+    json_object_get_string(a, object, "user", &e->user);
+    if (json_object_get_int(a, object, "status", &value)) e->status = value;
+    json_object_get_float(a, object, "latency", &e->latency);
+    json_object_get_bool(a, object, "cached", &e->cached);
+
+    JSONObject *client = json_object_get_object(a, object, "client");
+    if (client != NULL) {
+        json_object_get_string(a, client, "id", &e->client.id);
+        json_object_get_string(a, client, "ip", &e->client.ip);
+        if (json_object_get_int(a, client, "port", &value)) {
+            e->client.port = value;
+        }
+        JSONObject *geo = json_object_get_object(a, client, "geo");
+        if (geo != NULL) {
+            json_object_get_float(a, geo, "lat", &e->client.geo.lat);
+            json_object_get_float(a, geo, "lon", &e->client.geo.lon);
+        }
+    }
+
+    JSONArray *tags = json_object_get_array(a, object, "tags");
+    if (tags != NULL) {
+        size_t count = 0;
+        for_each_element(tags, tag) count++;
+        e->tags = arena_alloc(a, count * sizeof(JSONString));
+        for_each_element(tags, tag) {
+            JSONElement *element = &tag->element;
+            if (element->type == JSON_ELEMENT_VALUE &&
+                element->element.value.type == JSON_VALUE_STRING) {
+                e->tags[e->tag_count++] = element->element.value.value.string;
+            }
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    size_t events = argc > 1 ? strtoul(argv[1], NULL, 10) : 100000;
+    size_t rounds = argc > 2 ? strtoul(argv[2], NULL, 10) : 10;
+
+    JSONError error;
+    if (json_struct_init(&event_struct, &error)) return 1;
+
+    size_t length;
+    char *content = generate(events, &length);
+    double mb = length * rounds / (double)(1 << 20);
+
+    Event *decoded = malloc(events * sizeof(Event));
+    volatile long long sink = 0;
+    Arena a = {0};
+
+    double start = now();
+    for (size_t r = 0; r < rounds; r++) {
+        const char *line = content;
+        for (size_t i = 0; i < events; i++) {
+            const char *end = strchr(line, '\n');
+            JSONElement root = json_parse_buffer(&a, line, end - line, &error);
+            if (error.code) return 1;
+            walk(&a, root.element.object, &decoded[i]);
+            sink += decoded[i].ts + decoded[i].tag_count;
+            line = end + 1;
+        }
+        arena_reset(&a);
+    }
+    double tree = now() - start;
+
+    start = now();
+    for (size_t r = 0; r < rounds; r++) {
+        const char *line = content;
+        for (size_t i = 0; i < events; i++) {
+            const char *end = strchr(line, '\n');
+            if (json_decode(&a, &event_struct, line, end - line,
+                            &decoded[i], &error)) {
+                return 1;
+            }
+            sink += decoded[i].ts + decoded[i].tag_count;
+            line = end + 1;
+        }
+        if (r + 1 < rounds) arena_reset(&a);
+    }
+    double decode = now() - start;
+
+    // Written back from the last round's structs, without the debug field
+    size_t written = 0;
+    start = now();
+    for (size_t r = 0; r < rounds; r++) {
+        JSONWriter w = json_writer_buffer(JSON_STYLE_COMPACT);
+        for (size_t i = 0; i < events; i++) {
+            if (json_encode(&w, &event_struct, &decoded[i])) return 1;
+        }
+        written += w.size;
+        json_writer_free(&w);
+    }
+    double encode = now() - start;
+
+    printf("%zu events\n", events);
+    printf("parse and walk  %8.1f MB/s\n", mb / tree);
+    printf("json_decode     %8.1f MB/s  %5.2fx\n", mb / decode,
+           tree / decode);
+    printf("json_encode     %8.1f MB/s\n",
+           written / (double)(1 << 20) / encode);
+
+    arena_free(&a);
+    free(decoded);
+    free(content);
+    return 0;
+}
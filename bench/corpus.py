@@ -0,0 +1,153 @@
+"""
+Deterministic benchmark corpus generator.
+
+Usage: python3 corpus.py <shape> <megabytes> <output>
+
+Shapes:
+    numbers  metric series and geo coordinates, almost all numeric literals
+    logs     structured log events with short strings and a few numbers
+    strings  text with quotes, control characters and \\u escapes
+    nested   chains of objects and arrays tens of levels deep
+    wide     objects of hundreds of keys
+    records  API resources: nested objects, tag arrays, nulls and booleans
+
+The records are written as one JSON array, or one per line (NDJSON) when
+the output name ends in .ndjson.
+"""
+
+import json
+import random
+import sys
+
+
+def numbers(rng):
+    # One sample point, a mix of ints, short and full precision floats and
+    # exponents as metrics exporters and GeoJSON emit them
+    return {
+        "ts": 1700000000000 + rng.randrange(10**9),
+        "values": [round(rng.uniform(-1000, 1000), rng.randrange(1, 7))
+                   for _ in range(16)],
+        "counters": [rng.randrange(2**40) for _ in range(8)],
+        "coordinates": [[rng.uniform(-180, 180), rng.uniform(-90, 90)]
+                        for _ in range(8)],
+        "scale": float(f"{rng.uniform(1, 10):.3f}e{rng.randrange(-20, 20)}"),
+    }
+
+
+LEVELS = ["debug", "info", "info", "info", "warn", "error"]
+SERVICES = ["api", "auth", "billing", "search", "worker"]
+
+
+def logs(rng):
+    # One event as a structured logger writes it
+    return {
+        "ts": f"2024-01-{rng.randrange(1, 29):02}T{rng.randrange(24):02}:"
+              f"{rng.randrange(60):02}:{rng.randrange(60):02}.{rng.randrange(1000):03}Z",
+        "level": rng.choice(LEVELS),
+        "service": rng.choice(SERVICES),
+        "request_id": f"{rng.getrandbits(64):016x}",
+        "latency_ms": round(rng.expovariate(1 / 40), 2),
+        "status": rng.choice([200, 200, 200, 201, 204, 400, 404, 500]),
+        "path": "/v1/" + "/".join(rng.choice(SERVICES)
+                                  for _ in range(rng.randrange(1, 4))),
+        "message": f"handled request in \"{rng.choice(SERVICES)}\"",
+    }
+
+
+WORDS = ["lorem", "ipsum", "dolor", "sit", "amet", "caf\u00e9", "na\u00efve",
+         "\u65e5\u672c", "\u0436\u0443\u043a", "\U0001f600", "tab\tbed",
+         "new\nline", "\"quoted\"", "back\\slash", "path/to", "\x01ctl"]
+
+
+def strings(rng):
+    # Escape heavy text: json.dumps writes every non-ASCII character as a
+    # \u escape, astral ones as surrogate pairs
+    def text(lo, hi):
+        return " ".join(rng.choice(WORDS) for _ in range(rng.randrange(lo, hi)))
+
+    return {
+        "title": text(2, 8),
+        "body": text(20, 60),
+        "tags": [rng.choice(WORDS) for _ in range(rng.randrange(1, 6))],
+    }
+
+
+def nested(rng):
+    # A chain of objects and arrays 16 to 96 levels deep, well under
+    # JSON_MAX_DEPTH, with a scalar at each level
+    value = rng.randrange(1000)
+    for depth in range(rng.randrange(16, 96)):
+        if depth % 2:
+            value = [depth, value]
+        else:
+            value = {"depth": depth, "child": value}
+    return value
+
+
+def wide(rng):
+    # Hundreds of keys per object, long enough that lookups go through the
+    # hash index
+    return {f"field_{i}": rng.choice([i, f"v{i}", i / 4, True, None])
+            for i in range(rng.randrange(200, 600))}
+
+
+def records(rng):
+    # One resource as a REST API returns it
+    return {
+        "id": rng.getrandbits(48),
+        "name": f"user{rng.randrange(10**6)}",
+        "email": f"user{rng.randrange(10**6)}@example.com",
+        "active": rng.random() < 0.8,
+        "score": round(rng.uniform(0, 100), 2),
+        "manager": None if rng.random() < 0.5 else rng.getrandbits(48),
+        "address": {
+            "street": f"{rng.randrange(1, 999)} Main St",
+            "city": rng.choice(["Berlin", "Lagos", "Lima", "Osaka", "Oslo"]),
+            "zip": f"{rng.randrange(10**5):05}",
+        },
+        "tags": [rng.choice(SERVICES) for _ in range(rng.randrange(0, 5))],
+    }
+
+
+SHAPES = {
+    "numbers": numbers,
+    "logs": logs,
+    "strings": strings,
+    "nested": nested,
+    "wide": wide,
+    "records": records,
+}
+
+
+def main():
+    if len(sys.argv) != 4 or sys.argv[1] not in SHAPES:
+        print(__doc__.strip(), file=sys.stderr)
+        sys.exit(1)
+
+    shape = SHAPES[sys.argv[1]]
+    target = int(float(sys.argv[2]) * (1 << 20))
+    rng = random.Random(42)
+
+    ndjson = sys.argv[3].endswith(".ndjson")
+
+    with open(sys.argv[3], "w") as out:
+        if not ndjson:
+            out.write("[")
+        written = 1
+        first = True
+        while written < target:
+            record = json.dumps(shape(rng), separators=(",", ":"))
+            if ndjson:
+                record += "\n"
+            elif not first:
+                out.write(",")
+                written += 1
+            out.write(record)
+            written += len(record)
+            first = False
+        if not ndjson:
+            out.write("]\n")
+
+
+if __name__ == "__main__":
+    main()
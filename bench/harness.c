@@ -0,0 +1,361 @@
+/*
+    Benchmark suite: tokenizing, parsing, stringifying and key lookups
+    measured separately on each corpus file (see corpus.py). Each phase
+    runs in its own process so its peak RSS isn't inflated by the others.
+
+    Prints a table, and with -o also writes one JSON object per corpus and
+    phase to a file, one per line, for tracking results across commits.
+
+    Usage: ./harness [-o results.ndjson] [-t seconds] <file>...
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/ndjson.h"
+#include "../include/object.h"
+#include "../include/utils.h"
+#include "../include/writer.h"
+
+#define MIN_RUNS 3
+
+typedef enum { TOKENIZE, PARSE, STRINGIFY, LOOKUP, PHASE_COUNT } Phase;
+
+static const char *phase_names[] = {"tokenize", "parse", "stringify",
+                                    "lookup"};
+
+typedef struct {
+    size_t bytes;        // Input bytes per run
+    size_t elements;     // Tokens, tree elements or lookups per run
+    size_t runs;
+    double seconds;      // Fastest run
+    size_t allocations;  // Regions the arena malloc'd in the first run,
+                         // later runs reuse them
+    size_t arena_bytes;  // Arena bytes in use after a run
+    long peak_rss;       // KiB, for the whole process
+    int error;
+} Result;
+
+// A .ndjson file is parsed as one document per line, anything else as
+// one document
+typedef struct {
+    const char *buf;
+    size_t len;
+    bool ndjson;
+    JSONElement root;
+    JSONRecord *records;
+    size_t count;
+} Document;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static JSONElement document_root(const Document *d, size_t i) {
+    return d->ndjson ? d->records[i].root : d->root;
+}
+
+static int document_parse(Arena *a, Document *d) {
+    if (d->ndjson) {
+        // One worker, the other phases are single-threaded too
+        int error = 0;
+        d->records =
+            json_parse_ndjson(a, d->buf, d->len, 1, &d->count, &error);
+        return error;
+    }
+    JSONError error;
+    d->root = json_parse_buffer(a, d->buf, d->len, &error);
+    d->count = 1;
+    return error.code != JSON_ERROR_NONE;
+}
+
+static size_t count_elements(JSONElement element) {
+    size_t count = 1;
+    switch (element.type) {
+        case JSON_ELEMENT_OBJECT:
+            for_each_pair(element.element.object, pair) {
+                count += count_elements(pair->value);
+            }
+            break;
+        case JSON_ELEMENT_ARRAY:
+            for_each_element(element.element.array, item) {
+                count += count_elements(item->element);
+            }
+            break;
+        default:
+            break;
+    }
+    return count;
+}
+
+// Looks up every key of every object in the tree by name
+static size_t lookup_keys(Arena *a, JSONElement element) {
+    size_t count = 0;
+    switch (element.type) {
+        case JSON_ELEMENT_OBJECT: {
+            JSONObject *object = element.element.object;
+            for_each_pair(object, pair) {
+                if (json_object_get_n(a, object, pair->key.data,
+                                      pair->key.length) == NULL) {
+                    return SIZE_MAX;
+                }
+                size_t nested = lookup_keys(a, pair->value);
+                if (nested == SIZE_MAX) return SIZE_MAX;
+                count += 1 + nested;
+            }
+            break;
+        }
+        case JSON_ELEMENT_ARRAY:
+            for_each_element(element.element.array, item) {
+                size_t nested = lookup_keys(a, item->element);
+                if (nested == SIZE_MAX) return SIZE_MAX;
+                count += nested;
+            }
+            break;
+        default:
+            break;
+    }
+    return count;
+}
+
+static size_t document_elements(const Document *d) {
+    size_t count = 0;
+    for (size_t i = 0; i < d->count; i++) {
+        count += count_elements(document_root(d, i));
+    }
+    return count;
+}
+
+// One run of phase. Tokenizing and lookups set *elements to the tokens and
+// keys they went through. tree holds the parsed document for the phases
+// that start from one.
+static int run_phase(Phase phase, Arena *a, Document *d, Arena *tree,
+                     size_t *elements) {
+    *elements = 0;
+    switch (phase) {
+        case TOKENIZE: {
+            JSONTokenizer t;
+            json_tokenizer_init(&t, d->buf, d->len);
+            t.borrow = true;
+            do {
+                if (json_next_token(a, &t)) return 1;
+                ++*elements;
+            } while (t.current_token.type != END);
+            return 0;
+        }
+        case PARSE:
+            return document_parse(a, d);
+        case STRINGIFY:
+            for (size_t i = 0; i < d->count; i++) {
+                if (json_stringify(a, document_root(d, i)) == NULL) return 1;
+            }
+            return 0;
+        case LOOKUP:
+            // Objects index their keys on the first lookup, in the tree's
+            // arena, so only the first run pays for it
+            for (size_t i = 0; i < d->count; i++) {
+                size_t count = lookup_keys(tree, document_root(d, i));
+                if (count == SIZE_MAX) return 1;
+                *elements += count;
+            }
+            return 0;
+        default:
+            return 1;
+    }
+}
+
+static Result measure(Phase phase, const char *file_name, double seconds) {
+    Result r = {0};
+    FileContent file;
+    if (map_file_content(file_name, &file)) {
+        fprintf(stderr, "Failed to read file %s\n", file_name);
+        r.error = 1;
+        return r;
+    }
+
+    size_t length = strlen(file_name);
+    Document d = {.buf = file.data,
+                  .len = file.size,
+                  .ndjson = length > 7 &&
+                            strcmp(file_name + length - 7, ".ndjson") == 0};
+    r.bytes = file.size;
+
+    Arena tree = {0};
+    Arena a = {0};
+    if (phase == STRINGIFY || phase == LOOKUP) {
+        r.error = document_parse(&tree, &d);
+    }
+
+    double total = 0;
+    while (!r.error && (r.runs < MIN_RUNS || total < seconds)) {
+        Arena *counted = phase == LOOKUP ? &tree : &a;
+        size_t allocations = counted->allocations;
+        if (d.ndjson && phase == PARSE) {
+            // The worker's regions are merged into a on every run, reusing
+            // a would only grow it
+            arena_free(&a);
+            allocations = 0;
+        } else {
+            arena_reset(&a);
+        }
+
+        double start = now();
+        r.error = run_phase(phase, &a, &d, &tree, &r.elements);
+        double elapsed = now() - start;
+
+        if (r.runs == 0) {
+            r.allocations = counted->allocations - allocations;
+            r.seconds = elapsed;
+        }
+        r.seconds = elapsed < r.seconds ? elapsed : r.seconds;
+        r.arena_bytes = counted->used;
+        total += elapsed;
+        r.runs++;
+    }
+
+    if (!r.error && (phase == PARSE || phase == STRINGIFY)) {
+        r.elements = document_elements(&d);
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    r.peak_rss = usage.ru_maxrss;
+
+    arena_free(&a);
+    arena_free(&tree);
+    unmap_file_content(&file);
+    return r;
+}
+
+// Runs measure in a child process, which hands the result back through a
+// pipe
+static Result measure_isolated(Phase phase, const char *file_name,
+                               double seconds) {
+    Result r = {.error = 1};
+    int fds[2];
+    if (pipe(fds)) {
+        return r;
+    }
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        r = measure(phase, file_name, seconds);
+        _exit(write(fds[1], &r, sizeof(r)) != sizeof(r));
+    }
+
+    close(fds[1]);
+    if (pid < 0 || read(fds[0], &r, sizeof(r)) != sizeof(r)) {
+        r = (Result){.error = 1};
+    }
+    close(fds[0]);
+    if (pid > 0) waitpid(pid, NULL, 0);
+    return r;
+}
+
+static void write_result(FILE *out, const char *corpus, Phase phase,
+                         const Result *r, double mb_s, double ns) {
+    JSONWriter w = json_writer_file(out, JSON_STYLE_COMPACT);
+    json_write_object_start(&w);
+    json_write_key(&w, (JSONString){"corpus", 6});
+    json_write_string(&w, (JSONString){corpus, strlen(corpus)});
+    json_write_key(&w, (JSONString){"phase", 5});
+    json_write_string(&w, (JSONString){phase_names[phase],
+                                       strlen(phase_names[phase])});
+    json_write_key(&w, (JSONString){"bytes", 5});
+    json_write_uint(&w, r->bytes);
+    json_write_key(&w, (JSONString){"elements", 8});
+    json_write_uint(&w, r->elements);
+    json_write_key(&w, (JSONString){"runs", 4});
+    json_write_uint(&w, r->runs);
+    json_write_key(&w, (JSONString){"seconds", 7});
+    json_write_float(&w, r->seconds);
+    json_write_key(&w, (JSONString){"mb_per_s", 8});
+    json_write_float(&w, mb_s);
+    json_write_key(&w, (JSONString){"ns_per_element", 14});
+    json_write_float(&w, ns);
+    json_write_key(&w, (JSONString){"allocations", 11});
+    json_write_uint(&w, r->allocations);
+    json_write_key(&w, (JSONString){"arena_bytes", 11});
+    json_write_uint(&w, r->arena_bytes);
+    json_write_key(&w, (JSONString){"peak_rss_kb", 11});
+    json_write_int(&w, r->peak_rss);
+    json_write_object_end(&w);
+    json_writer_flush(&w);
+    json_writer_free(&w);
+    fputc('\n', out);
+}
+
+int main(int argc, char *argv[]) {
+    const char *output = NULL;
+    double seconds = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "o:t:")) != -1) {
+        switch (opt) {
+            case 'o':
+                output = optarg;
+                break;
+            case 't':
+                seconds = strtod(optarg, NULL);
+                break;
+            default:
+                optind = argc + 1;
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr,
+                "Usage: %s [-o results.ndjson] [-t seconds] <file>...\n",
+                argv[0]);
+        return 1;
+    }
+
+    FILE *out = NULL;
+    if (output != NULL && (out = fopen(output, "w")) == NULL) {
+        fprintf(stderr, "Failed to open file %s\n", output);
+        return 1;
+    }
+
+    printf("%-24s %-10s %10s %10s %12s %8s %10s %10s\n", "corpus", "phase",
+           "MB/s", "ns/elem", "elements", "allocs", "arena MiB", "RSS MiB");
+
+    int failed = 0;
+    for (int i = optind; i < argc; i++) {
+        const char *corpus = strrchr(argv[i], '/');
+        corpus = corpus ? corpus + 1 : argv[i];
+
+        for (Phase phase = 0; phase < PHASE_COUNT; phase++) {
+            Result r = measure_isolated(phase, argv[i], seconds);
+            if (r.error) {
+                fprintf(stderr, "%s: %s failed\n", argv[i],
+                        phase_names[phase]);
+                failed = 1;
+                continue;
+            }
+
+            double mb_s = r.bytes / 1e6 / r.seconds;
+            double ns = r.elements ? r.seconds * 1e9 / r.elements : 0;
+            printf("%-24s %-10s %10.1f %10.1f %12zu %8zu %10.1f %10.1f\n",
+                   corpus, phase_names[phase], mb_s, ns, r.elements,
+                   r.allocations, r.arena_bytes / (double)(1 << 20),
+                   r.peak_rss / 1024.0);
+            if (out != NULL) {
+                write_result(out, corpus, phase, &r, mb_s, ns);
+            }
+        }
+    }
+
+    if (out != NULL && fclose(out) != 0) {
+        fprintf(stderr, "Failed to write file %s\n", output);
+        failed = 1;
+    }
+    return failed;
+}
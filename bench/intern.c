@@ -0,0 +1,121 @@
+/*
+    Interning benchmark: memory and time of json_parse vs json_parse_interned
+    on an array of records sharing their keys, and of key lookups on the
+    resulting trees
+
+    Usage: ./intern [records] [fields]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/intern.h"
+#include "../include/object.h"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// [{"attribute_0": 0, "attribute_1": "ok", "attribute_2": "record 0", ...}]
+static char *generate(size_t records, size_t fields) {
+    static const char *states[] = {"ok", "failed", "pending"};
+    char *content = malloc(records * fields * 40 + 3);
+    size_t n = 0;
+
+    content[n++] = '[';
+    for (size_t r = 0; r < records; r++) {
+        n += sprintf(content + n, "%s{", r ? ", " : "");
+        for (size_t f = 0; f < fields; f++) {
+            const char *sep = f ? ", " : "";
+            switch (f % 3) {
+                case 0:
+                    n += sprintf(content + n, "%s\"attribute_%zu\": %zu", sep,
+                                 f, r);
+                    break;
+                case 1:
+                    n += sprintf(content + n, "%s\"attribute_%zu\": \"%s\"",
+                                 sep, f, states[(r + f) % 3]);
+                    break;
+                case 2:
+                    n += sprintf(content + n,
+                                 "%s\"attribute_%zu\": \"record %zu\"", sep, f,
+                                 r);
+                    break;
+            }
+        }
+        content[n++] = '}';
+    }
+    content[n++] = ']';
+    content[n] = '\0';
+    return content;
+}
+
+static double mib(size_t bytes) { return bytes / (double)(1 << 20); }
+
+int main(int argc, char *argv[]) {
+    size_t records = argc > 1 ? strtoul(argv[1], NULL, 10) : 200000;
+    size_t fields = argc > 2 ? strtoul(argv[2], NULL, 10) : 20;
+
+    char *content = generate(records, fields);
+    size_t length = strlen(content);
+    char key[32];
+    snprintf(key, sizeof(key), "attribute_%zu", fields - 1);
+
+    Arena a = {0};
+    ArenaStats stats;
+    JSONError error;
+    volatile size_t sink = 0;
+
+    double start = now();
+    JSONElement root = json_parse(&a, content, &error);
+    if (error.code) return 1;
+    double parse = now() - start;
+    arena_stats(&a, &stats);
+    size_t copied = stats.used;
+
+    start = now();
+    for_each_element(root.element.array, record) {
+        sink += json_object_get(&a, record->element.element.object, key) != 0;
+    }
+    double lookup = now() - start;
+    arena_reset(&a);
+
+    // Keys and the short state strings are pooled
+    JSONInternPool pool;
+    json_intern_init(&pool, 8);
+
+    start = now();
+    root = json_parse_interned(&a, &pool, content, length, &error);
+    if (error.code) return 1;
+    double parse_interned = now() - start;
+    arena_stats(&a, &stats);
+    size_t interned = stats.used;
+
+    JSONString pooled = json_intern(&pool, key, strlen(key));
+    start = now();
+    for_each_element(root.element.array, record) {
+        sink += json_object_get_interned(&a, record->element.element.object,
+                                         pooled) != 0;
+    }
+    double lookup_interned = now() - start;
+
+    printf("%zu records of %zu fields, %.1f MiB\n", records, fields,
+           mib(length));
+    printf("json_parse           %8.1f MiB arena  %7.1f ms  lookups %6.1f ms\n",
+           mib(copied), parse * 1e3, lookup * 1e3);
+    printf("json_parse_interned  %8.1f MiB arena  %7.1f ms  lookups %6.1f ms\n",
+           mib(interned), parse_interned * 1e3, lookup_interned * 1e3);
+    printf("pool                 %8zu strings, %zu bytes, %zu lookups\n",
+           pool.count, pool.bytes, pool.lookups);
+    printf("memory saved         %7.1f%%\n",
+           100.0 * (copied - interned) / copied);
+
+    json_intern_free(&pool);
+    arena_free(&a);
+    free(content);
+    return 0;
+}
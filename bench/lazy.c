@@ -0,0 +1,129 @@
+/*
+    Sparse access benchmark: reading a few fields of wide records with
+    json_parse_buffer and json_object_get vs the on-demand API
+
+    Usage: ./lazy [records] [fields] [rounds]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/lazy.h"
+#include "../include/object.h"
+
+// Fields read from each record, spread across it
+#define READS 5
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// [{"field_0": 0, "field_1": "value \"1\"", "field_2": 2.5, ...}, ...]
+static char *generate(size_t records, size_t fields, size_t *length) {
+    char *content = malloc(records * fields * 40 + 2);
+    size_t n = 0;
+
+    content[n++] = '[';
+    for (size_t r = 0; r < records; r++) {
+        n += sprintf(content + n, "%s{", r ? ", " : "");
+        for (size_t f = 0; f < fields; f++) {
+            const char *sep = f ? ", " : "";
+            switch (f % 3) {
+                case 0:
+                    n += sprintf(content + n, "%s\"field_%zu\": %zu", sep, f,
+                                 r * fields + f);
+                    break;
+                case 1:
+                    n += sprintf(content + n,
+                                 "%s\"field_%zu\": \"value \\\"%zu\\\"\"",
+                                 sep, f, r);
+                    break;
+                case 2:
+                    n += sprintf(content + n, "%s\"field_%zu\": %zu.5", sep, f,
+                                 r);
+                    break;
+            }
+        }
+        content[n++] = '}';
+    }
+    content[n++] = ']';
+
+    *length = n;
+    return content;
+}
+
+int main(int argc, char *argv[]) {
+    size_t records = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000;
+    size_t fields = argc > 2 ? strtoul(argv[2], NULL, 10) : 200;
+    size_t rounds = argc > 3 ? strtoul(argv[3], NULL, 10) : 10;
+
+    size_t length;
+    char *content = generate(records, fields, &length);
+    double mb = length * rounds / (double)(1 << 20);
+
+    // Every third field is an integer
+    char names[READS][32];
+    for (size_t i = 0; i < READS; i++) {
+        snprintf(names[i], sizeof(names[i]), "field_%zu",
+                 (fields / READS * i) / 3 * 3);
+    }
+
+    volatile long long sink = 0;
+    Arena a = {0};
+    JSONError error;
+
+    double start = now();
+    for (size_t r = 0; r < rounds; r++) {
+        JSONElement root = json_parse_buffer(&a, content, length, &error);
+        if (error.code) return 1;
+        for_each_element(root.element.array, record) {
+            for (size_t i = 0; i < READS; i++) {
+                long long value;
+                json_object_get_int(&a, record->element.element.object,
+                                    names[i], &value);
+                sink += value;
+            }
+        }
+        arena_reset(&a);
+    }
+    double eager = now() - start;
+
+    start = now();
+    for (size_t r = 0; r < rounds; r++) {
+        JSONLazyDocument doc;
+        if (json_lazy_parse(&doc, content, length, &error)) return 1;
+
+        JSONLazyArray array;
+        json_lazy_get_array(json_lazy_root(&doc), &array);
+        JSONLazyIterator it = json_lazy_array_iter(array);
+        JSONLazyValue record;
+        while (json_lazy_array_next(&it, &record)) {
+            JSONLazyObject object;
+            json_lazy_get_object(record, &object);
+            for (size_t i = 0; i < READS; i++) {
+                JSONLazyValue field;
+                long long value;
+                if (json_lazy_object_get(object, names[i], &field) &&
+                    json_lazy_get_int(field, &value)) {
+                    sink += value;
+                }
+            }
+        }
+        json_lazy_free(&doc);
+    }
+    double lazy = now() - start;
+
+    printf("%zu records of %zu fields, %d read from each\n", records, fields,
+           READS);
+    printf("json_parse_buffer  %8.1f MB/s\n", mb / eager);
+    printf("json_lazy_parse    %8.1f MB/s  %5.2fx\n", mb / lazy,
+           eager / lazy);
+
+    arena_free(&a);
+    free(content);
+    return 0;
+}
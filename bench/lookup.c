@@ -0,0 +1,95 @@
+/*
+    Key lookup benchmark: linear strcmp walk vs json_object_get
+
+    Usage: ./lookup [keys] [rounds]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/object.h"
+#include "../include/parser.h"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// What callers had to write before json_object_get existed
+static JSONElement *linear_get(JSONObject *object, const char *key) {
+    size_t length = strlen(key);
+    for_each_pair(object, pair) {
+        if (pair->key.length == length &&
+            memcmp(pair->key.data, key, length) == 0) {
+            return &pair->value;
+        }
+    }
+    return NULL;
+}
+
+static void run(size_t keys, size_t rounds) {
+    // {"field_0_name": 0, "field_1_name": 1, ...}
+    char (*names)[32] = malloc(keys * sizeof(*names));
+    char *content = malloc(keys * 48 + 2);
+    size_t length = 0;
+
+    content[length++] = '{';
+    for (size_t i = 0; i < keys; i++) {
+        snprintf(names[i], sizeof(names[i]), "field_%zu_name", i);
+        length += sprintf(content + length, "%s\"%s\": %zu", i ? ", " : "",
+                          names[i], i);
+    }
+    content[length++] = '}';
+    content[length] = '\0';
+
+    Arena a = {0};
+    JSONError error;
+    JSONElement root = json_parse(&a, content, &error);
+    if (error.code) exit(1);
+    JSONObject *object = root.element.object;
+
+    volatile long long sink = 0;
+
+    double start = now();
+    for (size_t r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < keys; i++) {
+            sink += linear_get(object, names[i])->element.value.value.number_int;
+        }
+    }
+    double linear = (now() - start) / (rounds * keys);
+
+    start = now();
+    for (size_t r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < keys; i++) {
+            long long value;
+            json_object_get_int(&a, object, names[i], &value);
+            sink += value;
+        }
+    }
+    double hashed = (now() - start) / (rounds * keys);
+
+    printf("%6zu keys  linear %8.1f ns  json_object_get %8.1f ns\n", keys,
+           linear * 1e9, hashed * 1e9);
+
+    arena_free(&a);
+    free(content);
+    free(names);
+}
+
+int main(int argc, char *argv[]) {
+    size_t rounds = argc > 2 ? strtoul(argv[2], NULL, 10) : 1000;
+
+    if (argc > 1) {
+        run(strtoul(argv[1], NULL, 10), rounds);
+        return 0;
+    }
+
+    size_t sizes[] = {4, 8, 16, 32, 64, 128, 256, 512, 1024};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        run(sizes[i], rounds);
+    }
+    return 0;
+}
@@ -0,0 +1,60 @@
+/*
+    Memory benchmark: arena bytes per element of the tree built by
+    json_parse_file, and the size of each node type
+
+    Usage: ./memory <file>...
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../include/parser.h"
+
+static size_t count_elements(JSONElement element) {
+    size_t count = 1;
+    switch (element.type) {
+        case JSON_ELEMENT_OBJECT:
+            for_each_pair(element.element.object, pair) {
+                count += count_elements(pair->value);
+            }
+            break;
+        case JSON_ELEMENT_ARRAY:
+            for_each_element(element.element.array, item) {
+                count += count_elements(item->element);
+            }
+            break;
+        default:
+            break;
+    }
+    return count;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <file>...\n", argv[0]);
+        return 1;
+    }
+
+    printf("JSONValue %zu, JSONElement %zu, JSONArrayElement %zu, "
+           "JSONPair %zu, JSONObject %zu bytes\n",
+           sizeof(JSONValue), sizeof(JSONElement), sizeof(JSONArrayElement),
+           sizeof(JSONPair), sizeof(JSONObject));
+
+    Arena a = {0};
+    for (int i = 1; i < argc; i++) {
+        JSONError error;
+        JSONElement root = json_parse_file(&a, argv[i], &error);
+        if (error.code) return 1;
+
+        ArenaStats stats;
+        arena_stats(&a, &stats);
+        size_t elements = count_elements(root);
+        printf("%-24s %10zu elements %12zu bytes %8.1f bytes/element\n",
+               argv[i], elements, stats.used,
+               stats.used / (double)elements);
+        arena_reset(&a);
+    }
+
+    arena_free(&a);
+    return 0;
+}
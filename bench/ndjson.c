@@ -0,0 +1,80 @@
+/*
+    NDJSON benchmark: throughput of json_parse_ndjson and
+    json_parse_ndjson_each as the worker count doubles
+
+    Usage: ./ndjson <file.ndjson> [max threads]
+*/
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../include/ndjson.h"
+#include "../include/utils.h"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int count_record(void *context, const JSONRecord *record, Arena *a) {
+    (void)a;
+    if (!record->error.code) {
+        atomic_fetch_add((atomic_size_t *)context, 1);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        printf("Usage: %s <file.ndjson> [max threads]\n", argv[0]);
+        return 1;
+    }
+    size_t max_threads = argc > 2 ? strtoul(argv[2], NULL, 10) : 16;
+
+    FileContent content;
+    if (map_file_content(argv[1], &content)) {
+        printf("Failed to read file %s\n", argv[1]);
+        return 1;
+    }
+    double mb = content.size / (double)(1 << 20);
+
+    printf("%-8s %12s %10s %12s %10s\n", "threads", "ordered MB/s", "speedup",
+           "each MB/s", "speedup");
+
+    double ordered_base = 0, each_base = 0;
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        Arena a = {0};
+        size_t count;
+        int error;
+
+        double start = now();
+        json_parse_ndjson(&a, content.data, content.size, threads, &count,
+                          &error);
+        double ordered = mb / (now() - start);
+        arena_free(&a);
+
+        atomic_size_t records = 0;
+        start = now();
+        json_parse_ndjson_each(content.data, content.size, threads,
+                               count_record, &records);
+        double each = mb / (now() - start);
+
+        if (threads == 1) {
+            ordered_base = ordered;
+            each_base = each;
+        }
+        printf("%-8zu %12.1f %9.2fx %12.1f %9.2fx\n", threads, ordered,
+               ordered / ordered_base, each, each / each_base);
+
+        if (error || (size_t)records != count) {
+            printf("%zu of %zu records failed\n", count - (size_t)records,
+                   count);
+        }
+    }
+
+    unmap_file_content(&content);
+    return 0;
+}
@@ -0,0 +1,69 @@
+/*
+    Parallel parse benchmark: throughput of json_parse_parallel on one
+    document as the worker count doubles, against json_parse_buffer
+
+    Usage: ./parallel <file.json> [max threads]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/parallel.h"
+#include "../include/utils.h"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        printf("Usage: %s <file.json> [max threads]\n", argv[0]);
+        return 1;
+    }
+    size_t max_threads = argc > 2 ? strtoul(argv[2], NULL, 10) : 16;
+
+    FileContent content;
+    if (map_file_content(argv[1], &content)) {
+        printf("Failed to read file %s\n", argv[1]);
+        return 1;
+    }
+    double mb = content.size / (double)(1 << 20);
+
+    Arena serial_arena = {0};
+    JSONError error;
+    double start = now();
+    JSONElement serial =
+        json_parse_buffer(&serial_arena, content.data, content.size, &error);
+    double base = mb / (now() - start);
+    if (error.code) {
+        printf("Failed to parse %s\n", argv[1]);
+        return 1;
+    }
+    char *expected = json_stringify(&serial_arena, serial);
+
+    printf("%-8s %10s %10s\n", "threads", "MB/s", "speedup");
+    printf("%-8s %10.1f %9.2fx\n", "serial", base, 1.0);
+
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        Arena a = {0};
+
+        start = now();
+        JSONElement root = json_parse_parallel(&a, content.data, content.size,
+                                               threads, &error);
+        double parallel = mb / (now() - start);
+
+        printf("%-8zu %10.1f %9.2fx\n", threads, parallel, parallel / base);
+        if (error.code || strcmp(json_stringify(&a, root), expected) != 0) {
+            printf("Result differs from the serial parse\n");
+        }
+        arena_free(&a);
+    }
+
+    arena_free(&serial_arena);
+    unmap_file_content(&content);
+    return 0;
+}
@@ -0,0 +1,152 @@
+/*
+    Query benchmark: the same paths against many small documents, compiled
+    for every document vs compiled once, on parsed trees, parsing each
+    document first, and on the tokenizer
+
+    Usage: ./query [documents]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/query.h"
+
+static const char *paths[] = {
+    "$.user.address.city",
+    "/items/2/price",
+    "$.items[*].sku",
+    "$..id",
+};
+#define PATHS (sizeof(paths) / sizeof(paths[0]))
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int count_match(void *context, JSONElement *match) {
+    (void)match;
+    ++*(size_t *)context;
+    return 0;
+}
+
+// One order, as an API would return it
+static size_t generate(char *buf, size_t i) {
+    size_t n = sprintf(buf,
+                       "{\"id\": %zu, \"user\": {\"id\": %zu, \"name\": "
+                       "\"user %zu\", \"address\": {\"street\": \"%zu Main "
+                       "St\", \"city\": \"City %zu\", \"zip\": \"%05zu\"}}, "
+                       "\"items\": [",
+                       i, i % 1000, i % 1000, i, i % 50, i % 100000);
+    for (size_t j = 0; j < 8; j++) {
+        n += sprintf(buf + n,
+                     "%s{\"id\": %zu, \"sku\": \"SKU-%zu\", \"price\": "
+                     "%zu.99, \"tags\": [\"a\", \"b\", \"c\"]}",
+                     j ? ", " : "", j, i * 8 + j, j * 3);
+    }
+    n += sprintf(buf + n, "], \"note\": \"%s\"}",
+                 i % 2 ? "leave at the door" : "call on arrival");
+    return n;
+}
+
+int main(int argc, char *argv[]) {
+    size_t documents = argc > 1 ? strtoul(argv[1], NULL, 10) : 100000;
+
+    char **docs = malloc(documents * sizeof(char *));
+    size_t *lengths = malloc(documents * sizeof(size_t));
+    char buf[4096];
+    for (size_t i = 0; i < documents; i++) {
+        lengths[i] = generate(buf, i);
+        docs[i] = malloc(lengths[i]);
+        memcpy(docs[i], buf, lengths[i]);
+    }
+
+    // Trees for the runs that don't include parsing
+    Arena trees = {0};
+    JSONElement *roots = malloc(documents * sizeof(JSONElement));
+    JSONError parse_error;
+    for (size_t d = 0; d < documents; d++) {
+        roots[d] =
+            json_parse_buffer(&trees, docs[d], lengths[d], &parse_error);
+        if (parse_error.code) return 1;
+    }
+
+    printf("%zu documents, ns per document\n", documents);
+    printf("%-22s %10s %10s %10s %10s %10s\n", "path", "compile",
+           "recompile", "compiled", "parse+run", "stream");
+
+    Arena a = {0};
+    JSONError error;
+    for (size_t i = 0; i < PATHS; i++) {
+        size_t matches[4] = {0};
+        double times[5];
+
+        double start = now();
+        for (size_t d = 0; d < documents; d++) {
+            json_query_compile(&a, paths[i], &error);
+            arena_reset(&a);
+        }
+        times[0] = now() - start;
+
+        // Compiled with every document
+        start = now();
+        for (size_t d = 0; d < documents; d++) {
+            JSONQuery *q = json_query_compile(&a, paths[i], &error);
+            json_query_each(q, &roots[d], count_match, &matches[0]);
+            arena_reset(&a);
+        }
+        times[1] = now() - start;
+
+        JSONQuery *q = json_query_compile(&a, paths[i], &error);
+        ArenaMark mark = arena_mark(&a);
+
+        start = now();
+        for (size_t d = 0; d < documents; d++) {
+            json_query_each(q, &roots[d], count_match, &matches[1]);
+        }
+        times[2] = now() - start;
+
+        start = now();
+        for (size_t d = 0; d < documents; d++) {
+            JSONElement root =
+                json_parse_buffer(&a, docs[d], lengths[d], &parse_error);
+            json_query_each(q, &root, count_match, &matches[2]);
+            arena_rewind(&a, mark);
+        }
+        times[3] = now() - start;
+
+        // Straight off the tokenizer, skipping what can't match
+        start = now();
+        for (size_t d = 0; d < documents; d++) {
+            json_query_stream(&a, q, docs[d], lengths[d], count_match,
+                              &matches[3], &error);
+            arena_rewind(&a, mark);
+        }
+        times[4] = now() - start;
+
+        printf("%-22s", paths[i]);
+        for (size_t j = 0; j < 5; j++) {
+            printf(" %10.1f", times[j] / documents * 1e9);
+        }
+        printf("\n");
+
+        if (matches[0] != matches[1] || matches[1] != matches[2] ||
+            matches[2] != matches[3]) {
+            printf("Match counts differ\n");
+        }
+        arena_reset(&a);
+    }
+
+    arena_free(&a);
+    arena_free(&trees);
+    free(roots);
+    for (size_t i = 0; i < documents; i++) {
+        free(docs[i]);
+    }
+    free(docs);
+    free(lengths);
+    return 0;
+}
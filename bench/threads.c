@@ -0,0 +1,172 @@
+/*
+    Thread benchmark and stress test: many small documents parsed and
+    written back from a doubling number of threads, as a server would, with
+    each thread's arena taking its regions from its own pool vs from malloc.
+    Every result is checked against a serial run.
+
+    Usage: ./threads [documents] [max threads]
+*/
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/parser.h"
+#include "../include/utils.h"
+
+typedef struct {
+    char **docs;
+    size_t *lengths;
+    size_t *expected;  // Hash of each document written back serially
+    size_t documents;
+    size_t threads;
+    bool pooled;
+    atomic_size_t failed;
+    atomic_size_t allocations;
+} Job;
+
+typedef struct {
+    Job *job;
+    size_t index;
+} Worker;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// One order, as an API would return it
+static size_t generate(char *buf, size_t i) {
+    size_t n = sprintf(buf,
+                       "{\"id\": %zu, \"user\": {\"id\": %zu, \"name\": "
+                       "\"user %zu\", \"address\": {\"street\": \"%zu Main "
+                       "St\", \"city\": \"City %zu\", \"zip\": \"%05zu\"}}, "
+                       "\"items\": [",
+                       i, i % 1000, i % 1000, i, i % 50, i % 100000);
+    for (size_t j = 0; j < 8; j++) {
+        n += sprintf(buf + n,
+                     "%s{\"id\": %zu, \"sku\": \"SKU-%zu\", \"price\": "
+                     "%zu.99, \"tags\": [\"a\", \"b\", \"c\"]}",
+                     j ? ", " : "", j, i * 8 + j, j * 3);
+    }
+    n += sprintf(buf + n, "], \"note\": \"%s\"}",
+                 i % 2 ? "leave at the door" : "call on arrival");
+    return n;
+}
+
+// Parses and writes back every threads-th document, freeing the arena
+// after each one as a request handler would
+static void *work(void *arg) {
+    Worker *w = arg;
+    Job *job = w->job;
+
+    ArenaPool pool = {0};
+    Arena a = {.pool = job->pooled ? &pool : NULL};
+    size_t failed = 0;
+    size_t allocations = 0;
+    for (size_t d = w->index; d < job->documents; d += job->threads) {
+        JSONError error;
+        JSONElement root =
+            json_parse_buffer(&a, job->docs[d], job->lengths[d], &error);
+        char *out = error.code ? NULL : json_stringify(&a, root);
+        if (out == NULL || hash_bytes(out, strlen(out)) != job->expected[d]) {
+            ++failed;
+        }
+        allocations += a.allocations;
+        arena_free(&a);
+    }
+    arena_pool_free(&pool);
+
+    atomic_fetch_add(&job->failed, failed);
+    atomic_fetch_add(&job->allocations, allocations);
+    return NULL;
+}
+
+static double run(Job *job, size_t threads, bool pooled) {
+    job->threads = threads;
+    job->pooled = pooled;
+    atomic_store(&job->failed, 0);
+    atomic_store(&job->allocations, 0);
+
+    Worker *workers = malloc(threads * sizeof(Worker));
+    for (size_t i = 0; i < threads; i++) {
+        workers[i] = (Worker){.job = job, .index = i};
+    }
+
+    double start = now();
+    run_threads(work, workers, threads, sizeof(Worker));
+    double elapsed = now() - start;
+
+    free(workers);
+    return elapsed;
+}
+
+int main(int argc, char *argv[]) {
+    size_t documents = argc > 1 ? strtoul(argv[1], NULL, 10) : 200000;
+    size_t max_threads = argc > 2 ? strtoul(argv[2], NULL, 10)
+                                  : thread_count(0);
+
+    Job job = {.documents = documents};
+    job.docs = malloc(documents * sizeof(char *));
+    job.lengths = malloc(documents * sizeof(size_t));
+    job.expected = malloc(documents * sizeof(size_t));
+
+    size_t bytes = 0;
+    char buf[4096];
+    Arena a = {0};
+    for (size_t i = 0; i < documents; i++) {
+        job.lengths[i] = generate(buf, i);
+        job.docs[i] = malloc(job.lengths[i]);
+        memcpy(job.docs[i], buf, job.lengths[i]);
+        bytes += job.lengths[i];
+
+        JSONError error;
+        JSONElement root = json_parse_buffer(&a, buf, job.lengths[i], &error);
+        if (error.code) return 1;
+        char *out = json_stringify(&a, root);
+        job.expected[i] = hash_bytes(out, strlen(out));
+        arena_reset(&a);
+    }
+    arena_free(&a);
+    double mb = bytes / (double)(1 << 20);
+
+    printf("%zu documents, %.1f MiB\n", documents, mb);
+    printf("%-8s %12s %10s %12s %10s %10s\n", "threads", "pooled MB/s",
+           "speedup", "malloc MB/s", "speedup", "mallocs");
+
+    double pooled_base = 0, malloc_base = 0;
+    int failed = 0;
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        double pooled = mb / run(&job, threads, true);
+        size_t allocations = atomic_load(&job.allocations);
+        size_t pooled_failed = atomic_load(&job.failed);
+        double malloced = mb / run(&job, threads, false);
+        size_t malloc_failed = atomic_load(&job.failed);
+
+        if (threads == 1) {
+            pooled_base = pooled;
+            malloc_base = malloced;
+        }
+        printf("%-8zu %12.1f %9.2fx %12.1f %9.2fx %10zu\n", threads, pooled,
+               pooled / pooled_base, malloced, malloced / malloc_base,
+               allocations);
+
+        if (pooled_failed || malloc_failed) {
+            printf("%zu pooled and %zu malloc'd documents differ from the "
+                   "serial run\n",
+                   pooled_failed, malloc_failed);
+            failed = 1;
+        }
+    }
+
+    for (size_t i = 0; i < documents; i++) {
+        free(job.docs[i]);
+    }
+    free(job.docs);
+    free(job.lengths);
+    free(job.expected);
+    return failed;
+}
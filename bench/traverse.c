@@ -0,0 +1,174 @@
+/*
+    Traversal benchmark: linked-list DOM vs flat DOM
+
+    Usage: ./traverse <file> [iterations]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../include/flat.h"
+#include "../include/parser.h"
+#include "../include/utils.h"
+
+typedef struct {
+    size_t nodes;
+    double sum;
+} Totals;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void walk_element(JSONElement element, Totals *totals) {
+    ++totals->nodes;
+    switch (element.type) {
+        case JSON_ELEMENT_OBJECT:
+            for_each_pair(element.element.object, pair) {
+                totals->sum += pair->key.length;
+                walk_element(pair->value, totals);
+            }
+            break;
+        case JSON_ELEMENT_ARRAY:
+            for_each_element(element.element.array, item) {
+                walk_element(item->element, totals);
+            }
+            break;
+        case JSON_ELEMENT_VALUE:
+            switch (element.element.value.type) {
+                case JSON_VALUE_STRING:
+                    totals->sum += element.element.value.value.string.length;
+                    break;
+                case JSON_VALUE_NUMBER_INT:
+                    totals->sum += element.element.value.value.number_int;
+                    break;
+                case JSON_VALUE_NUMBER_UINT:
+                    totals->sum += element.element.value.value.number_uint;
+                    break;
+                case JSON_VALUE_NUMBER_FLOAT:
+                    totals->sum += element.element.value.value.number_float;
+                    break;
+                default:
+                    break;
+            }
+            break;
+        case JSON_ELEMENT_END:
+            break;
+    }
+}
+
+static void walk_node(const JSONNode *node, Totals *totals) {
+    ++totals->nodes;
+    switch (node->type) {
+        case JSON_NODE_OBJECT:
+            for_each_node_pair(node, key, value) {
+                totals->sum += key->count;
+                walk_node(value, totals);
+            }
+            break;
+        case JSON_NODE_ARRAY:
+            for_each_node(node, child) { walk_node(child, totals); }
+            break;
+        case JSON_NODE_STRING:
+            totals->sum += node->count;
+            break;
+        case JSON_NODE_INT:
+            totals->sum += node->value.number_int;
+            break;
+        case JSON_NODE_UINT:
+            totals->sum += node->value.number_uint;
+            break;
+        case JSON_NODE_FLOAT:
+            totals->sum += node->value.number_float;
+            break;
+    }
+}
+
+// Indexed access into the root array, walking the list for every lookup
+static JSONElement *list_get(JSONArray *array, size_t index) {
+    for_each_element(array, item) {
+        if (index-- == 0) return &item->element;
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 2 && argc != 3) {
+        printf("Usage: %s <file> [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    int iterations = argc == 3 ? atoi(argv[2]) : 10;
+
+    FileContent file;
+    if (map_file_content(argv[1], &file)) {
+        printf("Failed to read file %s\n", argv[1]);
+        return 1;
+    }
+
+    Arena list_arena = {0};
+    Arena flat_arena = {0};
+    JSONError parse_error;
+
+    JSONElement root = json_parse_buffer(&list_arena, file.data, file.size,
+                                         &parse_error);
+    if (parse_error.code) return 1;
+    JSONNode *flat = json_parse_flat(&flat_arena, file.data, file.size,
+                                     &parse_error);
+    if (flat == NULL) return 1;
+
+    Totals list_totals = {0};
+    double start = now();
+    for (int i = 0; i < iterations; i++) {
+        walk_element(root, &list_totals);
+    }
+    double list_time = (now() - start) / iterations;
+
+    Totals flat_totals = {0};
+    start = now();
+    for (int i = 0; i < iterations; i++) {
+        walk_node(flat, &flat_totals);
+    }
+    double flat_time = (now() - start) / iterations;
+
+    size_t nodes = list_totals.nodes / iterations;
+    printf("walk   list %8.3f ms  flat %8.3f ms  (%zu nodes, %.1f ns vs "
+           "%.1f ns per node)\n",
+           list_time * 1e3, flat_time * 1e3, nodes, list_time * 1e9 / nodes,
+           flat_time * 1e9 / nodes);
+    if (list_totals.nodes != flat_totals.nodes ||
+        list_totals.sum != flat_totals.sum) {
+        printf("checksum mismatch\n");
+        return 1;
+    }
+
+    // Random access, only meaningful when the root is an array
+    size_t size = json_node_size(flat);
+    if (flat->type == JSON_NODE_ARRAY && size > 0) {
+        size_t lookups = 1000;
+        volatile size_t sink = 0;
+
+        start = now();
+        for (size_t i = 0; i < lookups; i++) {
+            sink += list_get(root.element.array, (i * 7919) % size)->type;
+        }
+        double list_get_time = (now() - start) / lookups;
+
+        start = now();
+        for (size_t i = 0; i < lookups; i++) {
+            sink += json_node_get(flat, (i * 7919) % size)->type;
+        }
+        double flat_get_time = (now() - start) / lookups;
+
+        printf("get(i) list %8.1f ns  flat %8.1f ns  (%zu elements)\n",
+               list_get_time * 1e9, flat_get_time * 1e9, size);
+    }
+
+    arena_free(&list_arena);
+    arena_free(&flat_arena);
+    unmap_file_content(&file);
+    return 0;
+}
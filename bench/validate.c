@@ -0,0 +1,70 @@
+/*
+    Validation benchmark: checking documents with json_validate vs parsing
+    them, which is what answering "is this valid?" took before
+
+    Usage: ./validate <file>...
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/utils.h"
+#include "../include/validate.h"
+
+#define RUNS 5
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <file>...\n", argv[0]);
+        return 1;
+    }
+
+    printf("%-24s %12s %12s %10s\n", "file", "parse MB/s", "valid MB/s",
+           "speedup");
+
+    for (int i = 1; i < argc; i++) {
+        FileContent file;
+        if (map_file_content(argv[i], &file)) {
+            fprintf(stderr, "Failed to read file %s\n", argv[i]);
+            return 1;
+        }
+        double mb = file.size / (double)(1 << 20);
+
+        // Fastest of RUNS, the arena keeps its regions between them
+        Arena a = {0};
+        JSONError error;
+        double parse = 0;
+        for (int run = 0; run < RUNS; run++) {
+            arena_reset(&a);
+            double start = now();
+            json_parse_buffer(&a, file.data, file.size, &error);
+            double elapsed = now() - start;
+            if (error.code) return 1;
+            parse = run == 0 || elapsed < parse ? elapsed : parse;
+        }
+        arena_free(&a);
+
+        double validate = 0;
+        for (int run = 0; run < RUNS; run++) {
+            double start = now();
+            json_validate(file.data, file.size, &error);
+            double elapsed = now() - start;
+            if (error.code) return 1;
+            validate = run == 0 || elapsed < validate ? elapsed : validate;
+        }
+
+        const char *name = strrchr(argv[i], '/');
+        printf("%-24s %12.1f %12.1f %9.2fx\n", name ? name + 1 : argv[i],
+               mb / parse, mb / validate, parse / validate);
+        unmap_file_content(&file);
+    }
+    return 0;
+}
@@ -1,16 +1,12 @@
+#include <string.h>
+#include <sys/resource.h>
 #include <time.h>
 
 #include "../include/parser.h"
+#include "../include/push.h"
+#include "../include/sax.h"
 #include "../include/tokenizer.h"
-
-// JSONElement *json_object_get(JSONObject *object, char *key) {
-//     for (size_t i = 0; i < object->pair_count; i++) {
-//         if (strcmp(object->first[i].key, key) == 0) {
-//             return &object->first[i].value;
-//         }
-//     }
-//     return NULL;
-// }
+#include "../include/utils.h"
 
 // JSONElement *json_array_get(JSONArray *array, size_t index) {
 //     if (index >= array->element_count) {
@@ -19,27 +15,108 @@
 //     return &array->first[index];
 // }
 
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        printf("Usage: %s <file>\n", argv[0]);
+    // By default the file is mapped and parsed in place. --read copies it
+    // to the heap first and --two-phase also tokenizes the whole document
+    // before building the tree. --push feeds it to the push parser in
+    // 64 KiB chunks as it's read, and --events only walks it without
+    // building a tree.
+    const char *mode = argc == 3 ? argv[1] : "";
+    if ((argc != 2 && argc != 3) ||
+        (argc == 3 && strcmp(mode, "--read") != 0 &&
+         strcmp(mode, "--two-phase") != 0 && strcmp(mode, "--push") != 0 &&
+         strcmp(mode, "--events") != 0)) {
+        printf("Usage: %s [--read | --two-phase | --push | --events] <file>\n",
+               argv[0]);
         return 1;
     }
 
-    char *file_name = argv[1];
+    char *file_name = argv[argc - 1];
 
     Arena a = {0};
-    int error = 0;
+    JSONError error = {0};
+    int failed = 0;
+
+    double start = now();
+
+    if (argc == 2) {
+        JSONElement json = json_parse_file(&a, file_name, &error);
+        (void)json;
+    } else if (strcmp(mode, "--events") == 0) {
+        FileContent content;
+        if (map_file_content(file_name, &content)) {
+            printf("Failed to read file %s\n", file_name);
+            return 1;
+        }
+
+        JSONCallbacks callbacks = {0};
+        failed = json_parse_events(&a, content.data, content.size,
+                                   &callbacks, NULL, &error);
+        unmap_file_content(&content);
+    } else if (strcmp(mode, "--push") == 0) {
+        FILE *file = fopen(file_name, "rb");
+        if (file == NULL) {
+            printf("Failed to read file %s\n", file_name);
+            return 1;
+        }
+
+        JSONPushParser p;
+        json_parser_init(&p, &a);
+
+        static char chunk[1 << 16];
+        size_t n;
+        while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+            if (json_parser_feed(&p, chunk, n)) break;
+        }
+        fclose(file);
 
-    clock_t t;
-    t = clock();
+        JSONElement json = json_parser_finish(&p, &error);
+        (void)json;
+    } else {
+        char *content = read_file_content(file_name);
+        if (content == NULL) {
+            printf("Failed to read file %s\n", file_name);
+            return 1;
+        }
 
-    JSONElement json = json_parse_file(&a, file_name, &error);
-    (void)json;
-    if (error != 0) {
+        JSONElement json = strcmp(mode, "--two-phase") == 0
+                               ? json_parse_tokenized(&a, content, &error)
+                               : json_parse(&a, content, &error);
+        (void)json;
+        free(content);
+    }
+
+    if (error.code != JSON_ERROR_NONE) {
+        char message[256];
+        json_error_format(&error, file_name, message, sizeof(message));
+        fprintf(stderr, "%s\n", message);
+        return 1;
+    }
+    if (failed) {
         return 1;
     }
 
-    t = clock() - t;
-    printf("done %f\n", (double)t / CLOCKS_PER_SEC);
+    double elapsed = now() - start;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    // ru_maxrss is in kilobytes on Linux and bytes on macOS
+#ifdef __APPLE__
+    long peak_kb = usage.ru_maxrss / 1024;
+#else
+    long peak_kb = usage.ru_maxrss;
+#endif
+
+    printf("done %s %f s, peak rss %ld KiB\n", argc == 2 ? "--mmap" : mode,
+           elapsed, peak_kb);
+
+    arena_free(&a);
     return 0;
-}
\ No newline at end of file
+}
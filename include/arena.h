@@ -6,25 +6,90 @@
 #define ARENA_H
 
 #include <assert.h>
+#include <stdalign.h>
+#include <stddef.h>
 #include <stdlib.h>
 
 #define REGION_CAPACITY ((size_t)1 << 16)
+#define REGION_MAX_CAPACITY ((size_t)1 << 26)
+#define ARENA_ALIGNMENT alignof(max_align_t)
 #define MAX(a, b) (a > b ? a : b)
 
 typedef struct Region {
     struct Region *next;
-    size_t capacity;
-    size_t size;
-    void *data[];
+    size_t capacity;  // Bytes of data
+    size_t size;      // Bytes of data in use, including alignment padding
+    unsigned char data[];
 } region_t;
 
+// Regions given back by arenas, for other arenas to take instead of
+// calling malloc. A pool isn't locked, each thread keeps its own. Regions
+// can still move between threads with arena_merge, they are plain malloc
+// blocks. A zeroed ArenaPool is empty and keeps every region given to it.
+typedef struct {
+    region_t *free;  // Unused regions, largest first
+    size_t regions;
+    size_t bytes;    // Of region data in free
+    size_t limit;    // Most bytes kept, 0 for no limit. Regions past it
+                     // are freed.
+} ArenaPool;
+
+// A zeroed Arena is empty and ready to use. Regions start at
+// REGION_CAPACITY bytes and double up to REGION_MAX_CAPACITY, a larger
+// allocation gets a region of its own. With a pool set, new regions come
+// from the pool when one is large enough and arena_free gives them back.
 typedef struct {
     region_t *first;
-    region_t *last;
+    region_t *last;     // Tail of the region list
+    region_t *current;  // Region allocations are served from
+    size_t alignment;   // Default alignment, ARENA_ALIGNMENT when 0
+    size_t step;        // Capacity of the last region that wasn't oversized
+    size_t used;        // Bytes handed out since the last reset
+    size_t wasted;      // Padding and region tails skipped since the reset
+    size_t allocations;  // Regions ever malloc'd by this arena
+    size_t grow_nanoseconds;  // Spent malloc'ing them, timed with JSON_STATS
+    ArenaPool *pool;          // May be NULL
 } Arena;
 
+// Savepoint returned by arena_mark
+typedef struct {
+    region_t *region;
+    size_t size;
+    size_t used;
+    size_t wasted;
+} ArenaMark;
+
+typedef struct {
+    size_t regions;
+    size_t reserved;  // Bytes of region data owned by the arena
+    size_t used;
+    size_t wasted;
+    size_t allocations;
+} ArenaStats;
+
 void *arena_alloc(Arena *a, size_t size);
+// alignment must be a power of two
+void *arena_alloc_aligned(Arena *a, size_t size, size_t alignment);
 char *arena_alloc_str(Arena *a, const char *str);
+
+// Forgets every allocation but keeps the regions, so an arena reset between
+// documents stops calling malloc once it has grown to fit the largest one
+void arena_reset(Arena *a);
+// Frees everything allocated since mark was taken. Regions added since then
+// are kept for reuse, like arena_reset.
+ArenaMark arena_mark(const Arena *a);
+void arena_rewind(Arena *a, ArenaMark mark);
+
+// Moves every region of src into dst, which then owns its allocations, and
+// leaves src empty. Allocation carries on from src's last region.
+void arena_merge(Arena *dst, Arena *src);
+
+void arena_stats(const Arena *a, ArenaStats *stats);
+// Frees every region, or gives them to the arena's pool. The arena is
+// left empty with its pool and alignment still set.
 void arena_free(Arena *a);
 
+// Frees the regions the pool holds
+void arena_pool_free(ArenaPool *pool);
+
 #endif  // ARENA_H
@@ -0,0 +1,112 @@
+/*
+    Binary documents that are used straight from a mapped file
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "parser.h"
+#include "utils.h"
+#include "writer.h"
+
+#define JSON_BINARY_MAGIC "JSONBIN"
+#define JSON_BINARY_VERSION 1
+// Written in the producer's byte order, a reader on the other order sees
+// it reversed and refuses the file
+#define JSON_BINARY_BYTE_ORDER 0x01020304u
+
+typedef enum {
+    JSON_BINARY_OBJECT,
+    JSON_BINARY_ARRAY,
+    JSON_BINARY_STRING,
+    JSON_BINARY_INT,
+    JSON_BINARY_UINT,
+    JSON_BINARY_FLOAT,
+    JSON_BINARY_NUMBER,  // Raw digits, see json_parse_exact
+    JSON_BINARY_BOOLEAN,
+    JSON_BINARY_NULL,
+} JSONBinaryType;
+
+// 16 bytes per node, laid out like the flat DOM (see flat.h): the children
+// of a container are one block of nodes, objects alternate key and value
+// nodes. Containers and strings refer to their block or bytes by an offset
+// from the node itself, so the file works wherever it is mapped.
+typedef struct {
+    uint32_t type;
+    uint32_t count;  // Elements, pairs or string bytes
+    union {
+        int64_t offset;
+        int64_t number_int;
+        uint64_t number_uint;
+        double number_float;
+        uint64_t boolean;
+    } value;
+} JSONBinaryNode;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t size;  // Bytes in the document, header included
+    JSONBinaryNode root;
+} JSONBinaryHeader;
+
+typedef struct {
+    FileContent file;  // Empty when opened on a caller's buffer
+    const JSONBinaryHeader *header;
+} JSONBinary;
+
+#define for_each_binary_node(arr, node_var)                        \
+    for (const JSONBinaryNode *node_var = json_binary_children(arr); \
+         node_var < json_binary_children(arr) + (arr)->count; ++node_var)
+
+#define for_each_binary_pair(obj, key_var, value_var)                  \
+    for (const JSONBinaryNode *key_var = json_binary_children(obj),    \
+                              *value_var = key_var + 1;                \
+         key_var < json_binary_children(obj) + 2 * (size_t)(obj)->count; \
+         key_var += 2, value_var += 2)
+
+// Encodes the tree into a malloc'd buffer of *size bytes. A string or
+// container too long for a node's 32-bit count is JSON_ERROR_SIZE. Returns
+// non-zero on error, with error filled in.
+int json_binary_encode(JSONElement root, char **data, size_t *size,
+                       JSONError *error);
+int json_binary_save(JSONElement root, const char *file_name,
+                     JSONError *error);
+
+// Maps the file, nothing is read until it is used. Only the header is
+// checked: the nodes are trusted, and offsets in a corrupt file are followed
+// out of bounds. Call json_binary_verify before reading a file this program
+// didn't write. Returns non-zero on error, a JSON_ERROR_BINARY if the header
+// doesn't match this build's version and byte order or the file is shorter
+// than it says.
+int json_binary_load(JSONBinary *doc, const char *file_name,
+                     JSONError *error);
+// Uses size bytes of data, 8-byte aligned, which must outlive doc. Trusted
+// like a loaded file.
+int json_binary_open(JSONBinary *doc, const char *data, size_t size,
+                     JSONError *error);
+// Reads the whole document once and checks every offset and count against
+// the size in the header, node types, and that numbers are JSON numbers.
+// Blocks and strings must be laid out in the order json_binary_encode
+// writes them. Returns non-zero on a JSON_ERROR_BINARY at the offending
+// node's offset.
+int json_binary_verify(const JSONBinary *doc, JSONError *error);
+void json_binary_close(JSONBinary *doc);
+
+const JSONBinaryNode *json_binary_root(const JSONBinary *doc);
+const JSONBinaryNode *json_binary_children(const JSONBinaryNode *node);
+// Strings and raw numbers, NUL-terminated
+JSONString json_binary_string(const JSONBinaryNode *node);
+
+const JSONBinaryNode *json_binary_at(const JSONBinaryNode *array,
+                                     size_t index);
+// The value of the first pair with a matching key, or NULL
+const JSONBinaryNode *json_binary_get(const JSONBinaryNode *object,
+                                      const char *key);
+const JSONBinaryNode *json_binary_get_n(const JSONBinaryNode *object,
+                                        const char *key, size_t length);
+
+// Writes the node back as JSON text. Floats are exact when w->exact is set.
+int json_binary_write(JSONWriter *w, const JSONBinaryNode *node);
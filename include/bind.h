@@ -0,0 +1,93 @@
+/*
+    Decoding into and encoding from C structs
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tokenizer.h"
+#include "writer.h"
+
+#define JSON_STRUCT_MAX_FIELDS 64
+// Size of the largest perfect hash table, a power of two
+#define JSON_STRUCT_MAX_SLOTS 256
+
+typedef enum {
+    JSON_FIELD_BOOL,    // bool
+    JSON_FIELD_INT,     // int
+    JSON_FIELD_INT64,   // long long
+    JSON_FIELD_DOUBLE,  // double, integers are converted
+    JSON_FIELD_STRING,  // JSONString, data is NULL when null
+    JSON_FIELD_STRUCT,  // Nested struct described by the field's object
+    JSON_FIELD_ARRAY,   // Pointer to elements of the field's element type,
+                        // with their count in a size_t at count_offset
+} JSONFieldType;
+
+struct JSONStruct;
+
+typedef struct {
+    const char *name;
+    size_t offset;
+    JSONFieldType type;
+    JSONFieldType element;      // Arrays only, JSON_FIELD_ARRAY isn't allowed
+    size_t count_offset;        // Arrays only
+    struct JSONStruct *object;  // Structs, and arrays of structs
+} JSONField;
+
+// Fields are matched by a perfect hash of their names, found once by
+// json_struct_init
+typedef struct JSONStruct {
+    size_t size;
+    const JSONField *fields;
+    size_t field_count;
+
+    bool ready;
+    uint32_t seed;
+    uint32_t mask;
+    uint8_t slots[JSON_STRUCT_MAX_SLOTS];  // Field index + 1, 0 when empty
+} JSONStruct;
+
+// Field table entries for a member of struct_type, named as in the JSON.
+// Array descriptors are a pointer, NULL unless the elements are structs.
+#define JSON_BIND_FIELD(struct_type, member, field_type)       \
+    {.name = #member, .offset = offsetof(struct_type, member), \
+     .type = field_type}
+
+#define JSON_BIND_STRUCT(struct_type, member, descriptor)      \
+    {.name = #member, .offset = offsetof(struct_type, member), \
+     .type = JSON_FIELD_STRUCT, .object = &(descriptor)}
+
+#define JSON_BIND_ARRAY(struct_type, member, count, element_type, \
+                        descriptor)                               \
+    {.name = #member, .offset = offsetof(struct_type, member),    \
+     .type = JSON_FIELD_ARRAY, .element = element_type,           \
+     .count_offset = offsetof(struct_type, count), .object = descriptor}
+
+#define JSON_BIND(struct_type, field_table)              \
+    {.size = sizeof(struct_type), .fields = field_table, \
+     .field_count = sizeof(field_table) / sizeof((field_table)[0])}
+
+// Finds the perfect hash of s and of every struct nested in it. Must be
+// called before the descriptor is first used, after that it is read-only
+// and can be shared between threads. Returns non-zero with a
+// JSON_ERROR_STRUCT if s has too many fields, two with the same name or one
+// with an invalid type, in which case error->field names it.
+int json_struct_init(JSONStruct *s, JSONError *error);
+
+// The field named key, or NULL
+const JSONField *json_struct_field(const JSONStruct *s, const char *key,
+                                   size_t length);
+
+// Decodes the object in len bytes of buf straight into out, a struct
+// described by s, without building a tree. out is zeroed first, so missing
+// fields and nulls are left zero and unknown keys are skipped. Strings
+// without escapes are borrowed from buf, other strings and arrays are
+// allocated in a. Returns non-zero on error, with error filled in. A value
+// of the wrong type is a JSON_ERROR_SYNTAX naming its field.
+int json_decode(Arena *a, const JSONStruct *s, const char *buf, size_t len,
+                void *out, JSONError *error);
+
+// Writes the struct at in as an object with the fields in descriptor order
+int json_encode(JSONWriter *w, const JSONStruct *s, const void *in);
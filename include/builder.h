@@ -0,0 +1,32 @@
+/*
+    DOM builder
+*/
+
+#pragma once
+
+#include "parser.h"
+#include "sax.h"
+
+typedef struct {
+    JSONElement container;
+    JSONString key;  // Key of the pair whose value comes next
+} JSONBuilderFrame;
+
+// Consumes parser events (see json_builder_callbacks) and builds the
+// JSONElement tree in the arena. Event strings are stored as given, so they
+// must already live as long as the tree.
+typedef struct {
+    Arena *arena;
+    JSONElement root;
+    const struct JSONInternPool *intern;  // Pool the keys come from, if any
+
+    // Containers still open, innermost last. Only the frames below depth
+    // are read, so the stack is never cleared and the builder owns nothing
+    // that needs freeing.
+    JSONBuilderFrame stack[JSON_MAX_DEPTH];
+    size_t depth;
+} JSONBuilder;
+
+extern const JSONCallbacks json_builder_callbacks;
+
+void json_builder_init(JSONBuilder *b, Arena *a);
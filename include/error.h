@@ -0,0 +1,49 @@
+/*
+    Parse errors
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+typedef enum {
+    JSON_ERROR_NONE,
+    JSON_ERROR_SYNTAX,    // A token other than the one expected
+    JSON_ERROR_STRING,    // Unterminated, or longer than MAX_STRING_LENGTH
+    JSON_ERROR_NUMBER,    // Malformed, or a float out of range
+    JSON_ERROR_LITERAL,   // Unknown character, or a misspelled true/false/null
+    JSON_ERROR_DEPTH,     // Nested deeper than JSON_MAX_DEPTH
+    JSON_ERROR_MEMORY,
+    JSON_ERROR_IO,        // A file couldn't be read or written
+    JSON_ERROR_ARGUMENT,  // No input, e.g. a NULL buffer
+    JSON_ERROR_SIZE,      // Past a format limit, e.g. 2^32 bytes for lazy
+    JSON_ERROR_BINARY,    // Not a binary document this build can read
+    JSON_ERROR_STRUCT,    // A bound struct that can't be used, see bind.h
+} JSONErrorCode;
+
+// Filled in by the parser instead of printing anything. A zeroed JSONError
+// means no error.
+typedef struct {
+    JSONErrorCode code;
+    size_t offset;  // Byte of the input the error was found at
+    // Worked out from offset when the error is set, nothing keeps track of
+    // lines while parsing
+    size_t line;
+    size_t col;
+    // For JSON_ERROR_SYNTAX, e.g. "',' or ']'" and "string". got is NULL
+    // when there's no token to name, e.g. in a query.
+    const char *expected;
+    const char *got;
+    const char *field;  // The bound field the error is about, or NULL
+} JSONError;
+
+// Sets error unless it is already set, the first error is the one that
+// counts. content is the whole input, to find the line and column in.
+void json_error_set(JSONError *error, JSONErrorCode code, const char *content,
+                    size_t offset);
+const char *json_error_string(JSONErrorCode code);
+// Writes "source:line:col: message" into buf, or "source: message" for
+// errors that aren't at a place in the input. source may be NULL. Returns
+// the length of the whole message, like snprintf.
+int json_error_format(const JSONError *error, const char *source, char *buf,
+                      size_t size);
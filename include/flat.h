@@ -0,0 +1,62 @@
+/*
+    Flat DOM with contiguous children
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "tokenizer.h"
+
+// ---------
+// JSON Node
+// ---------
+
+typedef enum {
+    JSON_NODE_OBJECT,
+    JSON_NODE_ARRAY,
+    JSON_NODE_STRING,
+    JSON_NODE_INT,
+    JSON_NODE_UINT,
+    JSON_NODE_FLOAT,
+    JSON_NODE_BOOLEAN,
+    JSON_NODE_NULL,
+} JSONNodeType;
+
+// 16 bytes per node. The children of a container sit next to each other in
+// one block, so indexing is O(1) and a node's next sibling is always the
+// following node (or the one after next inside objects). Objects store
+// their pairs as alternating key and value nodes.
+typedef struct JSONNode {
+    uint32_t type;
+    uint32_t count;  // Elements, pairs or string length
+    union {
+        struct JSONNode *children;
+        const char *string;
+        long long number_int;
+        unsigned long long number_uint;
+        double number_float;
+        bool boolean;
+    } value;
+} JSONNode;
+
+#define for_each_node(arr, node_var)                                       \
+    for (JSONNode *node_var = (arr)->value.children;                       \
+         node_var < (arr)->value.children + (arr)->count; ++node_var)
+
+#define for_each_node_pair(obj, key_var, value_var)                      \
+    for (JSONNode *key_var = (obj)->value.children, *value_var = key_var + 1; \
+         key_var < (obj)->value.children + 2 * (size_t)(obj)->count;     \
+         key_var += 2, value_var += 2)
+
+// Parses len bytes of buf into a flat tree. Like json_parse_buffer, strings
+// without escapes are borrowed from buf, which must outlive the tree. A
+// string or container too long for a node's 32-bit count is
+// JSON_ERROR_SIZE. Returns NULL on error, with error filled in.
+JSONNode *json_parse_flat(Arena *a, const char *buf, size_t len,
+                          JSONError *error);
+
+size_t json_node_size(const JSONNode *node);
+JSONNode *json_node_get(const JSONNode *array, size_t index);
+JSONNode *json_node_key(const JSONNode *object, size_t index);
+JSONNode *json_node_value(const JSONNode *object, size_t index);
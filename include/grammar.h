@@ -0,0 +1,52 @@
+/*
+    Structural JSON grammar, one token at a time
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "parser.h"
+
+// What the grammar allows next
+typedef enum {
+    JSON_EXPECT_VALUE,
+    JSON_EXPECT_VALUE_OR_CLOSE,  // Just after '['
+    JSON_EXPECT_KEY_OR_CLOSE,    // Just after '{'
+    JSON_EXPECT_KEY,
+    JSON_EXPECT_COLON,
+    JSON_EXPECT_ARRAY_NEXT,   // ',' or ']'
+    JSON_EXPECT_OBJECT_NEXT,  // ',' or '}'
+    JSON_EXPECT_END,
+} JSONExpect;
+
+// Checks the order of tokens and pairs up brackets for scanners that find
+// tokens themselves instead of going through the tokenizer
+typedef struct {
+    JSONExpect expect;
+    size_t depth;
+    size_t max_depth;
+    JSONExpect after[JSON_MAX_DEPTH + 1];  // What follows a value per depth
+} JSONGrammar;
+
+// What a token turned out to be. The grammar has already moved past it,
+// except on JSON_GRAMMAR_DEPTH and JSON_GRAMMAR_UNEXPECTED.
+typedef enum {
+    JSON_GRAMMAR_PUNCT,       // ',' or ':'
+    JSON_GRAMMAR_OPEN,        // '[' or '{', depth is one more
+    JSON_GRAMMAR_CLOSE,       // ']' or '}', depth is one less
+    JSON_GRAMMAR_KEY,         // '"' where a key goes
+    JSON_GRAMMAR_VALUE,       // A string, number or literal, unchecked
+    JSON_GRAMMAR_DEPTH,       // '[' or '{' nested deeper than max_depth
+    JSON_GRAMMAR_UNEXPECTED,  // Not allowed here
+} JSONGrammarStep;
+
+// max_depth is capped at JSON_MAX_DEPTH
+void json_grammar_init(JSONGrammar *g, size_t max_depth);
+// Steps over the token whose first byte is c
+JSONGrammarStep json_grammar_step(JSONGrammar *g, char c);
+// Whether a whole value has been seen, so the input may end
+bool json_grammar_done(const JSONGrammar *g);
+// What was expected, for error->expected
+const char *json_grammar_expected(const JSONGrammar *g);
@@ -0,0 +1,43 @@
+/*
+    String interning
+*/
+
+#pragma once
+
+#include "parser.h"
+
+typedef struct {
+    size_t hash;
+    JSONString string;  // Empty slot when data is NULL
+} JSONInternSlot;
+
+// Set of distinct strings, each stored once with its hash. A pool can be
+// shared by any number of documents parsed one after the other, so a batch
+// of records with the same keys holds a single copy of each. Pooled strings
+// live until json_intern_free. Not thread-safe.
+typedef struct JSONInternPool {
+    Arena strings;
+    JSONInternSlot *slots;  // Open addressing, capacity is a power of two
+    size_t capacity;
+    size_t count;
+    size_t max_value_length;  // String values up to this many bytes of
+                              // input are pooled along with keys
+
+    size_t lookups;  // Strings interned, distinct or not
+    size_t bytes;    // Length of the distinct strings
+} JSONInternPool;
+
+void json_intern_init(JSONInternPool *pool, size_t max_value_length);
+void json_intern_free(JSONInternPool *pool);
+
+// The pooled copy of length bytes of data, NUL-terminated. Equal strings
+// get the same address. data is NULL if the pool couldn't grow.
+JSONString json_intern(JSONInternPool *pool, const char *data, size_t length);
+// The hash of a string returned by json_intern, without rehashing it
+size_t json_intern_hash(JSONString interned);
+
+// Parses buf like json_parse, into a tree that doesn't refer to buf, with
+// every key and short string value taken from pool instead of copied into a
+JSONElement json_parse_interned(Arena *a, JSONInternPool *pool,
+                                const char *buf, size_t len,
+                                JSONError *error);
@@ -0,0 +1,99 @@
+/*
+    On-demand access to unparsed documents
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "parser.h"
+
+typedef enum {
+    JSON_LAZY_OBJECT,
+    JSON_LAZY_ARRAY,
+    JSON_LAZY_STRING,
+    JSON_LAZY_NUMBER,
+    JSON_LAZY_BOOLEAN,
+    JSON_LAZY_NULL,
+} JSONLazyType;
+
+// Structural index of a document: where every token starts, and where each
+// container ends so whole subtrees can be stepped over. Nothing is decoded
+// until it is read.
+typedef struct {
+    const char *buf;
+    size_t len;
+    uint32_t *offsets;  // Start of each token in buf
+    uint32_t *match;    // Closing token of each container, by opening token
+    uint32_t count;
+} JSONLazyDocument;
+
+// Handles are a token in a document, they can be copied freely and stay
+// valid as long as the document
+typedef struct {
+    const JSONLazyDocument *doc;
+    uint32_t token;
+} JSONLazyValue;
+
+typedef struct {
+    const JSONLazyDocument *doc;
+    uint32_t token;
+} JSONLazyObject;
+
+typedef struct {
+    const JSONLazyDocument *doc;
+    uint32_t token;
+} JSONLazyArray;
+
+// Walks the elements of an array or the pairs of an object
+typedef struct {
+    const JSONLazyDocument *doc;
+    uint32_t token;  // Next element or key
+    uint32_t end;    // Closing token of the container
+} JSONLazyIterator;
+
+// Indexes len bytes of buf, which must outlive the document. The nesting
+// and the order of tokens are checked, as are true, false and null, but
+// strings are only unescaped and numbers converted when they are read.
+// Unlike the tokenizer, single-quoted strings aren't accepted. Returns
+// non-zero with error filled in on error.
+int json_lazy_parse(JSONLazyDocument *doc, const char *buf, size_t len,
+                    JSONError *error);
+void json_lazy_free(JSONLazyDocument *doc);
+
+JSONLazyValue json_lazy_root(const JSONLazyDocument *doc);
+JSONLazyType json_lazy_type(JSONLazyValue value);
+// The value's text in the input, quotes and brackets included
+JSONString json_lazy_raw(JSONLazyValue value);
+// Parses the value into a tree, as json_parse_buffer would
+JSONElement json_lazy_element(Arena *a, JSONLazyValue value,
+                              JSONError *error);
+
+// Getters return false when the value holds another type or, for numbers,
+// isn't a valid literal. Strings without escapes are borrowed from the
+// input, others are unescaped into a. json_lazy_get_float also accepts
+// integers.
+bool json_lazy_get_object(JSONLazyValue value, JSONLazyObject *out);
+bool json_lazy_get_array(JSONLazyValue value, JSONLazyArray *out);
+bool json_lazy_get_string(Arena *a, JSONLazyValue value, JSONString *out);
+bool json_lazy_get_int(JSONLazyValue value, long long *out);
+bool json_lazy_get_float(JSONLazyValue value, double *out);
+bool json_lazy_get_bool(JSONLazyValue value, bool *out);
+bool json_lazy_is_null(JSONLazyValue value);
+
+// Lookups return the first pair with a matching key, stepping over the
+// values of the others without looking inside them
+bool json_lazy_object_get(JSONLazyObject object, const char *key,
+                          JSONLazyValue *out);
+bool json_lazy_object_get_n(JSONLazyObject object, const char *key,
+                            size_t length, JSONLazyValue *out);
+size_t json_lazy_object_count(JSONLazyObject object);
+JSONLazyIterator json_lazy_object_iter(JSONLazyObject object);
+bool json_lazy_object_next(JSONLazyIterator *it, JSONLazyValue *key,
+                           JSONLazyValue *value);
+
+bool json_lazy_array_at(JSONLazyArray array, size_t index,
+                        JSONLazyValue *out);
+size_t json_lazy_array_count(JSONLazyArray array);
+JSONLazyIterator json_lazy_array_iter(JSONLazyArray array);
+bool json_lazy_array_next(JSONLazyIterator *it, JSONLazyValue *value);
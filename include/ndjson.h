@@ -0,0 +1,36 @@
+/*
+    Newline-delimited JSON
+*/
+
+#pragma once
+
+#include "parser.h"
+
+// Bytes of input handed to a worker at a time, cut at the next newline
+#define JSON_NDJSON_CHUNK_SIZE ((size_t)1 << 20)
+
+typedef struct {
+    JSONElement root;
+    size_t offset;  // Where the record's line starts in the input
+    JSONError error;  // Set if the line isn't valid JSON, root is empty.
+                      // Its offset is from the start of the line.
+} JSONRecord;
+
+// Called once per record from the worker threads, in no particular order.
+// The tree lives in the worker's arena a until the callback returns, and a
+// non-zero return stops the parse.
+typedef int (*JSONRecordFn)(void *context, const JSONRecord *record,
+                            Arena *a);
+
+// Parses every non-blank line of buf as one document on threads workers
+// (one per online CPU when 0), each with its own arena. The records are
+// returned in input order, their trees merged into a. Like
+// json_parse_buffer, strings are borrowed from buf. error is set if any
+// record failed, or if the workers couldn't be started.
+JSONRecord *json_parse_ndjson(Arena *a, const char *buf, size_t len,
+                              size_t threads, size_t *count, int *error);
+
+// Streams the records of buf to fn instead, nothing outlives the call.
+// Returns non-zero if any record failed or fn stopped the parse.
+int json_parse_ndjson_each(const char *buf, size_t len, size_t threads,
+                           JSONRecordFn fn, void *context);
@@ -0,0 +1,37 @@
+/*
+    Allocation-free JSON number parsing
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef enum {
+    JSON_NUMBER_OK,
+    JSON_NUMBER_INVALID,  // Doesn't follow the JSON number grammar
+    JSON_NUMBER_RANGE,    // Float is infinite
+} JSONNumberStatus;
+
+typedef struct {
+    bool is_float;
+    bool is_unsigned;  // Integer above LLONG_MAX, in number_uint
+    union {
+        long long number_int;
+        unsigned long long number_uint;
+        double number_float;
+    } value;
+} JSONNumber;
+
+// Parses the JSON number starting at p, reading no further than end. The
+// number of bytes it spans is stored in length. Integers are accumulated
+// while scanning, and those that don't fit a long long or an unsigned long
+// long are converted like anything with a fraction or exponent: to the
+// nearest double, matching strtod exactly.
+JSONNumberStatus json_number_parse(const char *p, const char *end,
+                                   JSONNumber *n, size_t *length);
+
+// Length of the JSON number starting at p, or 0 if it doesn't follow the
+// grammar. Only the grammar is checked, nothing is converted, so a number
+// too large for a double still has a length.
+size_t json_number_length(const char *p, const char *end);
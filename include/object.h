@@ -0,0 +1,50 @@
+/*
+    Key lookup on JSON objects
+*/
+
+#pragma once
+
+#include "parser.h"
+
+// Objects with fewer pairs than this are searched linearly, larger ones
+// get a hash index the first time they are queried
+#define JSON_OBJECT_INDEX_THRESHOLD 16
+
+// Open-addressing table of the pairs, capacity is a power of two
+typedef struct JSONObjectIndex {
+    size_t capacity;
+    struct {
+        size_t hash;
+        JSONPair *pair;
+    } slots[];
+} JSONObjectIndex;
+
+// Lookups return the first pair with a matching key. The index is
+// allocated in a on first use, so concurrent lookups on the same object
+// need external locking.
+JSONElement *json_object_get(Arena *a, JSONObject *object, const char *key);
+JSONElement *json_object_get_n(Arena *a, JSONObject *object, const char *key,
+                               size_t length);
+// Lookup by a string from the pool the object was parsed with (see
+// intern.h), compared by address rather than by content
+JSONElement *json_object_get_interned(Arena *a, JSONObject *object,
+                                      JSONString key);
+
+// Typed getters return false when the key is missing or holds another type.
+// Numbers are converted from raw digits (see json_parse_exact) when read,
+// integers must fit the type asked for, and json_object_get_float accepts
+// any number.
+bool json_object_get_string(Arena *a, JSONObject *object, const char *key,
+                            JSONString *out);
+bool json_object_get_int(Arena *a, JSONObject *object, const char *key,
+                         long long *out);
+bool json_object_get_uint(Arena *a, JSONObject *object, const char *key,
+                          unsigned long long *out);
+bool json_object_get_float(Arena *a, JSONObject *object, const char *key,
+                           double *out);
+bool json_object_get_bool(Arena *a, JSONObject *object, const char *key,
+                          bool *out);
+JSONObject *json_object_get_object(Arena *a, JSONObject *object,
+                                   const char *key);
+JSONArray *json_object_get_array(Arena *a, JSONObject *object,
+                                 const char *key);
@@ -0,0 +1,24 @@
+/*
+    Parallel parsing of a single document
+*/
+
+#pragma once
+
+#include "parser.h"
+
+// Smaller inputs aren't worth the extra passes and are parsed serially
+#define JSON_PARALLEL_MIN_SIZE ((size_t)1 << 20)
+
+// Parses len bytes of buf on threads workers (one per online CPU when 0)
+// into the same tree json_parse_buffer builds, strings borrowed from buf.
+//
+// The input is cut into chunks that are scanned in parallel for quotes and
+// braces. A serial pass over the per-chunk results carries the string and
+// escape state and the nesting depth from one chunk to the next, then each
+// chunk is scanned again for its first comma directly inside the root.
+// The root's elements (or pairs) between those commas are parsed
+// concurrently into per-worker arenas, spliced into a, and linked into one
+// container. Only the root is split, so a root with a few huge children
+// gains little. Invalid input is reparsed serially to report the error.
+JSONElement json_parse_parallel(Arena *a, const char *buf, size_t len,
+                                size_t threads, JSONError *error);
@@ -0,0 +1,52 @@
+/*
+    Incremental push parser for chunked input
+*/
+
+#pragma once
+
+#include "builder.h"
+
+typedef enum {
+    JSON_PUSH_VALUE,        // Any value
+    JSON_PUSH_FIRST_VALUE,  // A value or ']', just after '['
+    JSON_PUSH_FIRST_KEY,    // A key or '}', just after '{'
+    JSON_PUSH_KEY,
+    JSON_PUSH_COLON,
+    JSON_PUSH_COMMA,  // ',' or the closing brace of the open container
+    JSON_PUSH_DONE,   // The root is complete, only the end may follow
+} JSONPushState;
+
+// Parses a document fed to it in chunks of any size, building the same tree
+// as json_parse. Tokens cut off at the end of a chunk are kept in a small
+// carry buffer until the next chunk completes them, everything else is
+// lexed straight out of the chunk. Strings are always copied into the
+// arena, chunks can be reused as soon as json_parser_feed returns.
+typedef struct {
+    Arena *arena;
+    ArenaMark mark;
+    JSONTokenizer tokenizer;
+    JSONPushState state;
+    JSONBuilder builder;
+
+    // Start of a token cut off by the end of the last chunk
+    char *carry;
+    size_t carry_size;
+    size_t carry_capacity;
+
+    size_t fed;   // Bytes fed so far
+    size_t base;  // Where the buffer being lexed starts in the stream
+    // Lines are counted as bytes are lexed, the chunks are gone by the time
+    // an error is reported
+    size_t line;        // Line of the byte at base
+    size_t line_start;  // Where that line starts in the stream
+    JSONError error;    // Offsets are in the whole stream
+} JSONPushParser;
+
+void json_parser_init(JSONPushParser *p, Arena *a);
+// Returns non-zero once the input seen so far can't be valid JSON, the
+// reason is in p->error
+int json_parser_feed(JSONPushParser *p, const char *chunk, size_t len);
+// Ends the input and returns the root, filling in error, zeroed on success.
+// On error nothing is left in the arena. Either way the parser's buffers
+// are freed.
+JSONElement json_parser_finish(JSONPushParser *p, JSONError *error);
@@ -0,0 +1,57 @@
+/*
+    JSON Pointer and JSONPath queries
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "parser.h"
+
+// Steps a query can hold, one bit of a state set each plus one for a match
+#define JSON_QUERY_MAX_STEPS 63
+
+typedef enum {
+    JSON_STEP_KEY,       // .name or ['name']
+    JSON_STEP_INDEX,     // [3]
+    JSON_STEP_MEMBER,    // /token, a key or, on arrays, an index
+    JSON_STEP_WILDCARD,  // .* or [*]
+    JSON_STEP_DESCEND,   // .., the next step applies at any depth
+} JSONStepType;
+
+typedef struct {
+    JSONStepType type;
+    JSONString key;  // Unescaped
+    size_t index;    // SIZE_MAX when a member isn't a valid array index
+} JSONStep;
+
+typedef struct {
+    JSONStep *steps;
+    size_t count;
+    uint64_t descend;  // Bit i is set if step i is ..
+} JSONQuery;
+
+// Called with each match, a non-zero return stops the query
+typedef int (*JSONQueryFn)(void *context, JSONElement *match);
+
+// Compiles an RFC 6901 JSON Pointer ("" or "/a/0") or a JSONPath starting
+// with $: .name, ['name'], [3], .*, [*] and .. before any of them. The
+// query lives in a and can be run any number of times, from any thread.
+// Returns NULL on error, with error placed in path.
+JSONQuery *json_query_compile(Arena *a, const char *path, JSONError *error);
+
+// Calls fn on every element of the tree matching the query, in document
+// order and each once. Returns non-zero if fn stopped the query.
+int json_query_each(const JSONQuery *q, JSONElement *root, JSONQueryFn fn,
+                    void *context);
+// The first match, or NULL
+JSONElement *json_query_first(const JSONQuery *q, JSONElement *root);
+
+// Runs the query while tokenizing len bytes of buf, without building the
+// tree. Subtrees no step can match are skipped by bracket counting, without
+// being tokenized or checked. Matches are parsed into a, strings borrowed
+// from buf. Returns non-zero if buf isn't valid JSON where it was read, with
+// error filled in, or if fn stopped the query, with error left zeroed.
+int json_query_stream(Arena *a, const JSONQuery *q, const char *buf,
+                      size_t len, JSONQueryFn fn, void *context,
+                      JSONError *error);
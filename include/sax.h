@@ -0,0 +1,35 @@
+/*
+    Event callbacks
+*/
+
+#pragma once
+
+#include "tokenizer.h"
+
+// Called in document order as the parser walks the input. Any callback may
+// be NULL to ignore the event, and a non-zero return stops the parse.
+// Strings point into the input unless they had escapes, in which case they
+// are only valid until the callback returns.
+typedef struct {
+    int (*on_object_start)(void *context);
+    int (*on_object_end)(void *context);
+    int (*on_array_start)(void *context);
+    int (*on_array_end)(void *context);
+    int (*on_key)(void *context, JSONString key);
+    int (*on_string)(void *context, JSONString value);
+    int (*on_int)(void *context, long long value);
+    int (*on_uint)(void *context, unsigned long long value);
+    int (*on_float)(void *context, double value);
+    int (*on_number)(void *context, JSONString digits);  // Raw numbers only
+    int (*on_bool)(void *context, bool value);
+    int (*on_null)(void *context);
+} JSONCallbacks;
+
+// Parses len bytes of buf without building a tree. Escaped strings are
+// decoded into a and dropped after their event, so a is left as it was,
+// and with an ArenaPool behind it nothing is malloc'd. Returns non-zero if
+// the input is invalid, with error filled in, or if a callback stopped the
+// parse, with error left zeroed.
+int json_parse_events(Arena *a, const char *buf, size_t len,
+                      const JSONCallbacks *callbacks, void *context,
+                      JSONError *error);
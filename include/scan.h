@@ -0,0 +1,34 @@
+/*
+    Vectorized character classification
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define JSON_BLOCK_SIZE 64
+
+// Bit i of each mask describes byte i of a JSON_BLOCK_SIZE byte block
+typedef struct {
+    uint64_t quote;       // "
+    uint64_t backslash;   // '\'
+    uint64_t structural;  // { } [ ] , :
+    uint64_t whitespace;  // Space, tab, carriage return and newline
+    uint64_t control;     // Bytes below 0x20, never valid inside strings
+} JSONBlockMasks;
+
+// Classifies the JSON_BLOCK_SIZE bytes at block with the best kernel the
+// CPU supports (AVX2, SSE4.2 or portable scalar), picked once at load time
+void json_classify_block(const char *block, JSONBlockMasks *m);
+const char *json_scan_kernel_name(void);
+
+// Returns the first '"' or '\' in [p, end), or end if there is none
+const char *json_scan_string(const char *p, const char *end);
+
+// Returns the first byte in [p, end) that isn't printable ASCII other than
+// '"' and '\': where a plain run of string bytes ends, or end
+const char *json_scan_string_ascii(const char *p, const char *end);
+
+// Returns the first non-whitespace byte in [p, end), or end
+const char *json_skip_whitespace(const char *p, const char *end);
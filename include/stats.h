@@ -0,0 +1,61 @@
+/*
+    Parse statistics, compiled in with -DJSON_STATS
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "parser.h"
+#include "writer.h"
+
+// The phases overlap: tokenizing includes converting numbers and decoding
+// strings, and arena growth happens inside the others. Building is the
+// rest of the parse.
+typedef enum {
+    JSON_STATS_TOKENIZE,
+    JSON_STATS_NUMBER,    // Lexing and converting number literals
+    JSON_STATS_UNESCAPE,  // Lexing and decoding strings with escapes
+    JSON_STATS_BUILD,     // Turning tokens into the tree
+    JSON_STATS_ARENA,     // malloc'ing arena regions
+    JSON_STATS_PHASES,
+} JSONStatsPhase;
+
+typedef struct JSONStats {
+    uint64_t nanoseconds[JSON_STATS_PHASES];
+    uint64_t total_nanoseconds;
+    size_t tokens[END + 1];  // By JSONTokenType
+    size_t bytes;            // Of input
+    size_t bytes_unescaped;  // Of strings that had escapes, as written
+    size_t regions;          // Arena regions malloc'd
+    size_t max_depth;        // Of elements, a scalar is a level too
+    size_t largest_string;   // In bytes, after decoding
+} JSONStats;
+
+// Called after every parse once set, whether or not the caller asked for
+// stats. source is the file name, or NULL. The hook is called from the
+// thread that parsed, so with several parsing threads it must be
+// thread-safe itself. It may be changed while other threads parse, each
+// parse uses the hook that was set when it started.
+typedef void (*JSONStatsHook)(void *context, const char *source,
+                              const JSONStats *stats, const JSONError *error);
+
+#ifdef JSON_STATS
+
+// Each token is timed, which makes parsing slower, so stats are only
+// gathered when asked for or when a hook is set
+JSONElement json_parse_buffer_stats(Arena *a, const char *buf, size_t len,
+                                    JSONStats *stats, JSONError *error);
+JSONElement json_parse_file_stats(Arena *a, const char *file_name,
+                                  JSONStats *stats, JSONError *error);
+
+void json_stats_hook(JSONStatsHook hook, void *context);
+
+// Writes stats as one object, e.g. for a log line or a metrics exporter
+int json_stats_write(JSONWriter *w, const JSONStats *stats);
+
+// Monotonic clock in nanoseconds
+uint64_t json_stats_now(void);
+
+#endif
@@ -7,6 +7,7 @@
 #include <string.h>
 
 #include "arena.h"
+#include "error.h"
 
 #define INIT_CAPACITY (1 << 10)
 
@@ -18,7 +19,9 @@ typedef enum {
     COMMA,
     COLON,
     NUMBER_INT,
+    NUMBER_UINT,   // Integer above LLONG_MAX
     NUMBER_FLOAT,
+    NUMBER_RAW,    // Digits as written, when raw_numbers is set
     STRING,
     TRUE,
     FALSE,
@@ -27,35 +30,68 @@ typedef enum {
 } JSONTokenType;
 
 static const char *token_names[] = {
-    [0] = "{",      [1] = "}",     [2] = "[",     [3] = "]",      [4] = ",",
-    [5] = ":",      [6] = "int",   [7] = "float", [8] = "string", [9] = "true",
-    [10] = "false", [11] = "null", [12] = "eof",
+    [0] = "{",      [1] = "}",      [2] = "[",       [3] = "]",
+    [4] = ",",      [5] = ":",      [6] = "int",     [7] = "uint",
+    [8] = "float",  [9] = "number", [10] = "string", [11] = "true",
+    [12] = "false", [13] = "null",  [14] = "eof",
 };
 
+// Strings are not NUL-terminated when borrowed from the input buffer
+typedef struct {
+    const char *data;
+    size_t length;
+} JSONString;
+
 typedef struct {
     JSONTokenType type;
     union {
-        char *string;
+        JSONString string;  // Also the digits of NUMBER_RAW
         long long number_int;
-        long double number_float;
+        unsigned long long number_uint;
+        double number_float;
         bool boolean;
     } value;
-    size_t line;
-    size_t col;
+    size_t offset;  // Of the token's first byte in the input
 } JSONToken;
 
+struct JSONInternPool;
+struct JSONStats;
+
 typedef struct {
-    size_t current_line;
-    size_t current_col;
     JSONToken *tokens;
     size_t token_count;
     const char *content;
-    char *current_char;
+    const char *end;
+    const char *current_char;
     JSONToken current_token;
+    bool borrow;  // Unescaped strings are slices of content, not copies
+    bool raw_numbers;  // Numbers are NUMBER_RAW tokens, checked but not
+                       // converted, so none lose precision
+    struct JSONInternPool *intern;  // Pools keys and short values when set
+    struct JSONStats *stats;  // Counted into when built with JSON_STATS
+    JSONError error;          // Why json_next_token failed
 } JSONTokenizer;
 
-JSONTokenizer *json_tokenize(Arena *a, const char *content, int *error);
+void json_tokenizer_init(JSONTokenizer *t, const char *content, size_t length);
+void json_tokenizer_skip_whitespace(JSONTokenizer *t);
+// The name in token_names of the token starting at p, without lexing it, or
+// NULL for a byte no token starts with
+const char *json_token_name_at(const char *p, const char *end);
+int json_next_token(Arena *a, JSONTokenizer *t);
+// Lexes all of content up front. Returns NULL, with nothing left allocated
+// in a, on error.
+JSONTokenizer *json_tokenize(Arena *a, const char *content,
+                             JSONError *error);
 int json_tokenize_string(Arena *a, JSONTokenizer *t);
+// Decodes the escape sequence at p, just past its backslash, into out as up
+// to 4 bytes of UTF-8 and stores how many bytes of input it spans in used.
+// \u escapes for a UTF-16 surrogate pair become one code point, and a
+// surrogate without its other half becomes U+FFFD. Returns the bytes
+// written, 0 if p doesn't start an escape.
+size_t json_decode_escape(const char *p, const char *end, char *out,
+                          size_t *used);
+// The length of the true, false or null at p, 0 if there's none
+size_t json_literal_length(const char *p, const char *end);
 int json_tokenize_true(JSONTokenizer *t);
 int json_tokenize_false(JSONTokenizer *t);
 int json_tokenize_null(JSONTokenizer *t);
@@ -4,6 +4,26 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+typedef struct {
+    char *data;  // Not NUL-terminated when mapped
+    size_t size;
+    bool mapped;
+} FileContent;
+
 char *read_file_content(const char *file_name);
+int map_file_content(const char *file_name, FileContent *file);
+void unmap_file_content(FileContent *file);
+
+// The number of online CPUs when threads is 0, threads otherwise
+size_t thread_count(size_t threads);
+// Calls work on each of the count items of size bytes at args, one thread
+// per item with the calling thread taking the first. If a thread can't be
+// started its item is skipped, so work should share out the job rather
+// than own a fixed slice of it.
+void run_threads(void *(*work)(void *), void *args, size_t count,
+                 size_t size);
+
 bool is_whitespace(char c);
 bool is_digit(char c);
+// Hash of object keys and interned strings
+size_t hash_bytes(const char *data, size_t length);
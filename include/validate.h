@@ -0,0 +1,22 @@
+/*
+    Well-formedness checking without parsing
+*/
+
+#pragma once
+
+#include "parser.h"
+
+// Checks that len bytes of buf are one JSON text as RFC 8259 defines it,
+// nested no deeper than JSON_MAX_DEPTH: strings are UTF-8 without control
+// characters or unknown escapes, and numbers follow the grammar. Nothing
+// is allocated, copied or converted. Returns 0 if buf is valid, non-zero
+// with error filled in otherwise.
+//
+// Only the grammar is checked, so a number too large for a double and an
+// escaped lone surrogate are both valid. The parser still has limits of
+// its own, e.g. on string length, that a valid document may exceed.
+int json_validate(const char *buf, size_t len, JSONError *error);
+// Like json_validate, with a tighter depth limit. max_depth is capped at
+// JSON_MAX_DEPTH.
+int json_validate_depth(const char *buf, size_t len, size_t max_depth,
+                        JSONError *error);
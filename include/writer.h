@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "parser.h"
+
+#define JSON_WRITER_CHUNK (1 << 12)
+
+// -----------
+// JSON Writer
+// -----------
+
+typedef enum {
+    JSON_STYLE_INLINE,   // {"a": 1, "b": [1, 2]}, the json_stringify format
+    JSON_STYLE_COMPACT,  // {"a":1,"b":[1,2]}
+    JSON_STYLE_PRETTY,   // One member per line, indented
+} JSONWriteStyle;
+
+// Sink for flushed output, returns non-zero on failure
+typedef int (*JSONWriteFn)(void *context, const char *data, size_t length);
+
+typedef struct {
+    JSONWriteStyle style;
+    size_t indent;  // Spaces per level for JSON_STYLE_PRETTY
+    bool exact;     // Floats get as many digits as it takes to read back
+                    // the same double, instead of six decimals
+    size_t depth;
+    bool first;  // Nothing written yet in the innermost container
+    bool key;    // A key was just written, its value comes next
+
+    // When write is NULL the buffer grows to hold the whole document,
+    // otherwise it is flushed to write every JSON_WRITER_CHUNK bytes
+    JSONWriteFn write;
+    void *context;
+    char *buffer;
+    size_t size;
+    size_t capacity;
+    int error;
+} JSONWriter;
+
+JSONWriter json_writer_buffer(JSONWriteStyle style);
+JSONWriter json_writer_file(FILE *file, JSONWriteStyle style);
+JSONWriter json_writer_callback(JSONWriteFn write, void *context,
+                                JSONWriteStyle style);
+
+int json_write(JSONWriter *w, JSONElement element);
+
+// Writes a document piece by piece, for output that isn't held in a tree.
+// Separators and indentation are handled by the writer, each value inside
+// an object must follow a json_write_key. Errors are kept in w->error.
+void json_write_object_start(JSONWriter *w);
+void json_write_object_end(JSONWriter *w);
+void json_write_array_start(JSONWriter *w);
+void json_write_array_end(JSONWriter *w);
+void json_write_key(JSONWriter *w, JSONString key);
+void json_write_string(JSONWriter *w, JSONString value);
+void json_write_int(JSONWriter *w, long long value);
+void json_write_uint(JSONWriter *w, unsigned long long value);
+// NaN and infinity aren't JSON, they set w->error
+void json_write_float(JSONWriter *w, double value);
+// Writes digits as they are, they must be a valid JSON number
+void json_write_number(JSONWriter *w, JSONString digits);
+void json_write_bool(JSONWriter *w, bool value);
+void json_write_null(JSONWriter *w);
+int json_writer_flush(JSONWriter *w);
+void json_writer_free(JSONWriter *w);
@@ -1,10 +1,19 @@
 #include "arena.h"
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 
+#ifdef JSON_STATS
+#include "stats.h"
+#endif
+
 static region_t *region_new(size_t capacity) {
-    region_t *r =
-        (region_t *)calloc(1, sizeof(region_t) + sizeof(void *) * capacity);
+    region_t *r = (region_t *)malloc(sizeof(region_t) + capacity);
+    if (r == NULL) {
+        return NULL;
+    }
+
     *r = (region_t){
         .next = NULL,
         .capacity = capacity,
@@ -13,37 +22,156 @@ static region_t *region_new(size_t capacity) {
     return r;
 }
 
-void *arena_alloc(Arena *a, size_t size) {
+// Padding needed to align the next allocation in r
+static size_t region_padding(const region_t *r, size_t alignment) {
+    uintptr_t next = (uintptr_t)(r->data + r->size);
+    return (size_t)(-next & (alignment - 1));
+}
+
+static bool region_fits(const region_t *r, size_t size, size_t alignment) {
+    size_t padding = region_padding(r, alignment);
+    return padding <= r->capacity - r->size &&
+           size <= r->capacity - r->size - padding;
+}
+
+// Best fit for capacity bytes: the smallest region in pool that holds
+// them. The list is sorted largest first, so that's the last one that does.
+static region_t *pool_take(ArenaPool *pool, size_t capacity) {
+    region_t **fit = NULL;
+    for (region_t **r = &pool->free; *r != NULL && (*r)->capacity >= capacity;
+         r = &(*r)->next) {
+        fit = r;
+    }
+    if (fit == NULL) {
+        return NULL;
+    }
+
+    region_t *r = *fit;
+    *fit = r->next;
+    --pool->regions;
+    pool->bytes -= r->capacity;
+    *r = (region_t){.capacity = r->capacity};
+    return r;
+}
+
+static void pool_give(ArenaPool *pool, region_t *r) {
+    if (pool->limit != 0 && pool->bytes + r->capacity > pool->limit) {
+        free(r);
+        return;
+    }
+
+    region_t **at = &pool->free;
+    while (*at != NULL && (*at)->capacity > r->capacity) {
+        at = &(*at)->next;
+    }
+    r->next = *at;
+    *at = r;
+    ++pool->regions;
+    pool->bytes += r->capacity;
+}
+
+static region_t *arena_append(Arena *a, region_t *r) {
     if (a->last == NULL) {
         // No regions yet
         assert(a->first == NULL &&
                "First region is non-null when last region is null");
-        a->last = region_new(size > REGION_CAPACITY ? size : REGION_CAPACITY);
-        a->first = a->last;
-    }
-
-    if (a->last->capacity < a->last->size + size) {
-        // Not enough space in a->end
+        a->first = r;
+    } else {
         assert(a->last->next == NULL &&
                "Last region is non-null when adding a new region");
-        a->last->next =
-            region_new(size > REGION_CAPACITY ? size : REGION_CAPACITY);
-        a->last = a->last->next;
+        a->last->next = r;
+    }
+    a->last = r;
+    return r;
+}
+
+static region_t *arena_grow(Arena *a, size_t size, size_t alignment) {
+    if (size > SIZE_MAX - sizeof(region_t) - alignment) {
+        return NULL;
     }
 
-    void *res = &a->last->data[a->last->size];
-    a->last->size += size;
+    size_t capacity = REGION_CAPACITY;
+    if (a->step != 0) {
+        capacity = a->step < REGION_MAX_CAPACITY ? a->step * 2
+                                                 : REGION_MAX_CAPACITY;
+    }
+    // Oversized regions don't count towards the growth
+    size_t step = capacity;
+    if (size + alignment > capacity) {
+        capacity = size + alignment;
+        step = a->step;
+    }
+
+    region_t *r = a->pool != NULL ? pool_take(a->pool, capacity) : NULL;
+    if (r != NULL) {
+        a->step = step;
+        return arena_append(a, r);
+    }
+
+#ifdef JSON_STATS
+    uint64_t start = json_stats_now();
+#endif
+    r = region_new(capacity);
+#ifdef JSON_STATS
+    a->grow_nanoseconds += json_stats_now() - start;
+#endif
+    if (r == NULL) {
+        return NULL;
+    }
+    ++a->allocations;
+    a->step = step;
+    return arena_append(a, r);
+}
+
+void *arena_alloc_aligned(Arena *a, size_t size, size_t alignment) {
+    assert(alignment != 0 && (alignment & (alignment - 1)) == 0 &&
+           "Alignment is not a power of two");
+
+    region_t *r = a->current != NULL ? a->current : a->first;
 
+    // Regions kept by arena_reset are reused in order, a region that can't
+    // fit the allocation has its tail skipped
+    while (r != NULL && !region_fits(r, size, alignment)) {
+        if (r->next == NULL) {
+            r = NULL;
+            break;
+        }
+        a->wasted += r->capacity - r->size;
+        r = r->next;
+    }
+
+    if (r == NULL) {
+        if (a->last != NULL) {
+            a->wasted += a->last->capacity - a->last->size;
+        }
+        r = arena_grow(a, size, alignment);
+        if (r == NULL) {
+            return NULL;
+        }
+    }
+    a->current = r;
+
+    size_t padding = region_padding(r, alignment);
+    void *res = r->data + r->size + padding;
+    r->size += padding + size;
+
+    a->used += size;
+    a->wasted += padding;
     return res;
 }
 
+void *arena_alloc(Arena *a, size_t size) {
+    return arena_alloc_aligned(a, size,
+                               a->alignment ? a->alignment : ARENA_ALIGNMENT);
+}
+
 char *arena_alloc_str(Arena *a, const char *str) {
     if (str == NULL) {
         return NULL;
     }
 
     size_t len = strlen(str) + 1;  // +1 for null terminator
-    char *result = (char *)arena_alloc(a, len);
+    char *result = (char *)arena_alloc_aligned(a, len, 1);
 
     if (result != NULL) {
         memcpy(result, str, len);
@@ -52,12 +180,105 @@ char *arena_alloc_str(Arena *a, const char *str) {
     return result;
 }
 
+void arena_reset(Arena *a) {
+    arena_rewind(a, (ArenaMark){0});
+}
+
+ArenaMark arena_mark(const Arena *a) {
+    return (ArenaMark){
+        .region = a->current,
+        .size = a->current != NULL ? a->current->size : 0,
+        .used = a->used,
+        .wasted = a->wasted,
+    };
+}
+
+void arena_rewind(Arena *a, ArenaMark mark) {
+    // Regions past the current one are always empty, so only the ones
+    // between the mark and the current region need clearing
+    region_t *r = mark.region != NULL ? mark.region->next : a->first;
+    if (a->current != mark.region) {
+        for (; r != NULL; r = r->next) {
+            r->size = 0;
+            if (r == a->current) break;
+        }
+    }
+
+    if (mark.region != NULL) {
+        mark.region->size = mark.size;
+        a->current = mark.region;
+    } else {
+        a->current = a->first;
+    }
+    a->used = mark.used;
+    a->wasted = mark.wasted;
+}
+
+void arena_merge(Arena *dst, Arena *src) {
+    if (src->first == NULL) {
+        return;
+    }
+
+    if (dst->first == NULL) {
+        Arena merged = *src;
+        merged.alignment = dst->alignment;
+        merged.pool = dst->pool;
+        *dst = merged;
+        *src = (Arena){.alignment = src->alignment, .pool = src->pool};
+        return;
+    }
+
+    // src's regions go right after the current one, so the empty regions
+    // kept by a reset still come last
+    region_t *current = dst->current != NULL ? dst->current : dst->first;
+    src->last->next = current->next;
+    current->next = src->first;
+    if (dst->last == current) {
+        dst->last = src->last;
+    }
+
+    dst->wasted += current->capacity - current->size + src->wasted;
+    dst->current = src->current;
+    dst->step = MAX(dst->step, src->step);
+    dst->used += src->used;
+    dst->allocations += src->allocations;
+    dst->grow_nanoseconds += src->grow_nanoseconds;
+    *src = (Arena){.alignment = src->alignment, .pool = src->pool};
+}
+
+void arena_stats(const Arena *a, ArenaStats *stats) {
+    *stats = (ArenaStats){
+        .used = a->used,
+        .wasted = a->wasted,
+        .allocations = a->allocations,
+    };
+
+    for (region_t *r = a->first; r != NULL; r = r->next) {
+        ++stats->regions;
+        stats->reserved += r->capacity;
+    }
+}
+
 void arena_free(Arena *a) {
     region_t *current = a->first;
+    while (current != NULL) {
+        region_t *tmp = current->next;
+        if (a->pool != NULL) {
+            pool_give(a->pool, current);
+        } else {
+            free(current);
+        }
+        current = tmp;
+    }
+    *a = (Arena){.alignment = a->alignment, .pool = a->pool};
+}
+
+void arena_pool_free(ArenaPool *pool) {
+    region_t *current = pool->free;
     while (current != NULL) {
         region_t *tmp = current->next;
         free(current);
         current = tmp;
     }
-    *a = (Arena){0};
+    *pool = (ArenaPool){.limit = pool->limit};
 }
@@ -0,0 +1,507 @@
+#include "binary.h"
+
+#include <stdalign.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "number.h"
+
+// ---------
+// Encoding
+// ---------
+
+// The document is built in one growing buffer, so nodes are addressed by
+// their offset in it rather than by pointer
+typedef struct {
+    char *data;
+    size_t size;
+    size_t capacity;
+    JSONError *error;  // Encoding errors aren't at a place in any input
+} JSONBinaryBuffer;
+
+// Appends size zeroed bytes aligned to alignment, returning their offset,
+// or SIZE_MAX if the buffer can't grow
+static size_t json_binary_reserve(JSONBinaryBuffer *b, size_t size,
+                                  size_t alignment) {
+    size_t offset = (b->size + alignment - 1) & ~(alignment - 1);
+    if (offset + size > b->capacity) {
+        size_t capacity = b->capacity ? b->capacity : 1 << 16;
+        while (capacity < offset + size) capacity *= 2;
+
+        char *data = realloc(b->data, capacity);
+        if (data == NULL) {
+            json_error_set(b->error, JSON_ERROR_MEMORY, NULL, 0);
+            return SIZE_MAX;
+        }
+        b->data = data;
+        b->capacity = capacity;
+    }
+
+    memset(b->data + b->size, 0, offset + size - b->size);
+    b->size = offset + size;
+    return offset;
+}
+
+static JSONBinaryNode *json_binary_node_at(JSONBinaryBuffer *b,
+                                           size_t offset) {
+    return (JSONBinaryNode *)(b->data + offset);
+}
+
+// Counts and string lengths are 32-bit
+static int json_binary_check_count(JSONBinaryBuffer *b, size_t count) {
+    if (count > UINT32_MAX) {
+        json_error_set(b->error, JSON_ERROR_SIZE, NULL, 0);
+        return 1;
+    }
+    return 0;
+}
+
+// Stores the bytes of a string after the nodes so far, NUL-terminated
+static int json_binary_encode_string(JSONBinaryBuffer *b, size_t at,
+                                     uint32_t type, JSONString string) {
+    if (json_binary_check_count(b, string.length)) {
+        return 1;
+    }
+    size_t bytes = json_binary_reserve(b, string.length + 1, 1);
+    if (bytes == SIZE_MAX) {
+        return 1;
+    }
+    if (string.length > 0) {
+        memcpy(b->data + bytes, string.data, string.length);
+    }
+
+    *json_binary_node_at(b, at) = (JSONBinaryNode){
+        .type = type,
+        .count = string.length,
+        .value.offset = (int64_t)bytes - (int64_t)at,
+    };
+    return 0;
+}
+
+static int json_binary_encode_value(JSONBinaryBuffer *b, size_t at,
+                                    JSONValue value) {
+    JSONBinaryNode node = {0};
+    switch (value.type) {
+        case JSON_VALUE_STRING:
+            return json_binary_encode_string(b, at, JSON_BINARY_STRING,
+                                             value.value.string);
+        case JSON_VALUE_NUMBER_RAW:
+            return json_binary_encode_string(b, at, JSON_BINARY_NUMBER,
+                                             value.value.string);
+        case JSON_VALUE_NUMBER_INT:
+            node = (JSONBinaryNode){.type = JSON_BINARY_INT,
+                                    .value.number_int = value.value.number_int};
+            break;
+        case JSON_VALUE_NUMBER_UINT:
+            node = (JSONBinaryNode){
+                .type = JSON_BINARY_UINT,
+                .value.number_uint = value.value.number_uint};
+            break;
+        case JSON_VALUE_NUMBER_FLOAT:
+            node = (JSONBinaryNode){
+                .type = JSON_BINARY_FLOAT,
+                .value.number_float = value.value.number_float};
+            break;
+        case JSON_VALUE_BOOLEAN:
+            node = (JSONBinaryNode){.type = JSON_BINARY_BOOLEAN,
+                                    .value.boolean = value.value.boolean};
+            break;
+        case JSON_VALUE_NULL:
+            node = (JSONBinaryNode){.type = JSON_BINARY_NULL};
+            break;
+    }
+
+    *json_binary_node_at(b, at) = node;
+    return 0;
+}
+
+// Writes element into the node at offset at. A container reserves the
+// block of its children first, then fills it in.
+static int json_binary_encode_element(JSONBinaryBuffer *b, size_t at,
+                                      JSONElement element) {
+    size_t count = 0;
+    size_t block;
+
+    switch (element.type) {
+        case JSON_ELEMENT_OBJECT: {
+            JSONObject *object = element.element.object;
+            count = object->count;
+            if (json_binary_check_count(b, count)) return 1;
+            block = json_binary_reserve(b, 2 * count * sizeof(JSONBinaryNode),
+                                        sizeof(JSONBinaryNode));
+            if (block == SIZE_MAX) return 1;
+
+            size_t child = block;
+            for_each_pair(object, pair) {
+                if (json_binary_encode_string(b, child, JSON_BINARY_STRING,
+                                              pair->key) ||
+                    json_binary_encode_element(
+                        b, child + sizeof(JSONBinaryNode), pair->value)) {
+                    return 1;
+                }
+                child += 2 * sizeof(JSONBinaryNode);
+            }
+            break;
+        }
+        case JSON_ELEMENT_ARRAY: {
+            JSONArray *array = element.element.array;
+            for_each_element(array, item) count++;
+            if (json_binary_check_count(b, count)) return 1;
+            block = json_binary_reserve(b, count * sizeof(JSONBinaryNode),
+                                        sizeof(JSONBinaryNode));
+            if (block == SIZE_MAX) return 1;
+
+            size_t child = block;
+            for_each_element(array, item) {
+                if (json_binary_encode_element(b, child, item->element)) {
+                    return 1;
+                }
+                child += sizeof(JSONBinaryNode);
+            }
+            break;
+        }
+        case JSON_ELEMENT_VALUE:
+            return json_binary_encode_value(b, at, element.element.value);
+        default:
+            json_error_set(b->error, JSON_ERROR_ARGUMENT, NULL, 0);
+            return 1;
+    }
+
+    *json_binary_node_at(b, at) = (JSONBinaryNode){
+        .type = element.type == JSON_ELEMENT_OBJECT ? JSON_BINARY_OBJECT
+                                                    : JSON_BINARY_ARRAY,
+        .count = count,
+        .value.offset = (int64_t)block - (int64_t)at,
+    };
+    return 0;
+}
+
+int json_binary_encode(JSONElement root, char **data, size_t *size,
+                       JSONError *error) {
+    *error = (JSONError){0};
+    JSONBinaryBuffer b = {.error = error};
+
+    // The root node is the last field of the header
+    size_t header = json_binary_reserve(&b, sizeof(JSONBinaryHeader),
+                                        sizeof(JSONBinaryNode));
+    if (header == SIZE_MAX ||
+        json_binary_encode_element(&b, offsetof(JSONBinaryHeader, root),
+                                   root)) {
+        free(b.data);
+        return 1;
+    }
+
+    // Padded so documents can be placed back to back
+    if (json_binary_reserve(&b, 0, sizeof(JSONBinaryNode)) == SIZE_MAX) {
+        free(b.data);
+        return 1;
+    }
+
+    JSONBinaryHeader *h = (JSONBinaryHeader *)b.data;
+    memcpy(h->magic, JSON_BINARY_MAGIC, sizeof(JSON_BINARY_MAGIC));
+    h->version = JSON_BINARY_VERSION;
+    h->byte_order = JSON_BINARY_BYTE_ORDER;
+    h->size = b.size;
+
+    *data = b.data;
+    *size = b.size;
+    return 0;
+}
+
+int json_binary_save(JSONElement root, const char *file_name,
+                     JSONError *error) {
+    char *data;
+    size_t size;
+    if (json_binary_encode(root, &data, &size, error)) {
+        return 1;
+    }
+
+    FILE *file = fopen(file_name, "wb");
+    if (file == NULL) {
+        json_error_set(error, JSON_ERROR_IO, NULL, 0);
+        free(data);
+        return 1;
+    }
+
+    int failed = fwrite(data, 1, size, file) != size;
+    failed |= fclose(file) != 0;
+    if (failed) {
+        json_error_set(error, JSON_ERROR_IO, NULL, 0);
+    }
+
+    free(data);
+    return failed;
+}
+
+// -------
+// Loading
+// -------
+
+int json_binary_open(JSONBinary *doc, const char *data, size_t size,
+                     JSONError *error) {
+    *doc = (JSONBinary){0};
+    *error = (JSONError){0};
+    if (data == NULL) {
+        json_error_set(error, JSON_ERROR_ARGUMENT, NULL, 0);
+        return 1;
+    }
+
+    // Not binary JSON, another version or byte order, or truncated
+    const JSONBinaryHeader *h = (const JSONBinaryHeader *)data;
+    if (size < sizeof(JSONBinaryHeader) ||
+        memcmp(h->magic, JSON_BINARY_MAGIC, sizeof(JSON_BINARY_MAGIC)) != 0 ||
+        h->version != JSON_BINARY_VERSION ||
+        h->byte_order != JSON_BINARY_BYTE_ORDER ||
+        h->size < sizeof(JSONBinaryHeader) || h->size > size) {
+        json_error_set(error, JSON_ERROR_BINARY, NULL, 0);
+        return 1;
+    }
+
+    doc->header = h;
+    return 0;
+}
+
+int json_binary_load(JSONBinary *doc, const char *file_name,
+                     JSONError *error) {
+    *error = (JSONError){0};
+    FileContent file;
+    if (map_file_content(file_name, &file)) {
+        json_error_set(error, JSON_ERROR_IO, NULL, 0);
+        return 1;
+    }
+
+    if (json_binary_open(doc, file.data, file.size, error)) {
+        unmap_file_content(&file);
+        return 1;
+    }
+
+    doc->file = file;
+    return 0;
+}
+
+void json_binary_close(JSONBinary *doc) {
+    if (doc->file.data != NULL) {
+        unmap_file_content(&doc->file);
+    }
+    *doc = (JSONBinary){0};
+}
+
+// --------
+// Checking
+// --------
+
+// Walks the tree in the order json_binary_encode lays it out: every block of
+// children and every string starts at or after the end of the one before, so
+// each byte is claimed once and no offset can loop back
+typedef struct {
+    const char *data;
+    size_t size;  // From the header, no more than was mapped
+    size_t next;  // Where the next block or string may start
+    JSONError *error;
+} JSONBinaryChecker;
+
+static int json_binary_corrupt(JSONBinaryChecker *c, size_t at) {
+    json_error_set(c->error, JSON_ERROR_BINARY, NULL, at);
+    return 1;
+}
+
+// Claims the length bytes the node at `at` refers to, returning where they
+// start in *start
+static int json_binary_claim(JSONBinaryChecker *c, size_t at, size_t length,
+                             size_t alignment, size_t *start) {
+    int64_t offset = ((const JSONBinaryNode *)(c->data + at))->value.offset;
+    if (offset <= 0 || (uint64_t)offset > c->size - at) {
+        return json_binary_corrupt(c, at);
+    }
+
+    size_t begin = at + (size_t)offset;
+    if (begin < c->next || begin % alignment != 0 ||
+        length > c->size - begin) {
+        return json_binary_corrupt(c, at);
+    }
+    c->next = begin + length;
+    *start = begin;
+    return 0;
+}
+
+static int json_binary_check_node(JSONBinaryChecker *c, size_t at,
+                                  size_t depth) {
+    const JSONBinaryNode *node = (const JSONBinaryNode *)(c->data + at);
+    size_t start;
+
+    switch (node->type) {
+        case JSON_BINARY_OBJECT:
+        case JSON_BINARY_ARRAY: {
+            if (depth == JSON_MAX_DEPTH) {
+                return json_binary_corrupt(c, at);
+            }
+            bool object = node->type == JSON_BINARY_OBJECT;
+            size_t count = object ? 2 * (size_t)node->count : node->count;
+            if (json_binary_claim(c, at, count * sizeof(JSONBinaryNode),
+                                  alignof(JSONBinaryNode), &start)) {
+                return 1;
+            }
+
+            for (size_t i = 0; i < count; i++) {
+                size_t child = start + i * sizeof(JSONBinaryNode);
+                const JSONBinaryNode *n =
+                    (const JSONBinaryNode *)(c->data + child);
+                if (object && i % 2 == 0 && n->type != JSON_BINARY_STRING) {
+                    return json_binary_corrupt(c, child);
+                }
+                if (json_binary_check_node(c, child, depth + 1)) {
+                    return 1;
+                }
+            }
+            return 0;
+        }
+        case JSON_BINARY_STRING:
+        case JSON_BINARY_NUMBER:
+            if (json_binary_claim(c, at, (size_t)node->count + 1, 1,
+                                  &start)) {
+                return 1;
+            }
+            // Raw digits are written out as they are, so they must be a
+            // JSON number
+            if (c->data[start + node->count] != '\0' ||
+                (node->type == JSON_BINARY_NUMBER &&
+                 json_number_length(c->data + start,
+                                    c->data + start + node->count) !=
+                     node->count)) {
+                return json_binary_corrupt(c, at);
+            }
+            return 0;
+        case JSON_BINARY_INT:
+        case JSON_BINARY_UINT:
+        case JSON_BINARY_FLOAT:
+        case JSON_BINARY_BOOLEAN:
+        case JSON_BINARY_NULL:
+            return 0;
+        default:
+            return json_binary_corrupt(c, at);
+    }
+}
+
+int json_binary_verify(const JSONBinary *doc, JSONError *error) {
+    *error = (JSONError){0};
+    if (doc == NULL || doc->header == NULL) {
+        json_error_set(error, JSON_ERROR_ARGUMENT, NULL, 0);
+        return 1;
+    }
+
+    JSONBinaryChecker c = {
+        .data = (const char *)doc->header,
+        .size = doc->header->size,
+        .next = sizeof(JSONBinaryHeader),
+        .error = error,
+    };
+    return json_binary_check_node(&c, offsetof(JSONBinaryHeader, root), 0);
+}
+
+// ------
+// Access
+// ------
+
+const JSONBinaryNode *json_binary_root(const JSONBinary *doc) {
+    return &doc->header->root;
+}
+
+const JSONBinaryNode *json_binary_children(const JSONBinaryNode *node) {
+    return (const JSONBinaryNode *)((const char *)node + node->value.offset);
+}
+
+JSONString json_binary_string(const JSONBinaryNode *node) {
+    if (node->type != JSON_BINARY_STRING && node->type != JSON_BINARY_NUMBER) {
+        return (JSONString){0};
+    }
+    return (JSONString){.data = (const char *)node + node->value.offset,
+                        .length = node->count};
+}
+
+const JSONBinaryNode *json_binary_at(const JSONBinaryNode *array,
+                                     size_t index) {
+    if (array == NULL || array->type != JSON_BINARY_ARRAY ||
+        index >= array->count) {
+        return NULL;
+    }
+    return json_binary_children(array) + index;
+}
+
+const JSONBinaryNode *json_binary_get_n(const JSONBinaryNode *object,
+                                        const char *key, size_t length) {
+    if (object == NULL || key == NULL || object->type != JSON_BINARY_OBJECT) {
+        return NULL;
+    }
+
+    for_each_binary_pair(object, k, v) {
+        if (k->count == length &&
+            memcmp((const char *)k + k->value.offset, key, length) == 0) {
+            return v;
+        }
+    }
+    return NULL;
+}
+
+const JSONBinaryNode *json_binary_get(const JSONBinaryNode *object,
+                                      const char *key) {
+    if (key == NULL) {
+        return NULL;
+    }
+    return json_binary_get_n(object, key, strlen(key));
+}
+
+// -------------
+// Back to text
+// -------------
+
+static void json_binary_write_node(JSONWriter *w, const JSONBinaryNode *node) {
+    switch (node->type) {
+        case JSON_BINARY_OBJECT:
+            json_write_object_start(w);
+            for_each_binary_pair(node, key, value) {
+                json_write_key(w, json_binary_string(key));
+                json_binary_write_node(w, value);
+            }
+            json_write_object_end(w);
+            break;
+        case JSON_BINARY_ARRAY:
+            json_write_array_start(w);
+            for_each_binary_node(node, child) {
+                json_binary_write_node(w, child);
+            }
+            json_write_array_end(w);
+            break;
+        case JSON_BINARY_STRING:
+            json_write_string(w, json_binary_string(node));
+            break;
+        case JSON_BINARY_INT:
+            json_write_int(w, node->value.number_int);
+            break;
+        case JSON_BINARY_UINT:
+            json_write_uint(w, node->value.number_uint);
+            break;
+        case JSON_BINARY_FLOAT:
+            json_write_float(w, node->value.number_float);
+            break;
+        case JSON_BINARY_NUMBER:
+            json_write_number(w, json_binary_string(node));
+            break;
+        case JSON_BINARY_BOOLEAN:
+            json_write_bool(w, node->value.boolean != 0);
+            break;
+        case JSON_BINARY_NULL:
+            json_write_null(w);
+            break;
+        default:
+            w->error = 1;
+    }
+}
+
+int json_binary_write(JSONWriter *w, const JSONBinaryNode *node) {
+    json_binary_write_node(w, node);
+    if (w->write != NULL) {
+        json_writer_flush(w);
+    }
+    return w->error;
+}
@@ -0,0 +1,514 @@
+#include "bind.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parser.h"
+
+// Seeds tried for each table size before moving on to a larger table, and
+// for the largest one
+#define JSON_STRUCT_SEEDS (1 << 10)
+#define JSON_STRUCT_LAST_SEEDS (1 << 16)
+
+// -----------
+// Descriptors
+// -----------
+
+static uint32_t json_struct_hash(const char *key, size_t length,
+                                 uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;
+    for (size_t i = 0; i < length; i++) {
+        h ^= (unsigned char)key[i];
+        h *= 16777619u;
+    }
+
+    // FNV leaves the low bits weak, mix the high ones in
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    return h;
+}
+
+// Places every field in a table of mask + 1 slots under seed, or fails on
+// the first collision
+static bool json_struct_place(JSONStruct *s, uint32_t seed, uint32_t mask) {
+    memset(s->slots, 0, mask + 1);
+    for (size_t i = 0; i < s->field_count; i++) {
+        const char *name = s->fields[i].name;
+        uint32_t slot = json_struct_hash(name, strlen(name), seed) & mask;
+        if (s->slots[slot] != 0) {
+            return false;
+        }
+        s->slots[slot] = i + 1;
+    }
+    return true;
+}
+
+// Descriptor errors aren't at a place in any input
+static int json_struct_error(JSONError *error, const JSONField *f) {
+    if (error->code == JSON_ERROR_NONE) {
+        json_error_set(error, JSON_ERROR_STRUCT, NULL, 0);
+        error->field = f != NULL ? f->name : NULL;
+    }
+    return 1;
+}
+
+static int json_struct_check(const JSONStruct *s, JSONError *error) {
+    if (s->field_count > JSON_STRUCT_MAX_FIELDS) {
+        return json_struct_error(error, NULL);
+    }
+
+    for (size_t i = 0; i < s->field_count; i++) {
+        const JSONField *f = &s->fields[i];
+        for (size_t j = 0; j < i; j++) {
+            if (strcmp(s->fields[j].name, f->name) == 0) {
+                // Bound twice
+                return json_struct_error(error, f);
+            }
+        }
+
+        bool nested = f->type == JSON_FIELD_STRUCT ||
+                      (f->type == JSON_FIELD_ARRAY &&
+                       f->element == JSON_FIELD_STRUCT);
+        if ((nested && f->object == NULL) ||
+            (f->type == JSON_FIELD_ARRAY && f->element == JSON_FIELD_ARRAY)) {
+            return json_struct_error(error, f);
+        }
+    }
+    return 0;
+}
+
+int json_struct_init(JSONStruct *s, JSONError *error) {
+    *error = (JSONError){0};
+    if (s->ready) {
+        return 0;
+    }
+    if (json_struct_check(s, error)) {
+        return 1;
+    }
+
+    // Start at twice as many slots as fields, the table grows whenever
+    // no seed spreads the names out
+    uint32_t size = 1;
+    while (size < 2 * s->field_count) size *= 2;
+
+    bool placed = false;
+    for (; size <= JSON_STRUCT_MAX_SLOTS && !placed; size *= 2) {
+        uint32_t seeds = size == JSON_STRUCT_MAX_SLOTS ? JSON_STRUCT_LAST_SEEDS
+                                                       : JSON_STRUCT_SEEDS;
+        for (uint32_t seed = 0; seed < seeds; seed++) {
+            if (json_struct_place(s, seed, size - 1)) {
+                s->seed = seed;
+                s->mask = size - 1;
+                placed = true;
+                break;
+            }
+        }
+    }
+    if (!placed) {
+        // No perfect hash for these names
+        return json_struct_error(error, NULL);
+    }
+
+    // Marked first so self-referencing structs terminate
+    s->ready = true;
+    for (size_t i = 0; i < s->field_count; i++) {
+        JSONStruct *object = s->fields[i].object;
+        if (object != NULL && json_struct_init(object, error)) {
+            s->ready = false;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+const JSONField *json_struct_field(const JSONStruct *s, const char *key,
+                                   size_t length) {
+    uint8_t slot = s->slots[json_struct_hash(key, length, s->seed) & s->mask];
+    if (slot == 0) {
+        return NULL;
+    }
+
+    const JSONField *f = &s->fields[slot - 1];
+    // key may hold a NUL, so it can't stop the comparison early
+    if (strlen(f->name) != length || memcmp(f->name, key, length) != 0) {
+        return NULL;
+    }
+    return f;
+}
+
+static size_t json_field_size(JSONFieldType type, const JSONStruct *object) {
+    switch (type) {
+        case JSON_FIELD_BOOL:
+            return sizeof(bool);
+        case JSON_FIELD_INT:
+            return sizeof(int);
+        case JSON_FIELD_INT64:
+            return sizeof(long long);
+        case JSON_FIELD_DOUBLE:
+            return sizeof(double);
+        case JSON_FIELD_STRING:
+            return sizeof(JSONString);
+        case JSON_FIELD_STRUCT:
+            return object->size;
+        case JSON_FIELD_ARRAY:
+            break;
+    }
+    return 0;
+}
+
+// --------
+// Decoding
+// --------
+
+typedef struct {
+    Arena *a;
+    JSONTokenizer t;
+    size_t depth;
+    JSONError *error;
+} JSONDecoder;
+
+static int json_decode_fail(JSONDecoder *d, JSONErrorCode code) {
+    json_error_set(d->error, code, d->t.content, d->t.current_token.offset);
+    return 1;
+}
+
+// f is the field the value was for, or NULL
+static int json_decode_error(JSONDecoder *d, const char *expected,
+                             const JSONField *f) {
+    if (d->error->code == JSON_ERROR_NONE) {
+        json_decode_fail(d, JSON_ERROR_SYNTAX);
+        d->error->expected = expected;
+        d->error->got = token_names[d->t.current_token.type];
+        d->error->field = f != NULL ? f->name : NULL;
+    }
+    return 1;
+}
+
+static int json_decode_next(JSONDecoder *d) {
+    if (json_next_token(d->a, &d->t)) {
+        if (d->error->code == JSON_ERROR_NONE) {
+            *d->error = d->t.error;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+// Steps over the value of an unknown key, checking only that its brackets
+// pair up. Anything it allocated is given back.
+static int json_decode_skip(JSONDecoder *d) {
+    ArenaMark mark = arena_mark(d->a);
+    uint64_t objects[JSON_MAX_DEPTH / 64] = {0};  // Bit set per open object
+    size_t depth = 0;
+
+    do {
+        JSONTokenType type = d->t.current_token.type;
+        switch (type) {
+            case LEFT_CURLY:
+            case LEFT_SQUARE:
+                if (d->depth + depth >= JSON_MAX_DEPTH) {
+                    return json_decode_fail(d, JSON_ERROR_DEPTH);
+                }
+                if (type == LEFT_CURLY) {
+                    objects[depth / 64] |= (uint64_t)1 << depth % 64;
+                } else {
+                    objects[depth / 64] &= ~((uint64_t)1 << depth % 64);
+                }
+                ++depth;
+                break;
+            case RIGHT_CURLY:
+            case RIGHT_SQUARE:
+                if (depth == 0 ||
+                    (bool)(objects[(depth - 1) / 64] >> (depth - 1) % 64 &
+                           1) != (type == RIGHT_CURLY)) {
+                    return json_decode_error(d, "json element", NULL);
+                }
+                --depth;
+                break;
+            case COMMA:
+            case COLON:
+            case END:
+                if (depth == 0 || type == END) {
+                    return json_decode_error(d, "json element", NULL);
+                }
+                break;
+            default:
+                break;
+        }
+
+        if (json_decode_next(d)) return 1;
+    } while (depth > 0);
+
+    // The token after the value is a ',' or '}', nothing refers to the
+    // arena past the mark
+    arena_rewind(d->a, mark);
+    return 0;
+}
+
+static int json_decode_object(JSONDecoder *d, const JSONStruct *s, char *out);
+static int json_decode_array(JSONDecoder *d, const JSONField *f, char *base);
+
+// Decodes the value at the current token into out, which is zeroed
+static int json_decode_value(JSONDecoder *d, const JSONField *f,
+                             JSONFieldType type, const JSONStruct *object,
+                             void *out) {
+    JSONToken tok = d->t.current_token;
+    if (tok.type == NULL_TOKEN) {
+        return json_decode_next(d);
+    }
+
+    switch (type) {
+        case JSON_FIELD_BOOL:
+            if (tok.type != TRUE && tok.type != FALSE) {
+                return json_decode_error(d, "boolean", f);
+            }
+            *(bool *)out = tok.type == TRUE;
+            break;
+        case JSON_FIELD_INT:
+            if (tok.type != NUMBER_INT || tok.value.number_int < INT_MIN ||
+                tok.value.number_int > INT_MAX) {
+                return json_decode_error(d, "32-bit int", f);
+            }
+            *(int *)out = tok.value.number_int;
+            break;
+        case JSON_FIELD_INT64:
+            if (tok.type != NUMBER_INT) {
+                return json_decode_error(d, "int", f);
+            }
+            *(long long *)out = tok.value.number_int;
+            break;
+        case JSON_FIELD_DOUBLE:
+            if (tok.type == NUMBER_INT) {
+                *(double *)out = tok.value.number_int;
+            } else if (tok.type == NUMBER_UINT) {
+                *(double *)out = tok.value.number_uint;
+            } else if (tok.type == NUMBER_FLOAT) {
+                *(double *)out = tok.value.number_float;
+            } else {
+                return json_decode_error(d, "float", f);
+            }
+            break;
+        case JSON_FIELD_STRING:
+            if (tok.type != STRING) {
+                return json_decode_error(d, "string", f);
+            }
+            *(JSONString *)out = tok.value.string;
+            break;
+        case JSON_FIELD_STRUCT:
+            if (tok.type != LEFT_CURLY) {
+                return json_decode_error(d, "object", f);
+            }
+            return json_decode_object(d, object, out);
+        case JSON_FIELD_ARRAY:
+            // Arrays of arrays are refused by json_struct_init
+            return json_struct_error(d->error, f);
+    }
+
+    return json_decode_next(d);
+}
+
+static int json_decode_object(JSONDecoder *d, const JSONStruct *s,
+                              char *out) {
+    if (++d->depth > JSON_MAX_DEPTH) {
+        return json_decode_fail(d, JSON_ERROR_DEPTH);
+    }
+
+    // Skip the opening brace, then handle the special case of an empty
+    // object
+    if (json_decode_next(d)) return 1;
+    bool empty = d->t.current_token.type == RIGHT_CURLY;
+
+    while (!empty) {
+        if (d->t.current_token.type != STRING) {
+            return json_decode_error(d, token_names[STRING], NULL);
+        }
+        JSONString key = d->t.current_token.value.string;
+        const JSONField *f = json_struct_field(s, key.data, key.length);
+
+        if (json_decode_next(d)) return 1;
+        if (d->t.current_token.type != COLON) {
+            return json_decode_error(d, token_names[COLON], NULL);
+        }
+        if (json_decode_next(d)) return 1;
+
+        int error;
+        if (f == NULL) {
+            error = json_decode_skip(d);
+        } else if (f->type == JSON_FIELD_ARRAY) {
+            error = json_decode_array(d, f, out);
+        } else {
+            error = json_decode_value(d, f, f->type, f->object,
+                                      out + f->offset);
+        }
+        if (error) return 1;
+
+        if (d->t.current_token.type == RIGHT_CURLY) break;
+        if (d->t.current_token.type != COMMA) {
+            return json_decode_error(d, "',' or '}'", NULL);
+        }
+        if (json_decode_next(d)) return 1;
+    }
+
+    --d->depth;
+    return json_decode_next(d);
+}
+
+// Decodes the array at the current token into the elements and count of
+// field f of the struct at base. The elements are grown in the arena,
+// which is cheaper than a heap buffer when most arrays are short.
+static int json_decode_array(JSONDecoder *d, const JSONField *f,
+                             char *base) {
+    JSONToken tok = d->t.current_token;
+    if (tok.type == NULL_TOKEN) {
+        return json_decode_next(d);
+    }
+    if (tok.type != LEFT_SQUARE) {
+        return json_decode_error(d, "array", f);
+    }
+
+    size_t size = json_field_size(f->element, f->object);
+    char *elements = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+
+    if (json_decode_next(d)) return 1;
+    bool empty = d->t.current_token.type == RIGHT_SQUARE;
+
+    while (!empty) {
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 8;
+            char *grown = arena_alloc(d->a, size * capacity);
+            if (grown == NULL) return json_decode_fail(d, JSON_ERROR_MEMORY);
+            if (count > 0) memcpy(grown, elements, size * count);
+            elements = grown;
+        }
+
+        char *element = elements + size * count++;
+        memset(element, 0, size);
+        if (json_decode_value(d, f, f->element, f->object, element)) {
+            return 1;
+        }
+
+        if (d->t.current_token.type == RIGHT_SQUARE) break;
+        if (d->t.current_token.type != COMMA) {
+            return json_decode_error(d, "',' or ']'", f);
+        }
+        if (json_decode_next(d)) return 1;
+    }
+
+    *(void **)(base + f->offset) = elements;
+    *(size_t *)(base + f->count_offset) = count;
+    return json_decode_next(d);
+}
+
+int json_decode(Arena *a, const JSONStruct *s, const char *buf, size_t len,
+                void *out, JSONError *error) {
+    *error = (JSONError){0};
+    if (buf == NULL) {
+        json_error_set(error, JSON_ERROR_ARGUMENT, NULL, 0);
+        return 1;
+    }
+    if (!s->ready) {
+        return json_struct_error(error, NULL);
+    }
+    memset(out, 0, s->size);
+
+    // A rejected document leaves nothing behind in a
+    ArenaMark mark = arena_mark(a);
+
+    JSONDecoder d = {.a = a, .error = error};
+    json_tokenizer_init(&d.t, buf, len);
+    d.t.borrow = true;
+
+    int failed = json_decode_next(&d);
+    if (!failed) {
+        if (d.t.current_token.type == LEFT_CURLY) {
+            failed = json_decode_object(&d, s, out);
+        } else {
+            failed = json_decode_error(&d, token_names[LEFT_CURLY], NULL);
+        }
+    }
+    if (!failed && d.t.current_token.type != END) {
+        failed = json_decode_error(&d, token_names[END], NULL);
+    }
+
+    if (failed) {
+        arena_rewind(a, mark);
+    }
+    return failed;
+}
+
+// --------
+// Encoding
+// --------
+
+static void json_encode_struct(JSONWriter *w, const JSONStruct *s,
+                               const char *in);
+
+static void json_encode_value(JSONWriter *w, JSONFieldType type,
+                              const JSONStruct *object, const void *in) {
+    switch (type) {
+        case JSON_FIELD_BOOL:
+            json_write_bool(w, *(const bool *)in);
+            break;
+        case JSON_FIELD_INT:
+            json_write_int(w, *(const int *)in);
+            break;
+        case JSON_FIELD_INT64:
+            json_write_int(w, *(const long long *)in);
+            break;
+        case JSON_FIELD_DOUBLE:
+            json_write_float(w, *(const double *)in);
+            break;
+        case JSON_FIELD_STRING: {
+            const JSONString *string = in;
+            if (string->data == NULL) {
+                json_write_null(w);
+            } else {
+                json_write_string(w, *string);
+            }
+            break;
+        }
+        case JSON_FIELD_STRUCT:
+            json_encode_struct(w, object, in);
+            break;
+        case JSON_FIELD_ARRAY:
+            break;
+    }
+}
+
+static void json_encode_struct(JSONWriter *w, const JSONStruct *s,
+                               const char *in) {
+    json_write_object_start(w);
+    for (size_t i = 0; i < s->field_count && !w->error; i++) {
+        const JSONField *f = &s->fields[i];
+        json_write_key(w, (JSONString){.data = f->name,
+                                       .length = strlen(f->name)});
+
+        if (f->type != JSON_FIELD_ARRAY) {
+            json_encode_value(w, f->type, f->object, in + f->offset);
+            continue;
+        }
+
+        const char *elements = *(char *const *)(in + f->offset);
+        size_t count = *(const size_t *)(in + f->count_offset);
+        size_t size = json_field_size(f->element, f->object);
+
+        json_write_array_start(w);
+        for (size_t j = 0; j < count; j++) {
+            json_encode_value(w, f->element, f->object, elements + size * j);
+        }
+        json_write_array_end(w);
+    }
+    json_write_object_end(w);
+}
+
+int json_encode(JSONWriter *w, const JSONStruct *s, const void *in) {
+    json_encode_struct(w, s, in);
+    if (w->write != NULL) {
+        json_writer_flush(w);
+    }
+    return w->error;
+}
@@ -0,0 +1,165 @@
+#include "builder.h"
+
+#include <stdalign.h>
+
+// Adds a complete value (or a container that was just opened) to the
+// innermost open container, or makes it the root
+static int json_builder_add(JSONBuilder *b, JSONElement element) {
+    if (b->depth == 0) {
+        b->root = element;
+        return 0;
+    }
+
+    JSONBuilderFrame *frame = &b->stack[b->depth - 1];
+    if (frame->container.type == JSON_ELEMENT_ARRAY) {
+        JSONArray *array = frame->container.element.array;
+        JSONArrayElement *array_element = arena_alloc_aligned(
+            b->arena, sizeof(JSONArrayElement), alignof(JSONArrayElement));
+        if (array_element == NULL) {
+            return 1;
+        }
+        *array_element = (JSONArrayElement){.element = element, .next = NULL};
+
+        if (array->head == NULL) {
+            array->head = array_element;
+        } else {
+            array->tail->next = array_element;
+        }
+        array->tail = array_element;
+    } else {
+        JSONObject *object = frame->container.element.object;
+        JSONPair *pair =
+            arena_alloc_aligned(b->arena, sizeof(JSONPair), alignof(JSONPair));
+        if (pair == NULL) {
+            return 1;
+        }
+        *pair = (JSONPair){.key = frame->key, .value = element, .next = NULL};
+
+        if (object->head == NULL) {
+            object->head = pair;
+        } else {
+            object->tail->next = pair;
+        }
+        object->tail = pair;
+        ++object->count;
+    }
+    return 0;
+}
+
+static int json_builder_open(JSONBuilder *b, JSONElement container) {
+    if (json_builder_add(b, container)) {
+        return 1;
+    }
+
+    if (b->depth == JSON_MAX_DEPTH) {
+        return 1;
+    }
+    b->stack[b->depth++] = (JSONBuilderFrame){.container = container};
+    return 0;
+}
+
+static int json_builder_close(void *context) {
+    JSONBuilder *b = context;
+    --b->depth;
+    return 0;
+}
+
+static int json_builder_object_start(void *context) {
+    JSONBuilder *b = context;
+    JSONObject *object =
+        arena_alloc_aligned(b->arena, sizeof(JSONObject), alignof(JSONObject));
+    if (object == NULL) {
+        return 1;
+    }
+    *object = (JSONObject){.intern = b->intern};
+
+    return json_builder_open(b, (JSONElement){.type = JSON_ELEMENT_OBJECT,
+                                              .element.object = object});
+}
+
+static int json_builder_array_start(void *context) {
+    JSONBuilder *b = context;
+    JSONArray *array =
+        arena_alloc_aligned(b->arena, sizeof(JSONArray), alignof(JSONArray));
+    if (array == NULL) {
+        return 1;
+    }
+    *array = (JSONArray){.head = NULL, .tail = NULL};
+
+    return json_builder_open(b, (JSONElement){.type = JSON_ELEMENT_ARRAY,
+                                              .element.array = array});
+}
+
+static int json_builder_key(void *context, JSONString key) {
+    JSONBuilder *b = context;
+    b->stack[b->depth - 1].key = key;
+    return 0;
+}
+
+static int json_builder_value(JSONBuilder *b, JSONValue value) {
+    return json_builder_add(
+        b, (JSONElement){.type = JSON_ELEMENT_VALUE, .element.value = value});
+}
+
+static int json_builder_string(void *context, JSONString value) {
+    return json_builder_value(
+        context, (JSONValue){.type = JSON_VALUE_STRING, .value.string = value});
+}
+
+static int json_builder_int(void *context, long long value) {
+    return json_builder_value(
+        context,
+        (JSONValue){.type = JSON_VALUE_NUMBER_INT, .value.number_int = value});
+}
+
+static int json_builder_uint(void *context, unsigned long long value) {
+    return json_builder_value(
+        context,
+        (JSONValue){.type = JSON_VALUE_NUMBER_UINT,
+                    .value.number_uint = value});
+}
+
+static int json_builder_float(void *context, double value) {
+    return json_builder_value(
+        context,
+        (JSONValue){.type = JSON_VALUE_NUMBER_FLOAT,
+                    .value.number_float = value});
+}
+
+static int json_builder_number(void *context, JSONString digits) {
+    return json_builder_value(
+        context,
+        (JSONValue){.type = JSON_VALUE_NUMBER_RAW, .value.string = digits});
+}
+
+static int json_builder_bool(void *context, bool value) {
+    return json_builder_value(
+        context,
+        (JSONValue){.type = JSON_VALUE_BOOLEAN, .value.boolean = value});
+}
+
+static int json_builder_null(void *context) {
+    return json_builder_value(context, (JSONValue){.type = JSON_VALUE_NULL});
+}
+
+const JSONCallbacks json_builder_callbacks = {
+    .on_object_start = json_builder_object_start,
+    .on_object_end = json_builder_close,
+    .on_array_start = json_builder_array_start,
+    .on_array_end = json_builder_close,
+    .on_key = json_builder_key,
+    .on_string = json_builder_string,
+    .on_int = json_builder_int,
+    .on_uint = json_builder_uint,
+    .on_float = json_builder_float,
+    .on_number = json_builder_number,
+    .on_bool = json_builder_bool,
+    .on_null = json_builder_null,
+};
+
+void json_builder_init(JSONBuilder *b, Arena *a) {
+    b->arena = a;
+    b->root = (JSONElement){0};
+    b->intern = NULL;
+    b->depth = 0;
+}
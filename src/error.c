@@ -0,0 +1,112 @@
+#include "error.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+void json_error_set(JSONError *error, JSONErrorCode code, const char *content,
+                    size_t offset) {
+    if (error->code != JSON_ERROR_NONE) {
+        return;
+    }
+
+    // Only ever done once per parse, so the lines are simply counted
+    size_t line = 1;
+    size_t line_start = 0;
+    if (content != NULL) {
+        const char *p = content;
+        const char *end = content + offset;
+        while ((p = memchr(p, '\n', end - p)) != NULL) {
+            ++line;
+            line_start = ++p - content;
+        }
+    }
+
+    *error = (JSONError){.code = code,
+                         .offset = offset,
+                         .line = line,
+                         .col = offset - line_start + 1};
+}
+
+const char *json_error_string(JSONErrorCode code) {
+    switch (code) {
+        case JSON_ERROR_NONE:
+            return "No error";
+        case JSON_ERROR_SYNTAX:
+            return "Unexpected token";
+        case JSON_ERROR_STRING:
+            return "Invalid string";
+        case JSON_ERROR_NUMBER:
+            return "Invalid number";
+        case JSON_ERROR_LITERAL:
+            return "Invalid literal";
+        case JSON_ERROR_DEPTH:
+            return "Maximum JSON element depth reached";
+        case JSON_ERROR_MEMORY:
+            return "Out of memory";
+        case JSON_ERROR_IO:
+            return "Failed to read or write file";
+        case JSON_ERROR_ARGUMENT:
+            return "No input";
+        case JSON_ERROR_SIZE:
+            return "Too large";
+        case JSON_ERROR_BINARY:
+            return "Not a supported binary JSON document";
+        case JSON_ERROR_STRUCT:
+            return "Invalid struct descriptor";
+    }
+    return "Unknown error";
+}
+
+// Appends to the message written so far, which may have been cut short
+static int json_error_append(char *buf, size_t size, int length,
+                             const char *format, ...) {
+    if (length < 0) {
+        return length;
+    }
+
+    va_list args;
+    va_start(args, format);
+    size_t at = (size_t)length < size ? (size_t)length : size;
+    int added = vsnprintf(buf + at, size - at, format, args);
+    va_end(args);
+    return added < 0 ? added : length + added;
+}
+
+int json_error_format(const JSONError *error, const char *source, char *buf,
+                      size_t size) {
+    if (source == NULL) {
+        source = "<string>";
+    }
+
+    int length;
+    if (error->code == JSON_ERROR_IO || error->code == JSON_ERROR_ARGUMENT ||
+        error->code == JSON_ERROR_BINARY || error->code == JSON_ERROR_STRUCT) {
+        length = snprintf(buf, size, "%s: ", source);
+    } else {
+        length = snprintf(buf, size, "%s:%zu:%zu: ", source, error->line,
+                          error->col);
+    }
+
+    if (error->code == JSON_ERROR_SYNTAX && error->expected != NULL) {
+        length = json_error_append(buf, size, length, "Expected %s",
+                                   error->expected);
+        if (error->field != NULL) {
+            length = json_error_append(buf, size, length, " for %s",
+                                       error->field);
+        }
+        if (error->got != NULL) {
+            length = json_error_append(buf, size, length, ", got %s",
+                                       error->got);
+        }
+        return length;
+    }
+
+    length = json_error_append(buf, size, length, "%s",
+                               json_error_string(error->code));
+    if (error->field != NULL) {
+        length = json_error_append(buf, size, length, ", field %s",
+                                   error->field);
+    }
+    return length;
+}
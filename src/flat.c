@@ -0,0 +1,252 @@
+#include "flat.h"
+
+#include <string.h>
+
+#include "parser.h"
+
+typedef struct {
+    JSONTokenizer tokenizer;
+    // Children of every container still open, each container copies its
+    // own off the top into one arena block when it closes. The stack is the
+    // only allocation in scratch, which takes its regions from the tree's
+    // pool, so it grows by resetting scratch and allocating again.
+    Arena scratch;
+    JSONNode *stack;
+    size_t size;
+    size_t capacity;
+    size_t depth;
+    JSONError *error;
+} JSONFlatParser;
+
+static int json_flat_fail(JSONFlatParser *p, JSONErrorCode code) {
+    json_error_set(p->error, code, p->tokenizer.content,
+                   p->tokenizer.current_token.offset);
+    return 1;
+}
+
+static int json_flat_error(JSONFlatParser *p, const char *expected) {
+    if (p->error->code == JSON_ERROR_NONE) {
+        json_flat_fail(p, JSON_ERROR_SYNTAX);
+        p->error->expected = expected;
+        p->error->got = token_names[p->tokenizer.current_token.type];
+    }
+    return 1;
+}
+
+// Lexes the next token, passing on why it failed if it did
+static int json_flat_next(Arena *a, JSONFlatParser *p) {
+    if (json_next_token(a, &p->tokenizer)) {
+        if (p->error->code == JSON_ERROR_NONE) {
+            *p->error = p->tokenizer.error;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+static int json_flat_push(JSONFlatParser *p, JSONNode node) {
+    if (p->size == p->capacity) {
+        size_t capacity = p->capacity ? p->capacity * 2 : INIT_CAPACITY;
+        // The nodes stay where they are when the region has room, and are
+        // copied over otherwise
+        arena_reset(&p->scratch);
+        JSONNode *stack =
+            arena_alloc(&p->scratch, sizeof(JSONNode) * capacity);
+        if (stack == NULL) {
+            return json_flat_fail(p, JSON_ERROR_MEMORY);
+        }
+        if (stack != p->stack && p->size > 0) {
+            memcpy(stack, p->stack, sizeof(JSONNode) * p->size);
+        }
+        p->stack = stack;
+        p->capacity = capacity;
+    }
+
+    p->stack[p->size++] = node;
+    return 0;
+}
+
+// Nodes hold string lengths and child counts in 32 bits
+static int json_flat_check_count(JSONFlatParser *p, size_t count) {
+    if (count > UINT32_MAX) {
+        return json_flat_fail(p, JSON_ERROR_SIZE);
+    }
+    return 0;
+}
+
+static int json_flat_string(JSONFlatParser *p, JSONString string,
+                            JSONNode *out) {
+    if (json_flat_check_count(p, string.length)) return 1;
+    *out = (JSONNode){.type = JSON_NODE_STRING,
+                      .count = string.length,
+                      .value.string = string.data};
+    return 0;
+}
+
+static int json_flat_parse_value(Arena *a, JSONFlatParser *p, JSONNode *out);
+
+static int json_flat_parse_container(Arena *a, JSONFlatParser *p,
+                                     JSONNode *out, bool object) {
+    JSONTokenizer *t = &p->tokenizer;
+    JSONTokenType close = object ? RIGHT_CURLY : RIGHT_SQUARE;
+    size_t base = p->size;
+
+    // Skip the opening brace, then handle the special case of an empty
+    // container
+    if (json_flat_next(a, p)) return 1;
+    bool empty = t->current_token.type == close;
+
+    while (!empty) {
+        if (object) {
+            if (t->current_token.type != STRING) {
+                return json_flat_error(p, token_names[STRING]);
+            }
+
+            JSONNode key;
+            if (json_flat_string(p, t->current_token.value.string, &key) ||
+                json_flat_push(p, key)) {
+                return 1;
+            }
+
+            if (json_flat_next(a, p)) return 1;
+            if (t->current_token.type != COLON) {
+                return json_flat_error(p, token_names[COLON]);
+            }
+            if (json_flat_next(a, p)) return 1;
+        }
+
+        JSONNode value;
+        if (json_flat_parse_value(a, p, &value)) return 1;
+        if (json_flat_push(p, value)) return 1;
+
+        if (t->current_token.type == close) break;
+        if (t->current_token.type != COMMA) {
+            return json_flat_error(p, object ? "',' or '}'" : "',' or ']'");
+        }
+        if (json_flat_next(a, p)) return 1;
+    }
+
+    size_t count = p->size - base;
+    if (json_flat_check_count(p, object ? count / 2 : count)) return 1;
+    JSONNode *children = NULL;
+    if (count > 0) {
+        children = arena_alloc(a, sizeof(JSONNode) * count);
+        if (children == NULL) return json_flat_fail(p, JSON_ERROR_MEMORY);
+        memcpy(children, p->stack + base, sizeof(JSONNode) * count);
+    }
+    p->size = base;
+
+    *out = (JSONNode){.type = object ? JSON_NODE_OBJECT : JSON_NODE_ARRAY,
+                      .count = object ? count / 2 : count,
+                      .value.children = children};
+
+    // Skip the closing brace
+    return json_flat_next(a, p);
+}
+
+static int json_flat_parse_value(Arena *a, JSONFlatParser *p, JSONNode *out) {
+    JSONTokenizer *t = &p->tokenizer;
+    JSONToken tok = t->current_token;
+
+    if (p->depth >= JSON_MAX_DEPTH) {
+        return json_flat_fail(p, JSON_ERROR_DEPTH);
+    }
+
+    switch (tok.type) {
+        case LEFT_CURLY:
+        case LEFT_SQUARE: {
+            ++p->depth;
+            int error = json_flat_parse_container(a, p, out,
+                                                  tok.type == LEFT_CURLY);
+            --p->depth;
+            return error;
+        }
+        case STRING:
+            if (json_flat_string(p, tok.value.string, out)) return 1;
+            break;
+        case NUMBER_INT:
+            *out = (JSONNode){.type = JSON_NODE_INT,
+                              .value.number_int = tok.value.number_int};
+            break;
+        case NUMBER_UINT:
+            *out = (JSONNode){.type = JSON_NODE_UINT,
+                              .value.number_uint = tok.value.number_uint};
+            break;
+        case NUMBER_FLOAT:
+            *out = (JSONNode){.type = JSON_NODE_FLOAT,
+                              .value.number_float = tok.value.number_float};
+            break;
+        case TRUE:
+        case FALSE:
+            *out = (JSONNode){.type = JSON_NODE_BOOLEAN,
+                              .value.boolean = tok.type == TRUE};
+            break;
+        case NULL_TOKEN:
+            *out = (JSONNode){.type = JSON_NODE_NULL};
+            break;
+        default:
+            return json_flat_error(p, "json element");
+    }
+
+    return json_flat_next(a, p);
+}
+
+JSONNode *json_parse_flat(Arena *a, const char *buf, size_t len,
+                          JSONError *error) {
+    *error = (JSONError){0};
+    if (buf == NULL) {
+        json_error_set(error, JSON_ERROR_ARGUMENT, NULL, 0);
+        return NULL;
+    }
+
+    ArenaMark mark = arena_mark(a);
+    JSONNode *root = arena_alloc(a, sizeof(JSONNode));
+    if (root == NULL) {
+        json_error_set(error, JSON_ERROR_MEMORY, NULL, 0);
+        return NULL;
+    }
+
+    JSONFlatParser p = {.scratch = {.pool = a->pool}, .error = error};
+    json_tokenizer_init(&p.tokenizer, buf, len);
+    p.tokenizer.borrow = true;
+
+    int failed = json_flat_next(a, &p) || json_flat_parse_value(a, &p, root);
+    if (!failed && p.tokenizer.current_token.type != END) {
+        failed = json_flat_error(&p, token_names[END]);
+    }
+
+    arena_free(&p.scratch);
+    if (failed) {
+        arena_rewind(a, mark);
+        return NULL;
+    }
+    return root;
+}
+
+size_t json_node_size(const JSONNode *node) {
+    if (node->type != JSON_NODE_OBJECT && node->type != JSON_NODE_ARRAY) {
+        return 0;
+    }
+    return node->count;
+}
+
+JSONNode *json_node_get(const JSONNode *array, size_t index) {
+    if (array->type != JSON_NODE_ARRAY || index >= array->count) {
+        return NULL;
+    }
+    return &array->value.children[index];
+}
+
+JSONNode *json_node_key(const JSONNode *object, size_t index) {
+    if (object->type != JSON_NODE_OBJECT || index >= object->count) {
+        return NULL;
+    }
+    return &object->value.children[2 * index];
+}
+
+JSONNode *json_node_value(const JSONNode *object, size_t index) {
+    if (object->type != JSON_NODE_OBJECT || index >= object->count) {
+        return NULL;
+    }
+    return &object->value.children[2 * index + 1];
+}
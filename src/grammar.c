@@ -0,0 +1,89 @@
+#include "grammar.h"
+
+static const char *expect_names[] = {
+    [JSON_EXPECT_VALUE] = "json element",
+    [JSON_EXPECT_VALUE_OR_CLOSE] = "json element",
+    [JSON_EXPECT_KEY_OR_CLOSE] = "string",
+    [JSON_EXPECT_KEY] = "string",
+    [JSON_EXPECT_COLON] = ":",
+    [JSON_EXPECT_ARRAY_NEXT] = "',' or ']'",
+    [JSON_EXPECT_OBJECT_NEXT] = "',' or '}'",
+    [JSON_EXPECT_END] = "eof",
+};
+
+void json_grammar_init(JSONGrammar *g, size_t max_depth) {
+    g->expect = JSON_EXPECT_VALUE;
+    g->depth = 0;
+    g->max_depth = max_depth < JSON_MAX_DEPTH ? max_depth : JSON_MAX_DEPTH;
+    g->after[0] = JSON_EXPECT_END;
+}
+
+static JSONGrammarStep json_grammar_close(JSONGrammar *g) {
+    // The container is a value in the one around it
+    g->expect = g->after[--g->depth];
+    return JSON_GRAMMAR_CLOSE;
+}
+
+static JSONGrammarStep json_grammar_open(JSONGrammar *g, char c) {
+    if (g->depth == g->max_depth) {
+        return JSON_GRAMMAR_DEPTH;
+    }
+    ++g->depth;
+    if (c == '[') {
+        g->after[g->depth] = JSON_EXPECT_ARRAY_NEXT;
+        g->expect = JSON_EXPECT_VALUE_OR_CLOSE;
+    } else {
+        g->after[g->depth] = JSON_EXPECT_OBJECT_NEXT;
+        g->expect = JSON_EXPECT_KEY_OR_CLOSE;
+    }
+    return JSON_GRAMMAR_OPEN;
+}
+
+JSONGrammarStep json_grammar_step(JSONGrammar *g, char c) {
+    switch (g->expect) {
+        case JSON_EXPECT_VALUE_OR_CLOSE:
+            if (c == ']') return json_grammar_close(g);
+            // fall through
+        case JSON_EXPECT_VALUE:
+            if (c == '[' || c == '{') {
+                return json_grammar_open(g, c);
+            }
+            if (c == ']' || c == '}' || c == ',' || c == ':') {
+                return JSON_GRAMMAR_UNEXPECTED;
+            }
+            g->expect = g->after[g->depth];
+            return JSON_GRAMMAR_VALUE;
+        case JSON_EXPECT_KEY_OR_CLOSE:
+            if (c == '}') return json_grammar_close(g);
+            // fall through
+        case JSON_EXPECT_KEY:
+            if (c != '"') return JSON_GRAMMAR_UNEXPECTED;
+            g->expect = JSON_EXPECT_COLON;
+            return JSON_GRAMMAR_KEY;
+        case JSON_EXPECT_COLON:
+            if (c != ':') return JSON_GRAMMAR_UNEXPECTED;
+            g->expect = JSON_EXPECT_VALUE;
+            return JSON_GRAMMAR_PUNCT;
+        case JSON_EXPECT_ARRAY_NEXT:
+            if (c == ']') return json_grammar_close(g);
+            if (c != ',') return JSON_GRAMMAR_UNEXPECTED;
+            g->expect = JSON_EXPECT_VALUE;
+            return JSON_GRAMMAR_PUNCT;
+        case JSON_EXPECT_OBJECT_NEXT:
+            if (c == '}') return json_grammar_close(g);
+            if (c != ',') return JSON_GRAMMAR_UNEXPECTED;
+            g->expect = JSON_EXPECT_KEY;
+            return JSON_GRAMMAR_PUNCT;
+        case JSON_EXPECT_END:
+            break;
+    }
+    return JSON_GRAMMAR_UNEXPECTED;
+}
+
+bool json_grammar_done(const JSONGrammar *g) {
+    return g->expect == JSON_EXPECT_END;
+}
+
+const char *json_grammar_expected(const JSONGrammar *g) {
+    return expect_names[g->expect];
+}
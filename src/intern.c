@@ -0,0 +1,83 @@
+#include "intern.h"
+
+#include <stdalign.h>
+#include <string.h>
+
+#include "utils.h"
+
+#define JSON_INTERN_INIT_CAPACITY 256
+
+void json_intern_init(JSONInternPool *pool, size_t max_value_length) {
+    *pool = (JSONInternPool){.max_value_length = max_value_length};
+}
+
+void json_intern_free(JSONInternPool *pool) {
+    arena_free(&pool->strings);
+    free(pool->slots);
+    *pool = (JSONInternPool){0};
+}
+
+// Doubles the table, keeping the load factor at or below one half
+static int json_intern_grow(JSONInternPool *pool) {
+    size_t capacity =
+        pool->capacity ? pool->capacity * 2 : JSON_INTERN_INIT_CAPACITY;
+    JSONInternSlot *slots = calloc(capacity, sizeof(JSONInternSlot));
+    if (slots == NULL) {
+        return 1;
+    }
+
+    for (size_t i = 0; i < pool->capacity; i++) {
+        JSONInternSlot slot = pool->slots[i];
+        if (slot.string.data == NULL) continue;
+
+        size_t j = slot.hash & (capacity - 1);
+        while (slots[j].string.data != NULL) {
+            j = (j + 1) & (capacity - 1);
+        }
+        slots[j] = slot;
+    }
+
+    free(pool->slots);
+    pool->slots = slots;
+    pool->capacity = capacity;
+    return 0;
+}
+
+JSONString json_intern(JSONInternPool *pool, const char *data, size_t length) {
+    ++pool->lookups;
+    if (pool->count * 2 >= pool->capacity && json_intern_grow(pool)) {
+        return (JSONString){0};
+    }
+
+    size_t hash = hash_bytes(data, length);
+    size_t i = hash & (pool->capacity - 1);
+    while (pool->slots[i].string.data != NULL) {
+        JSONInternSlot *slot = &pool->slots[i];
+        if (slot->hash == hash && slot->string.length == length &&
+            memcmp(slot->string.data, data, length) == 0) {
+            return slot->string;
+        }
+        i = (i + 1) & (pool->capacity - 1);
+    }
+
+    // Stored right after its hash, which json_intern_hash reads back
+    size_t *header = arena_alloc_aligned(
+        &pool->strings, sizeof(size_t) + length + 1, alignof(size_t));
+    if (header == NULL) {
+        return (JSONString){0};
+    }
+    *header = hash;
+    char *copy = (char *)(header + 1);
+    memcpy(copy, data, length);
+    copy[length] = '\0';
+
+    JSONString string = {.data = copy, .length = length};
+    pool->slots[i] = (JSONInternSlot){.hash = hash, .string = string};
+    ++pool->count;
+    pool->bytes += length;
+    return string;
+}
+
+size_t json_intern_hash(JSONString interned) {
+    return ((const size_t *)interned.data)[-1];
+}
@@ -0,0 +1,504 @@
+#include "lazy.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "grammar.h"
+#include "number.h"
+#include "scan.h"
+#include "utils.h"
+
+// String and scalar state carried from one block to the next
+typedef struct {
+    bool in_string;
+    bool escaped;  // The first byte of the next block is escaped
+    bool scalar;   // The last byte was part of a scalar
+} JSONLazyScan;
+
+static int json_lazy_fail(const JSONLazyDocument *doc, JSONErrorCode code,
+                          size_t offset, JSONError *error) {
+    json_error_set(error, code, doc->buf, offset);
+    return 1;
+}
+
+static int json_lazy_error(const JSONLazyDocument *doc, size_t offset,
+                           const char *expected, JSONError *error) {
+    const char *got =
+        json_token_name_at(doc->buf + offset, doc->buf + doc->len);
+    if (got == NULL) {
+        // Not the start of any token, as the tokenizer reports it
+        return json_lazy_fail(doc, JSON_ERROR_LITERAL, offset, error);
+    }
+    if (error->code == JSON_ERROR_NONE) {
+        json_lazy_fail(doc, JSON_ERROR_SYNTAX, offset, error);
+        error->expected = expected;
+        error->got = got;
+    }
+    return 1;
+}
+
+// Sets every bit from each set bit up to (not including) the next one
+static uint64_t json_prefix_xor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+// Bytes following an odd run of backslashes
+static uint64_t json_escaped_mask(uint64_t backslash, bool *carry) {
+    uint64_t escaped = 0;
+    if (*carry) {
+        escaped = 1;
+        backslash &= ~(uint64_t)1;
+    }
+
+    *carry = false;
+    while (backslash != 0) {
+        int i = __builtin_ctzll(backslash);
+        if (i == JSON_BLOCK_SIZE - 1) {
+            *carry = true;
+            break;
+        }
+        escaped |= (uint64_t)2 << i;
+        backslash &= ~((uint64_t)3 << i);
+    }
+    return escaped;
+}
+
+// Bit i is set if byte i of the block starts a token: a structural
+// character or an opening quote outside strings, or the first byte of a
+// literal or number
+static uint64_t json_lazy_tokens(const char *block, JSONLazyScan *s) {
+    JSONBlockMasks m;
+    json_classify_block(block, &m);
+
+    uint64_t quote = m.quote & ~json_escaped_mask(m.backslash, &s->escaped);
+    uint64_t in_string = json_prefix_xor(quote);
+    if (s->in_string) {
+        in_string = ~in_string;
+    }
+    s->in_string = in_string >> (JSON_BLOCK_SIZE - 1);
+
+    uint64_t scalar = ~(m.structural | m.whitespace | m.quote) & ~in_string;
+    uint64_t scalar_start = scalar & ~(scalar << 1 | s->scalar);
+    s->scalar = scalar >> (JSON_BLOCK_SIZE - 1);
+
+    return (m.structural & ~in_string) | (quote & in_string) | scalar_start;
+}
+
+static int json_lazy_index(JSONLazyDocument *doc, JSONError *error) {
+    size_t capacity = 0;
+    JSONLazyScan s = {0};
+
+    for (size_t base = 0; base < doc->len; base += JSON_BLOCK_SIZE) {
+        uint64_t tokens;
+        if (doc->len - base >= JSON_BLOCK_SIZE) {
+            tokens = json_lazy_tokens(doc->buf + base, &s);
+        } else {
+            // Pad the last partial block with whitespace
+            char tail[JSON_BLOCK_SIZE];
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, doc->buf + base, doc->len - base);
+            tokens = json_lazy_tokens(tail, &s);
+        }
+
+        if (doc->count + JSON_BLOCK_SIZE > capacity) {
+            capacity = capacity ? capacity * 2 : INIT_CAPACITY;
+            uint32_t *offsets =
+                realloc(doc->offsets, sizeof(uint32_t) * capacity);
+            if (offsets == NULL) {
+                return json_lazy_fail(doc, JSON_ERROR_MEMORY, base, error);
+            }
+            doc->offsets = offsets;
+        }
+
+        while (tokens != 0) {
+            doc->offsets[doc->count++] = base + __builtin_ctzll(tokens);
+            tokens &= tokens - 1;
+        }
+    }
+
+    if (s.in_string) {
+        return json_lazy_fail(doc, JSON_ERROR_STRING, doc->len, error);
+    }
+    return 0;
+}
+
+static bool json_is_scalar_char(char c) {
+    return !is_whitespace(c) && c != '"' && c != '{' && c != '}' &&
+           c != '[' && c != ']' && c != ',' && c != ':';
+}
+
+// Checks the scalar at offset, strings are only checked when read and
+// numbers when converted
+static int json_lazy_check_scalar(const JSONLazyDocument *doc,
+                                  size_t offset, JSONError *error) {
+    const char *p = doc->buf + offset;
+    const char *end = doc->buf + doc->len;
+    if (*p == '"' || *p == '-' || is_digit(*p)) {
+        return 0;
+    }
+
+    // The index runs a literal up to the next delimiter
+    size_t length = json_literal_length(p, end);
+    if (length != 0 && (p + length == end || !json_is_scalar_char(p[length]))) {
+        return 0;
+    }
+    return json_lazy_fail(doc, JSON_ERROR_LITERAL, offset, error);
+}
+
+// Checks the order of the tokens and pairs up brackets
+static int json_lazy_validate(JSONLazyDocument *doc, JSONError *error) {
+    uint32_t stack[JSON_MAX_DEPTH];
+    JSONGrammar g;
+    json_grammar_init(&g, JSON_MAX_DEPTH);
+
+    for (uint32_t i = 0; i < doc->count; i++) {
+        size_t offset = doc->offsets[i];
+        switch (json_grammar_step(&g, doc->buf[offset])) {
+            case JSON_GRAMMAR_OPEN:
+                stack[g.depth - 1] = i;
+                break;
+            case JSON_GRAMMAR_CLOSE:
+                doc->match[stack[g.depth]] = i;
+                break;
+            case JSON_GRAMMAR_VALUE:
+                if (json_lazy_check_scalar(doc, offset, error)) return 1;
+                break;
+            case JSON_GRAMMAR_PUNCT:
+            case JSON_GRAMMAR_KEY:
+                break;
+            case JSON_GRAMMAR_DEPTH:
+                return json_lazy_fail(doc, JSON_ERROR_DEPTH, offset, error);
+            case JSON_GRAMMAR_UNEXPECTED:
+                return json_lazy_error(doc, offset, json_grammar_expected(&g),
+                                       error);
+        }
+    }
+
+    if (!json_grammar_done(&g)) {
+        return json_lazy_error(doc, doc->len, json_grammar_expected(&g),
+                               error);
+    }
+    return 0;
+}
+
+int json_lazy_parse(JSONLazyDocument *doc, const char *buf, size_t len,
+                    JSONError *error) {
+    *doc = (JSONLazyDocument){.buf = buf, .len = len};
+    *error = (JSONError){0};
+    if (buf == NULL) {
+        json_error_set(error, JSON_ERROR_ARGUMENT, NULL, 0);
+        return 1;
+    }
+    if (len > UINT32_MAX) {
+        // Offsets are 32-bit
+        json_error_set(error, JSON_ERROR_SIZE, NULL, 0);
+        return 1;
+    }
+
+    if (json_lazy_index(doc, error)) {
+        json_lazy_free(doc);
+        return 1;
+    }
+
+    doc->match = malloc(sizeof(uint32_t) * (doc->count ? doc->count : 1));
+    if (doc->match == NULL) {
+        json_lazy_fail(doc, JSON_ERROR_MEMORY, 0, error);
+        json_lazy_free(doc);
+        return 1;
+    }
+    if (json_lazy_validate(doc, error)) {
+        json_lazy_free(doc);
+        return 1;
+    }
+    return 0;
+}
+
+void json_lazy_free(JSONLazyDocument *doc) {
+    free(doc->offsets);
+    free(doc->match);
+    *doc = (JSONLazyDocument){0};
+}
+
+// ------
+// Values
+// ------
+
+static char json_lazy_char(const JSONLazyDocument *doc, uint32_t token) {
+    return doc->buf[doc->offsets[token]];
+}
+
+// The token after the value starting at token
+static uint32_t json_lazy_skip(const JSONLazyDocument *doc, uint32_t token) {
+    char c = json_lazy_char(doc, token);
+    if (c == '{' || c == '[') {
+        return doc->match[token] + 1;
+    }
+    return token + 1;
+}
+
+JSONLazyValue json_lazy_root(const JSONLazyDocument *doc) {
+    return (JSONLazyValue){.doc = doc, .token = 0};
+}
+
+JSONLazyType json_lazy_type(JSONLazyValue value) {
+    switch (json_lazy_char(value.doc, value.token)) {
+        case '{':
+            return JSON_LAZY_OBJECT;
+        case '[':
+            return JSON_LAZY_ARRAY;
+        case '"':
+            return JSON_LAZY_STRING;
+        case 't':
+        case 'f':
+            return JSON_LAZY_BOOLEAN;
+        case 'n':
+            return JSON_LAZY_NULL;
+        default:
+            return JSON_LAZY_NUMBER;
+    }
+}
+
+JSONString json_lazy_raw(JSONLazyValue value) {
+    const JSONLazyDocument *doc = value.doc;
+    const char *begin = doc->buf + doc->offsets[value.token];
+    const char *end;
+
+    char c = *begin;
+    if (c == '{' || c == '[') {
+        end = doc->buf + doc->offsets[doc->match[value.token]] + 1;
+    } else {
+        // Scalars run up to the next token, less any whitespace
+        uint32_t next = value.token + 1;
+        end = doc->buf + (next < doc->count ? doc->offsets[next] : doc->len);
+        while (end > begin && is_whitespace(end[-1])) --end;
+    }
+
+    return (JSONString){.data = begin, .length = end - begin};
+}
+
+JSONElement json_lazy_element(Arena *a, JSONLazyValue value,
+                              JSONError *error) {
+    JSONString raw = json_lazy_raw(value);
+    return json_parse_buffer(a, raw.data, raw.length, error);
+}
+
+bool json_lazy_get_object(JSONLazyValue value, JSONLazyObject *out) {
+    if (json_lazy_char(value.doc, value.token) != '{') {
+        return false;
+    }
+    *out = (JSONLazyObject){.doc = value.doc, .token = value.token};
+    return true;
+}
+
+bool json_lazy_get_array(JSONLazyValue value, JSONLazyArray *out) {
+    if (json_lazy_char(value.doc, value.token) != '[') {
+        return false;
+    }
+    *out = (JSONLazyArray){.doc = value.doc, .token = value.token};
+    return true;
+}
+
+bool json_lazy_get_string(Arena *a, JSONLazyValue value, JSONString *out) {
+    if (json_lazy_char(value.doc, value.token) != '"') {
+        return false;
+    }
+
+    // Decoded exactly as the tokenizer does it
+    JSONString raw = json_lazy_raw(value);
+    JSONTokenizer t;
+    json_tokenizer_init(&t, raw.data, raw.length);
+    t.borrow = true;
+    if (json_tokenize_string(a, &t)) {
+        return false;
+    }
+
+    *out = t.current_token.value.string;
+    return true;
+}
+
+static bool json_lazy_number(JSONLazyValue value, JSONNumber *n) {
+    char c = json_lazy_char(value.doc, value.token);
+    if (c != '-' && !is_digit(c)) {
+        return false;
+    }
+
+    JSONString raw = json_lazy_raw(value);
+    size_t length;
+    return json_number_parse(raw.data, raw.data + raw.length, n, &length) ==
+               JSON_NUMBER_OK &&
+           length == raw.length;
+}
+
+bool json_lazy_get_int(JSONLazyValue value, long long *out) {
+    JSONNumber n;
+    if (!json_lazy_number(value, &n) || n.is_float || n.is_unsigned) {
+        return false;
+    }
+    *out = n.value.number_int;
+    return true;
+}
+
+bool json_lazy_get_float(JSONLazyValue value, double *out) {
+    JSONNumber n;
+    if (!json_lazy_number(value, &n)) {
+        return false;
+    }
+    if (n.is_float) {
+        *out = n.value.number_float;
+    } else if (n.is_unsigned) {
+        *out = n.value.number_uint;
+    } else {
+        *out = n.value.number_int;
+    }
+    return true;
+}
+
+bool json_lazy_get_bool(JSONLazyValue value, bool *out) {
+    char c = json_lazy_char(value.doc, value.token);
+    if (c != 't' && c != 'f') {
+        return false;
+    }
+    *out = c == 't';
+    return true;
+}
+
+bool json_lazy_is_null(JSONLazyValue value) {
+    return json_lazy_char(value.doc, value.token) == 'n';
+}
+
+// -------
+// Objects
+// -------
+
+// Compares the raw (still escaped) string between two quotes with key,
+// decoding escapes the way json_tokenize_string does
+static bool json_lazy_key_equals(const char *p, const char *end,
+                                 const char *key, size_t length) {
+    // Escapes never make a string longer
+    if ((size_t)(end - p) < length) {
+        return false;
+    }
+    if (memchr(p, '\\', end - p) == NULL) {
+        return (size_t)(end - p) == length && memcmp(p, key, length) == 0;
+    }
+
+    size_t j = 0;
+    while (p < end) {
+        char decoded[4];
+        size_t n = 1;
+        if (*p == '\\') {
+            size_t used;
+            n = json_decode_escape(p + 1, end, decoded, &used);
+            if (n == 0) {
+                return false;
+            }
+            p += 1 + used;
+        } else {
+            decoded[0] = *p++;
+        }
+
+        if (length - j < n || memcmp(key + j, decoded, n) != 0) {
+            return false;
+        }
+        j += n;
+    }
+    return j == length;
+}
+
+JSONLazyIterator json_lazy_object_iter(JSONLazyObject object) {
+    return (JSONLazyIterator){.doc = object.doc,
+                              .token = object.token + 1,
+                              .end = object.doc->match[object.token]};
+}
+
+bool json_lazy_object_next(JSONLazyIterator *it, JSONLazyValue *key,
+                           JSONLazyValue *value) {
+    if (it->token == it->end) {
+        return false;
+    }
+
+    // "key" : value ,
+    *key = (JSONLazyValue){.doc = it->doc, .token = it->token};
+    *value = (JSONLazyValue){.doc = it->doc, .token = it->token + 2};
+
+    it->token = json_lazy_skip(it->doc, it->token + 2);
+    if (it->token != it->end) {
+        ++it->token;
+    }
+    return true;
+}
+
+bool json_lazy_object_get(JSONLazyObject object, const char *key,
+                          JSONLazyValue *out) {
+    return json_lazy_object_get_n(object, key, strlen(key), out);
+}
+
+bool json_lazy_object_get_n(JSONLazyObject object, const char *key,
+                            size_t length, JSONLazyValue *out) {
+    JSONLazyIterator it = json_lazy_object_iter(object);
+    JSONLazyValue k, v;
+    while (json_lazy_object_next(&it, &k, &v)) {
+        JSONString raw = json_lazy_raw(k);
+        if (json_lazy_key_equals(raw.data + 1, raw.data + raw.length - 1, key,
+                                 length)) {
+            *out = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t json_lazy_object_count(JSONLazyObject object) {
+    JSONLazyIterator it = json_lazy_object_iter(object);
+    JSONLazyValue k, v;
+    size_t count = 0;
+    while (json_lazy_object_next(&it, &k, &v)) ++count;
+    return count;
+}
+
+// ------
+// Arrays
+// ------
+
+JSONLazyIterator json_lazy_array_iter(JSONLazyArray array) {
+    return (JSONLazyIterator){.doc = array.doc,
+                              .token = array.token + 1,
+                              .end = array.doc->match[array.token]};
+}
+
+bool json_lazy_array_next(JSONLazyIterator *it, JSONLazyValue *value) {
+    if (it->token == it->end) {
+        return false;
+    }
+
+    *value = (JSONLazyValue){.doc = it->doc, .token = it->token};
+
+    it->token = json_lazy_skip(it->doc, it->token);
+    if (it->token != it->end) {
+        ++it->token;
+    }
+    return true;
+}
+
+bool json_lazy_array_at(JSONLazyArray array, size_t index,
+                        JSONLazyValue *out) {
+    JSONLazyIterator it = json_lazy_array_iter(array);
+    while (json_lazy_array_next(&it, out)) {
+        if (index-- == 0) return true;
+    }
+    return false;
+}
+
+size_t json_lazy_array_count(JSONLazyArray array) {
+    JSONLazyIterator it = json_lazy_array_iter(array);
+    JSONLazyValue v;
+    size_t count = 0;
+    while (json_lazy_array_next(&it, &v)) ++count;
+    return count;
+}
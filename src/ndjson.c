@@ -0,0 +1,220 @@
+#include "ndjson.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+
+typedef struct {
+    const char *begin;
+    const char *end;
+
+    // Records parsed out of the chunk, in order
+    JSONRecord *records;
+    size_t count;
+    size_t capacity;
+} JSONChunk;
+
+typedef struct {
+    const char *buf;
+    JSONChunk *chunks;
+    size_t chunk_count;
+    atomic_size_t next_chunk;
+    atomic_bool stop;
+    atomic_bool failed;
+
+    // Records are collected per chunk when fn is NULL
+    JSONRecordFn fn;
+    void *context;
+} JSONNDJSON;
+
+typedef struct {
+    JSONNDJSON *job;
+    Arena arena;
+} JSONWorker;
+
+// Cuts buf into chunks of about JSON_NDJSON_CHUNK_SIZE bytes, each ending
+// just after a newline so no record is split
+static JSONChunk *json_ndjson_split(const char *buf, size_t len,
+                                    size_t *count) {
+    JSONChunk *chunks = calloc(len / JSON_NDJSON_CHUNK_SIZE + 1,
+                               sizeof(JSONChunk));
+    if (chunks == NULL) {
+        return NULL;
+    }
+
+    const char *p = buf;
+    const char *end = buf + len;
+    size_t i = 0;
+    while (p < end) {
+        const char *cut = end;
+        if ((size_t)(end - p) > JSON_NDJSON_CHUNK_SIZE) {
+            const char *newline =
+                memchr(p + JSON_NDJSON_CHUNK_SIZE, '\n',
+                       end - p - JSON_NDJSON_CHUNK_SIZE);
+            cut = newline != NULL ? newline + 1 : end;
+        }
+
+        chunks[i++] = (JSONChunk){.begin = p, .end = cut};
+        p = cut;
+    }
+
+    *count = i;
+    return chunks;
+}
+
+static int json_ndjson_push(JSONChunk *chunk, JSONRecord record) {
+    if (chunk->count == chunk->capacity) {
+        size_t capacity = chunk->capacity ? chunk->capacity * 2 : 64;
+        JSONRecord *records =
+            realloc(chunk->records, sizeof(JSONRecord) * capacity);
+        if (records == NULL) {
+            return 1;
+        }
+        chunk->records = records;
+        chunk->capacity = capacity;
+    }
+
+    chunk->records[chunk->count++] = record;
+    return 0;
+}
+
+static void json_ndjson_record(JSONWorker *w, JSONChunk *chunk,
+                               const char *line, const char *end) {
+    JSONNDJSON *job = w->job;
+
+    JSONRecord record = {.offset = line - job->buf};
+    record.root = json_parse_buffer(&w->arena, line, end - line, &record.error);
+    if (record.error.code) {
+        atomic_store(&job->failed, true);
+    }
+
+    if (job->fn != NULL) {
+        if (job->fn(job->context, &record, &w->arena)) {
+            atomic_store(&job->stop, true);
+        }
+        arena_reset(&w->arena);
+    } else if (json_ndjson_push(chunk, record)) {
+        atomic_store(&job->failed, true);
+        atomic_store(&job->stop, true);
+    }
+}
+
+static void *json_ndjson_work(void *arg) {
+    JSONWorker *w = arg;
+    JSONNDJSON *job = w->job;
+
+    while (!atomic_load(&job->stop)) {
+        size_t i = atomic_fetch_add(&job->next_chunk, 1);
+        if (i >= job->chunk_count) break;
+
+        JSONChunk *chunk = &job->chunks[i];
+        const char *line = chunk->begin;
+        while (line < chunk->end && !atomic_load(&job->stop)) {
+            const char *newline = memchr(line, '\n', chunk->end - line);
+            const char *end = newline != NULL ? newline : chunk->end;
+
+            // Skip blank lines
+            const char *p = line;
+            while (p < end && is_whitespace(*p)) ++p;
+            if (p < end) {
+                json_ndjson_record(w, chunk, line, end);
+            }
+
+            line = end + 1;
+        }
+    }
+    return NULL;
+}
+
+// Runs the job on up to threads workers, the calling thread being one of
+// them. Returns the workers, whose arenas hold the parsed trees.
+static JSONWorker *json_ndjson_run(JSONNDJSON *job, size_t *threads) {
+    size_t count = thread_count(*threads);
+    if (count > job->chunk_count) {
+        count = job->chunk_count > 0 ? job->chunk_count : 1;
+    }
+
+    JSONWorker *workers = calloc(count, sizeof(JSONWorker));
+    if (workers == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < count; i++) {
+        workers[i].job = job;
+    }
+
+    run_threads(json_ndjson_work, workers, count, sizeof(JSONWorker));
+    *threads = count;
+    return workers;
+}
+
+JSONRecord *json_parse_ndjson(Arena *a, const char *buf, size_t len,
+                              size_t threads, size_t *count, int *error) {
+    *count = 0;
+    *error = 0;
+
+    JSONNDJSON job = {.buf = buf};
+    job.chunks = buf != NULL ? json_ndjson_split(buf, len, &job.chunk_count)
+                             : NULL;
+    JSONWorker *workers = job.chunks != NULL ? json_ndjson_run(&job, &threads)
+                                             : NULL;
+    if (workers == NULL) {
+        free(job.chunks);
+        *error = 1;
+        return NULL;
+    }
+
+    size_t total = 0;
+    for (size_t i = 0; i < job.chunk_count; i++) {
+        total += job.chunks[i].count;
+    }
+
+    JSONRecord *records = arena_alloc(a, sizeof(JSONRecord) * total);
+    if (records != NULL) {
+        size_t n = 0;
+        for (size_t i = 0; i < job.chunk_count; i++) {
+            if (job.chunks[i].count == 0) continue;
+            memcpy(records + n, job.chunks[i].records,
+                   sizeof(JSONRecord) * job.chunks[i].count);
+            n += job.chunks[i].count;
+        }
+        *count = total;
+    }
+
+    for (size_t i = 0; i < job.chunk_count; i++) {
+        free(job.chunks[i].records);
+    }
+    for (size_t i = 0; i < threads; i++) {
+        arena_merge(a, &workers[i].arena);
+    }
+    free(job.chunks);
+    free(workers);
+
+    *error = records == NULL || atomic_load(&job.failed);
+    return records;
+}
+
+int json_parse_ndjson_each(const char *buf, size_t len, size_t threads,
+                           JSONRecordFn fn, void *context) {
+    if (buf == NULL || fn == NULL) {
+        return 1;
+    }
+
+    JSONNDJSON job = {.buf = buf, .fn = fn, .context = context};
+    job.chunks = json_ndjson_split(buf, len, &job.chunk_count);
+    JSONWorker *workers =
+        job.chunks != NULL ? json_ndjson_run(&job, &threads) : NULL;
+    if (workers == NULL) {
+        free(job.chunks);
+        return 1;
+    }
+
+    for (size_t i = 0; i < threads; i++) {
+        arena_free(&workers[i].arena);
+    }
+    free(job.chunks);
+    free(workers);
+
+    return atomic_load(&job.failed) || atomic_load(&job.stop);
+}
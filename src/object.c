@@ -0,0 +1,242 @@
+#include "object.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "intern.h"
+#include "number.h"
+#include "utils.h"
+
+static bool json_key_equals(JSONString key, const char *other, size_t length) {
+    return key.length == length && memcmp(key.data, other, length) == 0;
+}
+
+static JSONObjectIndex *json_object_index(Arena *a, JSONObject *object) {
+    // Keep the load factor at or below one half
+    size_t capacity = JSON_OBJECT_INDEX_THRESHOLD;
+    while (capacity < object->count * 2) {
+        capacity *= 2;
+    }
+
+    JSONObjectIndex *index = arena_alloc(
+        a, sizeof(JSONObjectIndex) + capacity * sizeof(index->slots[0]));
+    if (index == NULL) {
+        return NULL;
+    }
+
+    index->capacity = capacity;
+    memset(index->slots, 0, capacity * sizeof(index->slots[0]));
+
+    for_each_pair(object, pair) {
+        size_t hash = object->intern != NULL
+                          ? json_intern_hash(pair->key)
+                          : hash_bytes(pair->key.data, pair->key.length);
+        size_t slot = hash & (capacity - 1);
+
+        // Duplicate keys keep their first occurrence, like a linear scan
+        while (index->slots[slot].pair != NULL &&
+               !(index->slots[slot].hash == hash &&
+                 json_key_equals(index->slots[slot].pair->key,
+                                 pair->key.data, pair->key.length))) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+
+        if (index->slots[slot].pair == NULL) {
+            index->slots[slot].hash = hash;
+            index->slots[slot].pair = pair;
+        }
+    }
+
+    return index;
+}
+
+JSONElement *json_object_get_n(Arena *a, JSONObject *object, const char *key,
+                               size_t length) {
+    if (object == NULL || key == NULL) {
+        return NULL;
+    }
+
+    if (object->index == NULL && object->count >= JSON_OBJECT_INDEX_THRESHOLD) {
+        object->index = json_object_index(a, object);
+    }
+
+    if (object->index == NULL) {
+        // Small object, or the index couldn't be allocated
+        for_each_pair(object, pair) {
+            if (json_key_equals(pair->key, key, length)) {
+                return &pair->value;
+            }
+        }
+        return NULL;
+    }
+
+    JSONObjectIndex *index = object->index;
+    size_t hash = hash_bytes(key, length);
+    size_t slot = hash & (index->capacity - 1);
+
+    while (index->slots[slot].pair != NULL) {
+        if (index->slots[slot].hash == hash &&
+            json_key_equals(index->slots[slot].pair->key, key, length)) {
+            return &index->slots[slot].pair->value;
+        }
+        slot = (slot + 1) & (index->capacity - 1);
+    }
+    return NULL;
+}
+
+JSONElement *json_object_get_interned(Arena *a, JSONObject *object,
+                                      JSONString key) {
+    if (object == NULL || object->intern == NULL) {
+        return json_object_get_n(a, object, key.data, key.length);
+    }
+
+    // Equal keys are the same pooled string
+    if (object->index == NULL && object->count >= JSON_OBJECT_INDEX_THRESHOLD) {
+        object->index = json_object_index(a, object);
+    }
+
+    if (object->index == NULL) {
+        for_each_pair(object, pair) {
+            if (pair->key.data == key.data) {
+                return &pair->value;
+            }
+        }
+        return NULL;
+    }
+
+    JSONObjectIndex *index = object->index;
+    size_t slot = json_intern_hash(key) & (index->capacity - 1);
+    while (index->slots[slot].pair != NULL) {
+        if (index->slots[slot].pair->key.data == key.data) {
+            return &index->slots[slot].pair->value;
+        }
+        slot = (slot + 1) & (index->capacity - 1);
+    }
+    return NULL;
+}
+
+JSONElement *json_object_get(Arena *a, JSONObject *object, const char *key) {
+    if (key == NULL) {
+        return NULL;
+    }
+    return json_object_get_n(a, object, key, strlen(key));
+}
+
+// Looks up key and returns its value only if it has the given value type
+static JSONValue *json_object_get_value(Arena *a, JSONObject *object,
+                                        const char *key, JSONValuetype type) {
+    JSONElement *element = json_object_get(a, object, key);
+    if (element == NULL || element->type != JSON_ELEMENT_VALUE ||
+        element->element.value.type != type) {
+        return NULL;
+    }
+    return &element->element.value;
+}
+
+bool json_object_get_string(Arena *a, JSONObject *object, const char *key,
+                            JSONString *out) {
+    JSONValue *value = json_object_get_value(a, object, key, JSON_VALUE_STRING);
+    if (value == NULL) return false;
+    *out = value->value.string;
+    return true;
+}
+
+// Looks up key and reads any number it holds, raw digits included
+static bool json_object_get_number(Arena *a, JSONObject *object,
+                                   const char *key, JSONNumber *n) {
+    JSONElement *element = json_object_get(a, object, key);
+    if (element == NULL || element->type != JSON_ELEMENT_VALUE) {
+        return false;
+    }
+
+    JSONValue *value = &element->element.value;
+    *n = (JSONNumber){0};
+    switch (value->type) {
+        case JSON_VALUE_NUMBER_INT:
+            n->value.number_int = value->value.number_int;
+            return true;
+        case JSON_VALUE_NUMBER_UINT:
+            n->is_unsigned = true;
+            n->value.number_uint = value->value.number_uint;
+            return true;
+        case JSON_VALUE_NUMBER_FLOAT:
+            n->is_float = true;
+            n->value.number_float = value->value.number_float;
+            return true;
+        case JSON_VALUE_NUMBER_RAW: {
+            JSONString digits = value->value.string;
+            size_t length;
+            return json_number_parse(digits.data, digits.data + digits.length,
+                                     n, &length) == JSON_NUMBER_OK;
+        }
+        default:
+            return false;
+    }
+}
+
+bool json_object_get_int(Arena *a, JSONObject *object, const char *key,
+                         long long *out) {
+    JSONNumber n;
+    if (!json_object_get_number(a, object, key, &n) || n.is_float ||
+        n.is_unsigned) {
+        return false;
+    }
+    *out = n.value.number_int;
+    return true;
+}
+
+bool json_object_get_uint(Arena *a, JSONObject *object, const char *key,
+                          unsigned long long *out) {
+    JSONNumber n;
+    if (!json_object_get_number(a, object, key, &n) || n.is_float ||
+        (!n.is_unsigned && n.value.number_int < 0)) {
+        return false;
+    }
+    *out = n.is_unsigned ? n.value.number_uint
+                         : (unsigned long long)n.value.number_int;
+    return true;
+}
+
+bool json_object_get_float(Arena *a, JSONObject *object, const char *key,
+                           double *out) {
+    JSONNumber n;
+    if (!json_object_get_number(a, object, key, &n)) {
+        return false;
+    }
+
+    if (n.is_float) {
+        *out = n.value.number_float;
+    } else if (n.is_unsigned) {
+        *out = n.value.number_uint;
+    } else {
+        *out = n.value.number_int;
+    }
+    return true;
+}
+
+bool json_object_get_bool(Arena *a, JSONObject *object, const char *key,
+                          bool *out) {
+    JSONValue *value =
+        json_object_get_value(a, object, key, JSON_VALUE_BOOLEAN);
+    if (value == NULL) return false;
+    *out = value->value.boolean;
+    return true;
+}
+
+JSONObject *json_object_get_object(Arena *a, JSONObject *object,
+                                   const char *key) {
+    JSONElement *element = json_object_get(a, object, key);
+    if (element == NULL || element->type != JSON_ELEMENT_OBJECT) {
+        return NULL;
+    }
+    return element->element.object;
+}
+
+JSONArray *json_object_get_array(Arena *a, JSONObject *object,
+                                 const char *key) {
+    JSONElement *element = json_object_get(a, object, key);
+    if (element == NULL || element->type != JSON_ELEMENT_ARRAY) {
+        return NULL;
+    }
+    return element->element.array;
+}
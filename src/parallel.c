@@ -0,0 +1,470 @@
+#include "parallel.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "scan.h"
+#include "utils.h"
+
+// Chunks scanned per worker, so a slow chunk doesn't hold up the pass
+#define JSON_PARALLEL_CHUNKS_PER_THREAD 8
+#define JSON_PARALLEL_MIN_CHUNK ((size_t)1 << 16)
+
+typedef enum {
+    JSON_PASS_SCAN,
+    JSON_PASS_SPLIT,
+    JSON_PASS_PARSE,
+} JSONPass;
+
+// What a chunk does to the string state and nesting depth. Both string
+// states at the start of the chunk are followed at once: the quote parity
+// says which bytes are outside strings under each of them.
+typedef struct {
+    bool parity;    // Odd number of unescaped quotes
+    bool escaped;   // Ends in the middle of an escape
+    long depth[2];  // Depth change outside strings when starting outside
+                    // (0) or inside (1) a string
+} JSONChunkScan;
+
+typedef struct {
+    const char *begin;
+    const char *end;
+    JSONChunkScan scan;
+
+    // State at begin, once the chunks before it are resolved
+    bool in_string;
+    bool escaped;
+    long depth;
+
+    const char *split;  // First comma directly inside the root, or NULL
+} JSONChunk;
+
+// Elements (or pairs) of the root between two splits
+typedef struct {
+    const char *begin;
+    const char *end;
+    JSONArray array;
+    JSONObject object;
+} JSONRange;
+
+typedef struct {
+    JSONPass pass;
+    bool object;  // The root is an object
+
+    JSONChunk *chunks;
+    size_t chunk_count;
+    JSONRange *ranges;
+    size_t range_count;
+
+    atomic_size_t next;
+    atomic_bool failed;
+} JSONParallel;
+
+typedef struct {
+    JSONParallel *job;
+    Arena arena;
+} JSONParallelWorker;
+
+// Walks the quotes, backslashes and structural characters of [p, end) a
+// block at a time
+typedef struct {
+    const char *block;
+    const char *end;
+    uint64_t bits;
+} JSONCursor;
+
+static void json_cursor_load(JSONCursor *c) {
+    JSONBlockMasks m;
+    size_t n = c->end - c->block;
+
+    if (n >= JSON_BLOCK_SIZE) {
+        json_classify_block(c->block, &m);
+    } else {
+        // Pad the last partial block with whitespace
+        char tail[JSON_BLOCK_SIZE];
+        memset(tail, ' ', sizeof(tail));
+        memcpy(tail, c->block, n);
+        json_classify_block(tail, &m);
+    }
+
+    c->bits = m.quote | m.backslash | m.structural;
+}
+
+static void json_cursor_init(JSONCursor *c, const char *p, const char *end) {
+    *c = (JSONCursor){.block = p, .end = end};
+    if (p < end) {
+        json_cursor_load(c);
+    }
+}
+
+// Returns the next byte of interest, or NULL at the end
+static const char *json_cursor_next(JSONCursor *c) {
+    while (c->bits == 0) {
+        c->block += JSON_BLOCK_SIZE;
+        if (c->block >= c->end) {
+            return NULL;
+        }
+        json_cursor_load(c);
+    }
+
+    const char *p = c->block + __builtin_ctzll(c->bits);
+    c->bits &= c->bits - 1;
+    return p;
+}
+
+// Backslashes escape the next byte whether or not they're in a string,
+// valid JSON has none outside strings
+static JSONChunkScan json_chunk_scan(const char *begin, const char *end,
+                                     bool escaped) {
+    JSONChunkScan s = {0};
+    const char *skip = escaped ? begin : NULL;
+    int parity = 0;
+
+    JSONCursor c;
+    json_cursor_init(&c, begin, end);
+    for (const char *p; (p = json_cursor_next(&c)) != NULL;) {
+        if (p == skip) continue;
+
+        switch (*p) {
+            case '\\':
+                skip = p + 1;
+                break;
+            case '"':
+                parity ^= 1;
+                break;
+            case '[':
+            case '{':
+                ++s.depth[parity];
+                break;
+            case ']':
+            case '}':
+                --s.depth[parity];
+                break;
+        }
+    }
+
+    s.parity = parity;
+    s.escaped = skip == end;
+    return s;
+}
+
+static const char *json_chunk_split(const JSONChunk *chunk) {
+    const char *skip = chunk->escaped ? chunk->begin : NULL;
+    bool in_string = chunk->in_string;
+    long depth = chunk->depth;
+
+    JSONCursor c;
+    json_cursor_init(&c, chunk->begin, chunk->end);
+    for (const char *p; (p = json_cursor_next(&c)) != NULL;) {
+        if (p == skip) continue;
+
+        if (*p == '\\') {
+            skip = p + 1;
+        } else if (*p == '"') {
+            in_string = !in_string;
+        } else if (!in_string) {
+            if (*p == '[' || *p == '{') {
+                ++depth;
+            } else if (*p == ']' || *p == '}') {
+                --depth;
+            } else if (*p == ',' && depth == 1) {
+                return p;
+            }
+        }
+    }
+    return NULL;
+}
+
+// Parses the elements or pairs of a range, separated by commas
+static int json_parse_range(Arena *a, JSONRange *r, bool object,
+                            bool allow_empty) {
+    JSONTokenizer t;
+    json_tokenizer_init(&t, r->begin, r->end - r->begin);
+    t.borrow = true;
+
+    // The range sits inside the root
+    JSONParser p = {.tokenizer = &t, .current_depth = 1};
+
+    if (json_next_token(a, &t)) return 1;
+    if (t.current_token.type == END) {
+        return !allow_empty;
+    }
+
+    while (true) {
+        JSONString key = {0};
+        if (object) {
+            if (t.current_token.type != STRING) return 1;
+            key = t.current_token.value.string;
+
+            if (json_next_token(a, &t) || t.current_token.type != COLON ||
+                json_next_token(a, &t)) {
+                return 1;
+            }
+        }
+
+        int error = 0;
+        JSONElement element = json_parse_element(a, &p, &error);
+        if (error) return 1;
+
+        if (object) {
+            JSONPair *pair = arena_alloc(a, sizeof(JSONPair));
+            if (pair == NULL) return 1;
+            *pair = (JSONPair){.key = key, .value = element, .next = NULL};
+
+            if (r->object.head == NULL) {
+                r->object.head = pair;
+            } else {
+                r->object.tail->next = pair;
+            }
+            r->object.tail = pair;
+            ++r->object.count;
+        } else {
+            JSONArrayElement *array_element =
+                arena_alloc(a, sizeof(JSONArrayElement));
+            if (array_element == NULL) return 1;
+            *array_element =
+                (JSONArrayElement){.element = element, .next = NULL};
+
+            if (r->array.head == NULL) {
+                r->array.head = array_element;
+            } else {
+                r->array.tail->next = array_element;
+            }
+            r->array.tail = array_element;
+        }
+
+        if (t.current_token.type == END) return 0;
+        if (t.current_token.type != COMMA || json_next_token(a, &t)) {
+            return 1;
+        }
+    }
+}
+
+static void *json_parallel_work(void *arg) {
+    JSONParallelWorker *w = arg;
+    JSONParallel *job = w->job;
+    size_t count =
+        job->pass == JSON_PASS_PARSE ? job->range_count : job->chunk_count;
+
+    while (!atomic_load(&job->failed)) {
+        size_t i = atomic_fetch_add(&job->next, 1);
+        if (i >= count) break;
+
+        switch (job->pass) {
+            case JSON_PASS_SCAN:
+                job->chunks[i].scan = json_chunk_scan(
+                    job->chunks[i].begin, job->chunks[i].end, false);
+                break;
+            case JSON_PASS_SPLIT:
+                job->chunks[i].split = json_chunk_split(&job->chunks[i]);
+                break;
+            case JSON_PASS_PARSE:
+                if (json_parse_range(&w->arena, &job->ranges[i], job->object,
+                                     job->range_count == 1)) {
+                    atomic_store(&job->failed, true);
+                }
+                break;
+        }
+    }
+    return NULL;
+}
+
+static void json_parallel_run(JSONParallel *job, JSONPass pass,
+                              JSONParallelWorker *workers, size_t threads) {
+    job->pass = pass;
+    atomic_store(&job->next, 0);
+    run_threads(json_parallel_work, workers, threads,
+                sizeof(JSONParallelWorker));
+}
+
+// Carries the string state and depth from each chunk to the next. Returns
+// non-zero unless the body ends outside any string, directly inside the
+// root.
+static int json_parallel_resolve(JSONParallel *job) {
+    bool in_string = false;
+    bool escaped = false;
+    long depth = 0;
+
+    for (size_t i = 0; i < job->chunk_count; i++) {
+        JSONChunk *chunk = &job->chunks[i];
+        chunk->in_string = in_string;
+        chunk->escaped = escaped;
+        chunk->depth = depth;
+
+        // Only a chunk that starts mid-escape needs scanning again
+        JSONChunkScan s = escaped
+                              ? json_chunk_scan(chunk->begin, chunk->end, true)
+                              : chunk->scan;
+        depth += s.depth[in_string];
+        in_string ^= s.parity;
+        escaped = s.escaped;
+    }
+
+    return in_string || escaped || depth != 1;
+}
+
+// Cuts the root's body at the splits found in the chunks
+static JSONRange *json_parallel_ranges(JSONParallel *job, const char *begin,
+                                       const char *end, size_t *count) {
+    JSONRange *ranges = calloc(job->chunk_count + 1, sizeof(JSONRange));
+    if (ranges == NULL) {
+        return NULL;
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < job->chunk_count; i++) {
+        const char *split = job->chunks[i].split;
+        if (split == NULL) continue;
+
+        ranges[n++] = (JSONRange){.begin = begin, .end = split};
+        begin = split + 1;
+    }
+    ranges[n++] = (JSONRange){.begin = begin, .end = end};
+
+    *count = n;
+    return ranges;
+}
+
+static JSONElement json_parallel_stitch(Arena *a, JSONParallel *job,
+                                        int *error) {
+    JSONElement root = {0};
+
+    if (job->object) {
+        JSONObject *object = arena_alloc(a, sizeof(JSONObject));
+        if (object == NULL) {
+            *error = 1;
+            return root;
+        }
+        *object = (JSONObject){0};
+
+        for (size_t i = 0; i < job->range_count; i++) {
+            JSONObject *range = &job->ranges[i].object;
+            if (range->head == NULL) continue;
+
+            if (object->head == NULL) {
+                object->head = range->head;
+            } else {
+                object->tail->next = range->head;
+            }
+            object->tail = range->tail;
+            object->count += range->count;
+        }
+
+        root = (JSONElement){.type = JSON_ELEMENT_OBJECT,
+                             .element.object = object};
+    } else {
+        JSONArray *array = arena_alloc(a, sizeof(JSONArray));
+        if (array == NULL) {
+            *error = 1;
+            return root;
+        }
+        *array = (JSONArray){.head = NULL, .tail = NULL};
+
+        for (size_t i = 0; i < job->range_count; i++) {
+            JSONArray *range = &job->ranges[i].array;
+            if (range->head == NULL) continue;
+
+            if (array->head == NULL) {
+                array->head = range->head;
+            } else {
+                array->tail->next = range->head;
+            }
+            array->tail = range->tail;
+        }
+
+        root = (JSONElement){.type = JSON_ELEMENT_ARRAY,
+                             .element.array = array};
+    }
+
+    return root;
+}
+
+JSONElement json_parse_parallel(Arena *a, const char *buf, size_t len,
+                                size_t threads, JSONError *error) {
+    threads = thread_count(threads);
+    if (buf == NULL || threads == 1 || len < JSON_PARALLEL_MIN_SIZE) {
+        return json_parse_buffer(a, buf, len, error);
+    }
+
+    // Only a root container can be split
+    const char *open = buf;
+    const char *close = buf + len;
+    while (open < close && is_whitespace(*open)) ++open;
+    while (close > open && is_whitespace(close[-1])) --close;
+    if (close - open < 2 || !((*open == '[' && close[-1] == ']') ||
+                              (*open == '{' && close[-1] == '}'))) {
+        return json_parse_buffer(a, buf, len, error);
+    }
+    --close;
+
+    *error = (JSONError){0};
+
+    size_t chunk_count = threads * JSON_PARALLEL_CHUNKS_PER_THREAD;
+    size_t size = (close - open + chunk_count - 1) / chunk_count;
+    if (size < JSON_PARALLEL_MIN_CHUNK) {
+        size = JSON_PARALLEL_MIN_CHUNK;
+    }
+    chunk_count = (close - open + size - 1) / size;
+    if (threads > chunk_count) {
+        threads = chunk_count;
+    }
+
+    JSONParallel job = {.object = *open == '{', .chunk_count = chunk_count};
+    job.chunks = calloc(chunk_count, sizeof(JSONChunk));
+    JSONParallelWorker *workers = calloc(threads, sizeof(JSONParallelWorker));
+    if (job.chunks == NULL || workers == NULL) {
+        free(job.chunks);
+        free(workers);
+        return json_parse_buffer(a, buf, len, error);
+    }
+
+    for (size_t i = 0; i < chunk_count; i++) {
+        const char *begin = open + i * size;
+        job.chunks[i].begin = begin;
+        job.chunks[i].end =
+            (size_t)(close - begin) > size ? begin + size : close;
+    }
+    for (size_t i = 0; i < threads; i++) {
+        workers[i].job = &job;
+    }
+
+    json_parallel_run(&job, JSON_PASS_SCAN, workers, threads);
+    bool failed = json_parallel_resolve(&job);
+
+    if (!failed) {
+        json_parallel_run(&job, JSON_PASS_SPLIT, workers, threads);
+        job.ranges =
+            json_parallel_ranges(&job, open + 1, close, &job.range_count);
+        failed = job.ranges == NULL;
+    }
+
+    if (!failed) {
+        json_parallel_run(&job, JSON_PASS_PARSE, workers, threads);
+        failed = atomic_load(&job.failed);
+    }
+
+    JSONElement root = {0};
+    if (!failed) {
+        int stitch_error = 0;
+        root = json_parallel_stitch(a, &job, &stitch_error);
+        failed = stitch_error;
+        for (size_t i = 0; i < threads; i++) {
+            arena_merge(a, &workers[i].arena);
+        }
+    }
+
+    for (size_t i = 0; i < threads; i++) {
+        arena_free(&workers[i].arena);
+    }
+    free(job.ranges);
+    free(job.chunks);
+    free(workers);
+
+    if (failed) {
+        // Let the serial parser find and report the error
+        return json_parse_buffer(a, buf, len, error);
+    }
+    return root;
+}
@@ -1,285 +1,586 @@
 #include "../include/parser.h"
 
-#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/resource.h>
-#include <sys/syslimits.h>
+
+#ifdef JSON_STATS
+#include <pthread.h>
+#endif
 
 #include "../include/utils.h"
 #include "arena.h"
+#include "builder.h"
+#include "intern.h"
+#include "sax.h"
+#include "stats.h"
 #include "tokenizer.h"
 
-static void json_error_token(JSONParser *p, size_t line, size_t col,
-                             const char *expected, const char *got) {
-    const char *source = p->file_name ? p->file_name : "<string>";
+static void json_error(JSONParser *p, JSONErrorCode code, JSONToken tok) {
+    const char *content =
+        p->tokenizer != NULL ? p->tokenizer->content : p->content;
+    json_error_set(&p->error, code, content, tok.offset);
+}
 
-    fprintf(stderr, "%s:%zu:%zu: Expected %s, got %s\n", source, line, col,
-            expected, got);
+static void json_error_token(JSONParser *p, JSONToken tok,
+                             const char *expected) {
+    if (p->error.code != JSON_ERROR_NONE) {
+        return;
+    }
+    json_error(p, JSON_ERROR_SYNTAX, tok);
+    p->error.expected = expected;
+    p->error.got = token_names[tok.type];
 }
 
-static void json_error(JSONParser *p, const char *message) {
-    const char *source = p->file_name ? p->file_name : "<string>";
+// Returns the lookahead token without consuming it
+static JSONToken json_peek(JSONParser *p) {
+    if (p->tokenizer != NULL) {
+        return p->tokenizer->current_token;
+    }
+    return p->tokens[p->current_token];
+}
+
+// Consumes the lookahead token. When streaming, the next token is lexed on
+// demand so no token array is ever materialized.
+static JSONToken json_advance(Arena *a, JSONParser *p, int *error) {
+    JSONToken tok = json_peek(p);
+    if (tok.type == END) {
+        return tok;
+    }
+
+    if (p->tokenizer == NULL) {
+        ++p->current_token;
+    } else if (json_next_token(a, p->tokenizer)) {
+        // Park the tokenizer on END so callers stop pulling tokens, the
+        // token's error comes before whatever they run into next
+        if (p->error.code == JSON_ERROR_NONE) {
+            p->error = p->tokenizer->error;
+        }
+        p->tokenizer->current_token =
+            (JSONToken){.type = END, .offset = p->tokenizer->error.offset};
+        *error = 1;
+    }
+    return tok;
+}
 
-    fprintf(stderr, "%s: %s\n", source, message);
+// Checks that nothing follows the root element
+static int json_expect_end(JSONParser *p) {
+    JSONToken tok = json_peek(p);
+    if (tok.type != END) {
+        json_error_token(p, tok, token_names[END]);
+        return 1;
+    }
+    return 0;
 }
 
-JSONElement json_parse_file(Arena *a, const char *file_name, int *error) {
-    char *path = realpath(file_name, NULL);
-    if (path == NULL) {
-        printf("Failed to read file %s\n", file_name);
+static JSONElement json_parse_root(Arena *a, JSONParser *p, int *error) {
+    p->root = json_parse_element(a, p, error);
+    if (*error == 0 && json_expect_end(p)) {
         *error = 1;
+    }
+    return p->root;
+}
+
+#ifdef JSON_STATS
+// The only state shared between parses. Each parse reads the hook and its
+// context together under the lock, once, so a hook set from another
+// thread is never called with the wrong context.
+static pthread_mutex_t json_stats_hook_lock = PTHREAD_MUTEX_INITIALIZER;
+static JSONStatsHook json_stats_hook_fn;
+static void *json_stats_hook_context;
+
+void json_stats_hook(JSONStatsHook hook, void *context) {
+    pthread_mutex_lock(&json_stats_hook_lock);
+    json_stats_hook_fn = hook;
+    json_stats_hook_context = context;
+    pthread_mutex_unlock(&json_stats_hook_lock);
+}
+
+static JSONStatsHook json_stats_hooked(void **context) {
+    pthread_mutex_lock(&json_stats_hook_lock);
+    JSONStatsHook hook = json_stats_hook_fn;
+    *context = json_stats_hook_context;
+    pthread_mutex_unlock(&json_stats_hook_lock);
+    return hook;
+}
+
+// Starts counting into stats, or into a local when only the hook wants
+// them
+static void json_stats_begin(Arena *a, JSONTokenizer *t, JSONStats *stats) {
+    if (stats == NULL) {
+        return;
+    }
+    *stats = (JSONStats){.bytes = t->end - t->content,
+                         .regions = a->allocations,
+                         .nanoseconds[JSON_STATS_ARENA] = a->grow_nanoseconds,
+                         .total_nanoseconds = json_stats_now()};
+    t->stats = stats;
+}
+
+static void json_stats_end(Arena *a, JSONTokenizer *t, const char *file_name,
+                           const JSONError *error, JSONStatsHook hook,
+                           void *context) {
+    JSONStats *stats = t->stats;
+    if (stats == NULL) {
+        return;
+    }
+    stats->total_nanoseconds = json_stats_now() - stats->total_nanoseconds;
+    stats->nanoseconds[JSON_STATS_BUILD] =
+        stats->total_nanoseconds - stats->nanoseconds[JSON_STATS_TOKENIZE];
+    stats->nanoseconds[JSON_STATS_ARENA] =
+        a->grow_nanoseconds - stats->nanoseconds[JSON_STATS_ARENA];
+    stats->regions = a->allocations - stats->regions;
+    t->stats = NULL;
+
+    if (hook != NULL) {
+        hook(context, file_name, stats, error);
+    }
+}
+#endif
+
+// Parses the input of t, set up by the caller. stats may be NULL.
+static JSONElement json_parse_stream(Arena *a, JSONTokenizer *t,
+                                     const char *file_name, JSONStats *stats,
+                                     JSONError *error) {
+    *error = (JSONError){0};
+
+#ifdef JSON_STATS
+    void *context;
+    JSONStatsHook hook = json_stats_hooked(&context);
+    JSONStats hooked;
+    json_stats_begin(a, t, stats || !hook ? stats : &hooked);
+#else
+    (void)stats;
+#endif
+
+    // A rejected document leaves nothing behind in a
+    ArenaMark mark = arena_mark(a);
+
+    JSONParser p = {.tokenizer = t};
+    JSONElement root = {0};
+    int failed = 0;
+    if (json_next_token(a, t)) {
+        p.error = t->error;
+        failed = 1;
+    } else {
+        root = json_parse_root(a, &p, &failed);
+    }
+    if (failed && p.error.code == JSON_ERROR_NONE) {
+        // Only the builder fails without saying why
+        json_error_set(&p.error, JSON_ERROR_MEMORY, t->content,
+                       t->current_token.offset);
+    }
+    *error = p.error;
+
+#ifdef JSON_STATS
+    json_stats_end(a, t, file_name, error, hook, context);
+#else
+    (void)file_name;
+#endif
+
+    if (failed) {
+        arena_rewind(a, mark);
         return (JSONElement){0};
     }
+    return root;
+}
+
+static JSONElement json_parse_file_with(Arena *a, const char *file_name,
+                                        JSONStats *stats, JSONError *error) {
+    // Regular files are parsed straight out of a read-only mapping, strings
+    // are copied into the arena so nothing refers to it once it's unmapped
+    FileContent content;
+    if (map_file_content(file_name, &content)) {
+        *error = (JSONError){0};
+        json_error_set(error, JSON_ERROR_IO, NULL, 0);
+        return (JSONElement){0};
+    }
+
+    JSONTokenizer t;
+    json_tokenizer_init(&t, content.data, content.size);
+    JSONElement root = json_parse_stream(a, &t, file_name, stats, error);
 
-    char *content = read_file_content(path);
+    unmap_file_content(&content);
+    return root;
+}
+
+JSONElement json_parse_file(Arena *a, const char *file_name,
+                            JSONError *error) {
+    return json_parse_file_with(a, file_name, NULL, error);
+}
+
+JSONElement json_parse(Arena *a, char *content, JSONError *error) {
     if (content == NULL) {
-        printf("Failed to read file %s\n", file_name);
-        *error = 1;
-        free(path);
+        *error = (JSONError){0};
+        json_error_set(error, JSON_ERROR_ARGUMENT, NULL, 0);
         return (JSONElement){0};
     }
 
-    JSONTokenizer *t = json_tokenize(a, content, error);
-    JSONParser *p = arena_alloc(a, sizeof(JSONParser));
+    JSONTokenizer t;
+    json_tokenizer_init(&t, content, strlen(content));
+    return json_parse_stream(a, &t, NULL, NULL, error);
+}
 
-    *p = (JSONParser){.tokens = t->tokens,
-                      .token_count = t->token_count,
-                      .current_token = 0,
-                      .file_name = path};
+// Parses len bytes of buf in place, buf doesn't need to be NUL-terminated.
+// Strings without escapes are borrowed from buf rather than copied, so buf
+// must outlive the returned tree.
+JSONElement json_parse_buffer(Arena *a, const char *buf, size_t len,
+                              JSONError *error) {
+    if (buf == NULL) {
+        *error = (JSONError){0};
+        json_error_set(error, JSON_ERROR_ARGUMENT, NULL, 0);
+        return (JSONElement){0};
+    }
 
-    p->root = json_parse_element(a, p, error);
+    JSONTokenizer t;
+    json_tokenizer_init(&t, buf, len);
+    t.borrow = true;
+    return json_parse_stream(a, &t, NULL, NULL, error);
+}
 
-    free(content);
-    free(path);
-    return p->root;
+#ifdef JSON_STATS
+JSONElement json_parse_buffer_stats(Arena *a, const char *buf, size_t len,
+                                    JSONStats *stats, JSONError *error) {
+    if (buf == NULL) {
+        *error = (JSONError){0};
+        json_error_set(error, JSON_ERROR_ARGUMENT, NULL, 0);
+        return (JSONElement){0};
+    }
+
+    JSONTokenizer t;
+    json_tokenizer_init(&t, buf, len);
+    t.borrow = true;
+    return json_parse_stream(a, &t, NULL, stats, error);
+}
+
+JSONElement json_parse_file_stats(Arena *a, const char *file_name,
+                                  JSONStats *stats, JSONError *error) {
+    return json_parse_file_with(a, file_name, stats, error);
+}
+#endif
+
+JSONElement json_parse_exact(Arena *a, const char *buf, size_t len,
+                             JSONError *error) {
+    if (buf == NULL) {
+        *error = (JSONError){0};
+        json_error_set(error, JSON_ERROR_ARGUMENT, NULL, 0);
+        return (JSONElement){0};
+    }
+
+    JSONTokenizer t;
+    json_tokenizer_init(&t, buf, len);
+    t.borrow = true;
+    t.raw_numbers = true;
+    return json_parse_stream(a, &t, NULL, NULL, error);
+}
+
+JSONElement json_parse_interned(Arena *a, JSONInternPool *pool,
+                                const char *buf, size_t len,
+                                JSONError *error) {
+    if (buf == NULL || pool == NULL) {
+        *error = (JSONError){0};
+        json_error_set(error, JSON_ERROR_ARGUMENT, NULL, 0);
+        return (JSONElement){0};
+    }
+
+    JSONTokenizer t;
+    json_tokenizer_init(&t, buf, len);
+    t.intern = pool;
+    return json_parse_stream(a, &t, NULL, NULL, error);
 }
 
-JSONElement json_parse(Arena *a, char *content, int *error) {
+JSONElement json_parse_tokenized(Arena *a, char *content, JSONError *error) {
+    ArenaMark mark = arena_mark(a);
+
     JSONTokenizer *t = json_tokenize(a, content, error);
-    JSONParser *p = arena_alloc(a, sizeof(JSONParser));
-    *p = (JSONParser){
+    if (t == NULL) {
+        return (JSONElement){0};
+    }
+
+    JSONParser p = {
         .tokens = t->tokens,
         .token_count = t->token_count,
         .current_token = 0,
+        .content = content,
     };
 
-    p->root = json_parse_element(a, p, error);
-    return p->root;
-}
-
-JSONElement json_parse_element(Arena *a, JSONParser *p, int *error) {
-    JSONElement element = {0};
-    JSONToken tok = p->tokens[p->current_token];
-
-    if (p->current_depth >= JSON_MAX_DEPTH) {
-        json_error(p, "Maximum JSON element depth reached");
-        *error = 1;
-        return element;
+    int failed = 0;
+    JSONElement root = json_parse_root(a, &p, &failed);
+    if (failed) {
+        *error = p.error;
+        json_error_set(error, JSON_ERROR_MEMORY, content, 0);
+        arena_rewind(a, mark);
+        return (JSONElement){0};
     }
+    return root;
+}
 
-    ++p->current_depth;
+// Calls the callback if it's set, true if it asked to stop the parse
+#define json_emit(callbacks, event, ...) \
+    ((callbacks)->event != NULL && (callbacks)->event(__VA_ARGS__) != 0)
 
-    switch (tok.type) {
-        case LEFT_CURLY:
-            element.type = JSON_ELEMENT_OBJECT;
-            element.element.object = json_parse_object(a, p, error);
-            break;
-        case LEFT_SQUARE:
-            element.type = JSON_ELEMENT_ARRAY;
-            element.element.array = json_parse_array(a, p, error);
-            break;
-        case STRING:
-            element = json_parse_string(p, error);
-            break;
-        case NUMBER_INT:
-        case NUMBER_FLOAT:
-            element = json_parse_number(p, error);
-            break;
-        case TRUE:
-            element.type = JSON_ELEMENT_VALUE;
-            element.element.value.type = JSON_VALUE_BOOLEAN;
-            element.element.value.value.boolean = true;
-            p->current_token++;
-            break;
-        case FALSE:
-            element.type = JSON_ELEMENT_VALUE;
-            element.element.value.type = JSON_VALUE_BOOLEAN;
-            element.element.value.value.boolean = false;
-            p->current_token++;
-            break;
-        case NULL_TOKEN:
-            element.type = JSON_ELEMENT_VALUE;
-            element.element.value.type = JSON_VALUE_NULL;
-            p->current_token++;
-            break;
-        default:
-            if (p->file_name) {
-                fprintf(stderr, "%s:%zu:%zu: Expected %s, got %s\n",
-                        p->file_name, tok.line, tok.col, "json element",
-                        token_names[tok.type]);
-            } else {
-                fprintf(stderr, "%zu:%zu: Expected %s, got %s\n", tok.line,
-                        tok.col, "json element", token_names[tok.type]);
-            }
-            *error = 1;
+// Drops the string of the token just consumed by its event
+static void json_release(Arena *a, JSONParser *p) {
+    if (p->scratch) {
+        arena_rewind(a, p->scratch_mark);
     }
-
-    --p->current_depth;
-    return element;
 }
 
-JSONArray *json_parse_array(Arena *a, JSONParser *p, int *error) {
-    JSONArray *array = arena_alloc(a, sizeof(JSONArray));
-    *array = (JSONArray){.head = NULL, .tail = NULL};
+static int json_emit_element(Arena *a, JSONParser *p,
+                             const JSONCallbacks *callbacks, void *context);
+
+static int json_emit_array(Arena *a, JSONParser *p,
+                           const JSONCallbacks *callbacks, void *context) {
+    int error = 0;
 
     // Parse opening square brace
-    JSONToken opening = p->tokens[p->current_token];
-    ++p->current_token;
+    JSONToken opening = json_advance(a, p, &error);
     if (opening.type != LEFT_SQUARE) {
-        if (p->file_name) {
-            fprintf(stderr, "%s:%zu:%zu: Expected %s, got %s\n", p->file_name,
-                    opening.line, opening.col, token_names[LEFT_SQUARE],
-                    token_names[opening.type]);
-        } else {
-            fprintf(stderr, "%zu:%zu: Expected %s, got %s\n", opening.line,
-                    opening.col, token_names[LEFT_SQUARE],
-                    token_names[opening.type]);
-        }
-        *error = 1;
-        return array;
+        json_error_token(p, opening, token_names[LEFT_SQUARE]);
+        return 1;
+    }
+    if (error != 0 || json_emit(callbacks, on_array_start, context)) {
+        return 1;
     }
 
     // Try parsing closing right square
     // This is a special case for empty arrays
-    JSONToken closing = p->tokens[p->current_token];
+    JSONToken closing = json_peek(p);
     if (closing.type == RIGHT_SQUARE) {
-        ++p->current_token;
-        return array;
+        json_advance(a, p, &error);
+        return error || json_emit(callbacks, on_array_end, context);
     }
 
     while (true) {
-        JSONElement element = json_parse_element(a, p, error);
-        if (*error != 0) {
-            return array;
+        if (json_emit_element(a, p, callbacks, context)) {
+            return 1;
         }
 
-        JSONArrayElement *array_element =
-            arena_alloc(a, sizeof(JSONArrayElement));
-
-        *array_element = (JSONArrayElement){.element = element, .next = NULL};
-
-        if (array->head == NULL) {
-            array->head = array_element;
-            array->tail = array_element;
-        } else {
-            array->tail->next = array_element;
-            array->tail = array_element;
-        }
-
-        JSONToken comma = p->tokens[p->current_token];
-        ++p->current_token;
-
+        JSONToken comma = json_advance(a, p, &error);
         if (comma.type != COMMA && comma.type != RIGHT_SQUARE) {
-            fprintf(stderr, "%s:%zu:%zu: Expected %s or %s, got %s\n",
-                    p->file_name, comma.line, comma.col, token_names[COMMA],
-                    token_names[RIGHT_SQUARE], token_names[comma.type]);
-            *error = 1;
-            return array;
+            json_error_token(p, comma, "',' or ']'");
+            return 1;
+        }
+        if (error != 0) {
+            return 1;
         }
 
         if (comma.type == RIGHT_SQUARE) break;
     }
 
-    return array;
+    return json_emit(callbacks, on_array_end, context);
 }
 
-JSONObject *json_parse_object(Arena *a, JSONParser *p, int *error) {
-    JSONObject *object = arena_alloc(a, sizeof(JSONObject));
-    *object = (JSONObject){.head = NULL, .tail = NULL};
+static int json_emit_object(Arena *a, JSONParser *p,
+                            const JSONCallbacks *callbacks, void *context) {
+    int error = 0;
 
     // Parse opening left curly
-    JSONToken opening = p->tokens[p->current_token];
-    ++p->current_token;
+    JSONToken opening = json_advance(a, p, &error);
     if (opening.type != LEFT_CURLY) {
-        fprintf(stderr, "Expected %s, got %s\n", token_names[LEFT_CURLY],
-                token_names[opening.type]);
-        *error = 1;
-        return object;
+        json_error_token(p, opening, token_names[LEFT_CURLY]);
+        return 1;
+    }
+    if (error != 0 || json_emit(callbacks, on_object_start, context)) {
+        return 1;
     }
 
     // Try to parse the closing right curly
     // This is a special case for empty objects
-    JSONToken closing = p->tokens[p->current_token];
+    JSONToken closing = json_peek(p);
     if (closing.type == RIGHT_CURLY) {
-        ++p->current_token;
-        return object;
+        json_advance(a, p, &error);
+        return error || json_emit(callbacks, on_object_end, context);
     }
 
     while (true) {
         // Parse key
-        JSONToken key = p->tokens[p->current_token];
-        ++p->current_token;
+        JSONToken key = json_peek(p);
         if (key.type != STRING) {
-            fprintf(stderr, "Expected %s, got %s\n", token_names[STRING],
-                    token_names[key.type]);
-            *error = 1;
-            return object;
+            json_error_token(p, key, token_names[STRING]);
+            return 1;
+        }
+        if (json_emit(callbacks, on_key, context, key.value.string)) {
+            return 1;
+        }
+        json_release(a, p);
+        json_advance(a, p, &error);
+        if (error != 0) {
+            return 1;
         }
 
         // Parse colon
-        JSONToken colon = p->tokens[p->current_token];
-        ++p->current_token;
+        JSONToken colon = json_advance(a, p, &error);
         if (colon.type != COLON) {
-            fprintf(stderr, "Expected %s, got %s\n", token_names[COLON],
-                    token_names[colon.type]);
-            *error = 1;
-            return object;
+            json_error_token(p, colon, token_names[COLON]);
+            return 1;
         }
-
-        // Parse value
-        JSONElement value = json_parse_element(a, p, error);
-        if (*error != 0) {
-            return object;
+        if (error != 0) {
+            return 1;
         }
 
-        // Add pair to object linked list
-        JSONPair *pair = arena_alloc(a, sizeof(JSONPair));
-        *pair = (JSONPair){.key = key.value.string, .value = value};
-
-        if (object->head == NULL) {
-            object->head = pair;
-            object->tail = pair;
-        } else {
-            object->tail->next = pair;
-            object->tail = pair;
+        // Parse value
+        if (json_emit_element(a, p, callbacks, context)) {
+            return 1;
         }
-        object->tail->next = NULL;
 
         // Parse comma, or closing curly
-        JSONToken comma = p->tokens[p->current_token];
-        ++p->current_token;
+        JSONToken comma = json_advance(a, p, &error);
 
         if (comma.type == RIGHT_CURLY) break;
 
         if (comma.type != COMMA) {
-            fprintf(stderr, "Expected %s or %s, got %s\n", token_names[COMMA],
-                    token_names[RIGHT_CURLY], token_names[comma.type]);
-            *error = 1;
-            return object;
+            json_error_token(p, comma, "',' or '}'");
+            return 1;
+        }
+        if (error != 0) {
+            return 1;
         }
     }
 
+    return error || json_emit(callbacks, on_object_end, context);
+}
+
+static int json_emit_element(Arena *a, JSONParser *p,
+                             const JSONCallbacks *callbacks, void *context) {
+    JSONToken tok = json_peek(p);
+
+    if (p->current_depth >= JSON_MAX_DEPTH) {
+        json_error(p, JSON_ERROR_DEPTH, tok);
+        return 1;
+    }
+
+    ++p->current_depth;
+#ifdef JSON_STATS
+    if (p->tokenizer != NULL && p->tokenizer->stats != NULL) {
+        JSONStats *stats = p->tokenizer->stats;
+        stats->max_depth = MAX(stats->max_depth, p->current_depth);
+    }
+#endif
+
+    int error = 0;
+    switch (tok.type) {
+        case LEFT_CURLY:
+            error = json_emit_object(a, p, callbacks, context);
+            break;
+        case LEFT_SQUARE:
+            error = json_emit_array(a, p, callbacks, context);
+            break;
+        case STRING:
+            error = json_emit(callbacks, on_string, context, tok.value.string);
+            json_release(a, p);
+            break;
+        case NUMBER_INT:
+            error = json_emit(callbacks, on_int, context, tok.value.number_int);
+            break;
+        case NUMBER_UINT:
+            error =
+                json_emit(callbacks, on_uint, context, tok.value.number_uint);
+            break;
+        case NUMBER_FLOAT:
+            error =
+                json_emit(callbacks, on_float, context, tok.value.number_float);
+            break;
+        case NUMBER_RAW:
+            error = json_emit(callbacks, on_number, context, tok.value.string);
+            break;
+        case TRUE:
+        case FALSE:
+            error = json_emit(callbacks, on_bool, context, tok.type == TRUE);
+            break;
+        case NULL_TOKEN:
+            error = json_emit(callbacks, on_null, context);
+            break;
+        default:
+            json_error_token(p, tok, "json element");
+            error = 1;
+    }
+
+    // Containers consume their own closing brace
+    if (!error && tok.type != LEFT_CURLY && tok.type != LEFT_SQUARE) {
+        json_advance(a, p, &error);
+    }
+
+    --p->current_depth;
+    return error;
+}
+
+int json_parse_events(Arena *a, const char *buf, size_t len,
+                      const JSONCallbacks *callbacks, void *context,
+                      JSONError *error) {
+    *error = (JSONError){0};
+    if (buf == NULL) {
+        json_error_set(error, JSON_ERROR_ARGUMENT, NULL, 0);
+        return 1;
+    }
+
+    JSONTokenizer t;
+    json_tokenizer_init(&t, buf, len);
+    t.borrow = true;
+
+    // Only escaped strings are copied, each is dropped after its event
+    JSONParser p = {
+        .tokenizer = &t, .scratch = true, .scratch_mark = arena_mark(a)};
+
+    int failed = 0;
+    if (json_next_token(a, &t)) {
+        p.error = t.error;
+        failed = 1;
+    } else {
+        failed = json_emit_element(a, &p, callbacks, context) ||
+                 json_expect_end(&p);
+    }
+
+    arena_rewind(a, p.scratch_mark);
+    // Left zeroed when a callback stopped the parse
+    *error = p.error;
+    return failed;
+}
+
+// The tree is built by feeding the events to a JSONBuilder
+
+JSONElement json_parse_element(Arena *a, JSONParser *p, int *error) {
+    JSONBuilder b;
+    json_builder_init(&b, a);
+    b.intern = p->tokenizer != NULL ? p->tokenizer->intern : NULL;
+    if (json_emit_element(a, p, &json_builder_callbacks, &b)) {
+        *error = 1;
+    }
+
+    JSONElement element = b.root;
+    return element;
+}
+
+JSONArray *json_parse_array(Arena *a, JSONParser *p, int *error) {
+    JSONBuilder b;
+    json_builder_init(&b, a);
+    b.intern = p->tokenizer != NULL ? p->tokenizer->intern : NULL;
+    if (json_emit_array(a, p, &json_builder_callbacks, &b)) {
+        *error = 1;
+    }
+
+    JSONArray *array =
+        b.root.type == JSON_ELEMENT_ARRAY ? b.root.element.array : NULL;
+    return array;
+}
+
+JSONObject *json_parse_object(Arena *a, JSONParser *p, int *error) {
+    JSONBuilder b;
+    json_builder_init(&b, a);
+    b.intern = p->tokenizer != NULL ? p->tokenizer->intern : NULL;
+    if (json_emit_object(a, p, &json_builder_callbacks, &b)) {
+        *error = 1;
+    }
+
+    JSONObject *object =
+        b.root.type == JSON_ELEMENT_OBJECT ? b.root.element.object : NULL;
     return object;
 }
 
-JSONElement json_parse_string(JSONParser *p, int *error) {
+JSONElement json_parse_string(Arena *a, JSONParser *p, int *error) {
     JSONElement element = {0};
-    JSONToken string_token = p->tokens[p->current_token];
-    ++p->current_token;
+    JSONToken string_token = json_advance(a, p, error);
     if (string_token.type != STRING) {
-        fprintf(stderr, "Expected string, got %s\n",
-                token_names[string_token.type]);
+        json_error_token(p, string_token, token_names[STRING]);
         *error = 1;
         return element;
     }
@@ -289,174 +590,35 @@ JSONElement json_parse_string(JSONParser *p, int *error) {
     return element;
 }
 
-JSONElement json_parse_number(JSONParser *p, int *error) {
-    JSONToken number_token = p->tokens[p->current_token];
+JSONElement json_parse_number(Arena *a, JSONParser *p, int *error) {
+    JSONToken number_token = json_advance(a, p, error);
     JSONElement element = {.type = JSON_ELEMENT_VALUE};
 
-    ++p->current_token;
-
     switch (number_token.type) {
         case NUMBER_INT:
             element.element.value.type = JSON_VALUE_NUMBER_INT;
             element.element.value.value.number_int =
                 number_token.value.number_int;
             break;
+        case NUMBER_UINT:
+            element.element.value.type = JSON_VALUE_NUMBER_UINT;
+            element.element.value.value.number_uint =
+                number_token.value.number_uint;
+            break;
         case NUMBER_FLOAT:
             element.element.value.type = JSON_VALUE_NUMBER_FLOAT;
             element.element.value.value.number_float =
                 number_token.value.number_float;
             break;
+        case NUMBER_RAW:
+            element.element.value.type = JSON_VALUE_NUMBER_RAW;
+            element.element.value.value.string = number_token.value.string;
+            break;
         default:
-            fprintf(stderr, "Expected number, got %s\n",
-                    token_names[number_token.type]);
+            json_error_token(p, number_token, "number");
             *error = 1;
             return element;
     }
 
     return element;
 }
-
-char *json_stringify(Arena *a, JSONElement element) {
-    switch (element.type) {
-        case JSON_ELEMENT_OBJECT: {
-            // Calculate required buffer size
-            size_t length = 2;  // For {} characters
-            JSONPair *current = element.element.object->head;
-            bool first = true;
-
-            // Calculate length needed for the JSON string
-            while (current != NULL) {
-                if (!first) {
-                    length += 2;  // For ", " between pairs
-                }
-                // Key length + 2 for quotes + 2 for ": "
-                length += strlen(current->key) + 4;
-                // Value length
-                char *value_str = json_stringify(a, current->value);
-                length += strlen(value_str);
-
-                first = false;
-                current = current->next;
-            }
-
-            // Allocate memory from arena
-            char *buffer =
-                arena_alloc(a, length + 1);  // +1 for null terminator
-
-            // Build JSON object string
-            buffer[0] = '{';
-            buffer[1] = '\0';
-
-            current = element.element.object->head;
-            first = true;
-
-            while (current != NULL) {
-                if (!first) {
-                    strcat(buffer, ", ");
-                }
-
-                // Add key with quotes
-                char *key_buf = arena_alloc(a, strlen(current->key) + 3);
-                snprintf(key_buf, strlen(current->key) + 3, "\"%s\"",
-                         current->key);
-                strcat(buffer, key_buf);
-
-                // Add colon separator
-                strcat(buffer, ": ");
-
-                // Add value
-                char *value_str = json_stringify(a, current->value);
-                strcat(buffer, value_str);
-
-                first = false;
-                current = current->next;
-            }
-
-            strcat(buffer, "}");
-            return buffer;
-        }
-        case JSON_ELEMENT_ARRAY: {
-            // Use the linked list structure instead of array access
-            size_t length = 2;  // For [] characters
-            JSONArrayElement *current = element.element.array->head;
-            bool first = true;
-
-            // Calculate length needed for the JSON string
-            while (current != NULL) {
-                if (!first) {
-                    length += 2;  // For ", " between elements
-                }
-                // Value length
-                char *elem_str = json_stringify(a, current->element);
-                length += strlen(elem_str);
-
-                first = false;
-                current = current->next;
-            }
-
-            // Allocate memory from arena
-            char *buffer =
-                arena_alloc(a, length + 1);  // +1 for null terminator
-
-            // Build JSON array string
-            buffer[0] = '[';
-            buffer[1] = '\0';
-
-            current = element.element.array->head;
-            first = true;
-
-            while (current != NULL) {
-                if (!first) {
-                    strcat(buffer, ", ");
-                }
-
-                // Add value
-                char *elem_str = json_stringify(a, current->element);
-                strcat(buffer, elem_str);
-
-                first = false;
-                current = current->next;
-            }
-
-            strcat(buffer, "]");
-            return buffer;
-        }
-        case JSON_ELEMENT_VALUE:
-            switch (element.element.value.type) {
-                case JSON_VALUE_STRING: {
-                    size_t length = strlen(element.element.value.value.string) +
-                                    3;  // +2 for quotes, +1 for null
-                    char *buffer = arena_alloc(a, length);
-                    snprintf(buffer, length, "\"%s\"",
-                             element.element.value.value.string);
-                    return buffer;
-                }
-                case JSON_VALUE_NUMBER_INT: {
-                    char *buffer = arena_alloc(a, 32);  // Enough for int64
-                    snprintf(buffer, 32, "%lld",
-                             element.element.value.value.number_int);
-                    return buffer;
-                }
-                case JSON_VALUE_NUMBER_FLOAT: {
-                    char *buffer =
-                        arena_alloc(a, 64);  // Enough for long double
-                    snprintf(buffer, 64, "%Lf",
-                             element.element.value.value.number_float);
-                    return buffer;
-                }
-                case JSON_VALUE_BOOLEAN: {
-                    char *result = element.element.value.value.boolean
-                                       ? arena_alloc_str(a, "true")
-                                       : arena_alloc_str(a, "false");
-                    return result;
-                }
-                case JSON_VALUE_NULL: {
-                    return arena_alloc_str(a, "null");
-                }
-            }
-            break;
-        case JSON_ELEMENT_END:
-            return arena_alloc_str(a, "");
-    }
-    return NULL;
-}
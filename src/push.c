@@ -0,0 +1,376 @@
+#include "push.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "scan.h"
+
+// Keeps e, found in the buffer being lexed, as the parser's error with its
+// place moved out to the whole stream
+static int json_push_keep(JSONPushParser *p, JSONError e) {
+    if (p->error.code != JSON_ERROR_NONE) {
+        return 1;
+    }
+    if (e.line == 1) {
+        e.col += p->base - p->line_start;
+    }
+    e.line += p->line - 1;
+    e.offset += p->base;
+    p->error = e;
+    return 1;
+}
+
+static int json_push_fail(JSONPushParser *p, JSONErrorCode code,
+                          size_t offset) {
+    JSONError e = {0};
+    json_error_set(&e, code, p->tokenizer.content, offset);
+    return json_push_keep(p, e);
+}
+
+static int json_push_error(JSONPushParser *p, JSONToken tok,
+                           const char *expected) {
+    JSONError e = {0};
+    json_error_set(&e, JSON_ERROR_SYNTAX, p->tokenizer.content, tok.offset);
+    e.expected = expected;
+    e.got = token_names[tok.type];
+    return json_push_keep(p, e);
+}
+
+// Counts the lines in the len bytes at the start of the buffer just lexed
+static void json_push_lines(JSONPushParser *p, const char *buf, size_t len) {
+    const char *end = buf + len;
+    for (const char *nl = buf; (nl = memchr(nl, '\n', end - nl)) != NULL;) {
+        ++p->line;
+        p->line_start = p->base + (++nl - buf);
+    }
+}
+
+// Bytes that can continue a number or a literal such as true
+static bool json_is_word_char(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+           (c >= 'A' && c <= 'Z') || c == '+' || c == '-' || c == '.';
+}
+
+// Finds the closing quote of a string body starting at p (after the opening
+// quote) and stores the offset just past it in end. escaped says whether
+// p[0] follows an unfinished backslash. Returns false if the body runs past
+// the end.
+static bool json_push_string_end(const char *p, size_t len, char quote,
+                                 bool escaped, size_t *end) {
+    size_t i = escaped ? 1 : 0;
+    while (i < len) {
+        if (quote == '"') {
+            i = json_scan_string(p + i, p + len) - p;
+        } else {
+            while (i < len && p[i] != quote && p[i] != '\\') ++i;
+        }
+
+        if (i >= len) break;
+        if (p[i] == quote) {
+            *end = i + 1;
+            return true;
+        }
+        i += 2;  // Skip the escaped character
+    }
+
+    *end = len;
+    return false;
+}
+
+static size_t json_push_word_end(const char *p, size_t len) {
+    size_t i = 0;
+    while (i < len && json_is_word_char(p[i])) ++i;
+    return i;
+}
+
+// Returns the length of the token starting at p, or 0 if it may carry on
+// past the end of the chunk
+static size_t json_push_token_length(const char *p, size_t len) {
+    switch (*p) {
+        case '"':
+        case '\'': {
+            size_t end;
+            bool found = json_push_string_end(p + 1, len - 1, *p, false, &end);
+            return found ? end + 1 : 0;
+        }
+        default:
+            if (json_is_word_char(*p)) {
+                size_t end = json_push_word_end(p, len);
+                return end == len ? 0 : end;
+            }
+            return 1;
+    }
+}
+
+static void json_push_close(JSONPushParser *p, bool object) {
+    if (object) {
+        json_builder_callbacks.on_object_end(&p->builder);
+    } else {
+        json_builder_callbacks.on_array_end(&p->builder);
+    }
+    p->state = p->builder.depth == 0 ? JSON_PUSH_DONE : JSON_PUSH_COMMA;
+}
+
+static int json_push_value(JSONPushParser *p, JSONToken tok) {
+    const JSONCallbacks *b = &json_builder_callbacks;
+    int error = 0;
+
+    // Every element counts towards the depth, as in json_emit_element
+    if (p->builder.depth >= JSON_MAX_DEPTH) {
+        return json_push_fail(p, JSON_ERROR_DEPTH, tok.offset);
+    }
+
+    switch (tok.type) {
+        case LEFT_CURLY:
+        case LEFT_SQUARE:
+            if (tok.type == LEFT_CURLY) {
+                error = b->on_object_start(&p->builder);
+                p->state = JSON_PUSH_FIRST_KEY;
+            } else {
+                error = b->on_array_start(&p->builder);
+                p->state = JSON_PUSH_FIRST_VALUE;
+            }
+            if (error) {
+                return json_push_fail(p, JSON_ERROR_MEMORY, tok.offset);
+            }
+            return 0;
+        case STRING:
+            error = b->on_string(&p->builder, tok.value.string);
+            break;
+        case NUMBER_INT:
+            error = b->on_int(&p->builder, tok.value.number_int);
+            break;
+        case NUMBER_UINT:
+            error = b->on_uint(&p->builder, tok.value.number_uint);
+            break;
+        case NUMBER_FLOAT:
+            error = b->on_float(&p->builder, tok.value.number_float);
+            break;
+        case TRUE:
+        case FALSE:
+            error = b->on_bool(&p->builder, tok.type == TRUE);
+            break;
+        case NULL_TOKEN:
+            error = b->on_null(&p->builder);
+            break;
+        default:
+            return json_push_error(p, tok, "json element");
+    }
+
+    if (error) {
+        return json_push_fail(p, JSON_ERROR_MEMORY, tok.offset);
+    }
+    p->state = p->builder.depth == 0 ? JSON_PUSH_DONE : JSON_PUSH_COMMA;
+    return 0;
+}
+
+// Advances the grammar by one token
+static int json_push_token(JSONPushParser *p, JSONToken tok) {
+    switch (p->state) {
+        case JSON_PUSH_FIRST_VALUE:
+            if (tok.type == RIGHT_SQUARE) {
+                json_push_close(p, false);
+                return 0;
+            }
+            return json_push_value(p, tok);
+        case JSON_PUSH_VALUE:
+            return json_push_value(p, tok);
+        case JSON_PUSH_FIRST_KEY:
+            if (tok.type == RIGHT_CURLY) {
+                json_push_close(p, true);
+                return 0;
+            }
+            // Fall through
+        case JSON_PUSH_KEY:
+            if (tok.type != STRING) {
+                return json_push_error(p, tok, token_names[STRING]);
+            }
+            json_builder_callbacks.on_key(&p->builder, tok.value.string);
+            p->state = JSON_PUSH_COLON;
+            return 0;
+        case JSON_PUSH_COLON:
+            if (tok.type != COLON) {
+                return json_push_error(p, tok, token_names[COLON]);
+            }
+            p->state = JSON_PUSH_VALUE;
+            return 0;
+        case JSON_PUSH_COMMA: {
+            JSONBuilderFrame *frame = &p->builder.stack[p->builder.depth - 1];
+            bool object = frame->container.type == JSON_ELEMENT_OBJECT;
+            if (tok.type == COMMA) {
+                p->state = object ? JSON_PUSH_KEY : JSON_PUSH_VALUE;
+                return 0;
+            }
+            if (tok.type == (object ? RIGHT_CURLY : RIGHT_SQUARE)) {
+                json_push_close(p, object);
+                return 0;
+            }
+            return json_push_error(p, tok,
+                                   object ? "',' or '}'" : "',' or ']'");
+        }
+        case JSON_PUSH_DONE:
+            if (tok.type != END) {
+                return json_push_error(p, tok, token_names[END]);
+            }
+            return 0;
+    }
+    return 0;
+}
+
+// Lexes and parses the tokens in buf. Unless buf ends the input, a token
+// that runs into the end of buf is left unread. Returns the number of bytes
+// consumed in consumed.
+static int json_push_lex(JSONPushParser *p, const char *buf, size_t len,
+                         bool last, size_t *consumed) {
+    JSONTokenizer *t = &p->tokenizer;
+    t->content = buf;
+    t->current_char = buf;
+    t->end = buf + len;
+
+    while (true) {
+        json_tokenizer_skip_whitespace(t);
+        if (t->current_char == t->end) break;
+
+        if (!last &&
+            json_push_token_length(t->current_char, t->end - t->current_char) ==
+                0) {
+            break;
+        }
+
+        if (json_next_token(p->arena, t)) {
+            return json_push_keep(p, t->error);
+        }
+        if (json_push_token(p, t->current_token)) {
+            return 1;
+        }
+    }
+
+    *consumed = t->current_char - buf;
+    json_push_lines(p, buf, *consumed);
+    return 0;
+}
+
+static int json_push_carry(JSONPushParser *p, const char *data, size_t len) {
+    if (len == 0) {
+        return 0;
+    }
+
+    if (p->carry_size + len > p->carry_capacity) {
+        size_t capacity = p->carry_capacity ? p->carry_capacity : 64;
+        while (capacity < p->carry_size + len) capacity *= 2;
+
+        char *carry = realloc(p->carry, capacity);
+        if (carry == NULL) {
+            json_error_set(&p->error, JSON_ERROR_MEMORY, NULL, 0);
+            return 1;
+        }
+        p->carry = carry;
+        p->carry_capacity = capacity;
+    }
+
+    memcpy(p->carry + p->carry_size, data, len);
+    p->carry_size += len;
+    return 0;
+}
+
+// Returns how many bytes at the start of chunk belong to the token in the
+// carry buffer, and whether they complete it
+static size_t json_push_rest(const JSONPushParser *p, const char *chunk,
+                             size_t len, bool *complete) {
+    char first = p->carry[0];
+
+    if (first == '"' || first == '\'') {
+        // An odd run of backslashes at the end escapes the chunk's first byte
+        size_t backslashes = 0;
+        while (backslashes < p->carry_size - 1 &&
+               p->carry[p->carry_size - 1 - backslashes] == '\\') {
+            ++backslashes;
+        }
+
+        size_t end;
+        *complete =
+            json_push_string_end(chunk, len, first, backslashes % 2, &end);
+        return end;
+    }
+
+    size_t end = json_push_word_end(chunk, len);
+    *complete = end < len;
+    return end;
+}
+
+void json_parser_init(JSONPushParser *p, Arena *a) {
+    // Field by field, so the builder's frame stack isn't cleared
+    p->arena = a;
+    p->mark = arena_mark(a);
+    json_tokenizer_init(&p->tokenizer, NULL, 0);
+    p->state = JSON_PUSH_VALUE;
+    json_builder_init(&p->builder, a);
+    p->carry = NULL;
+    p->carry_size = p->carry_capacity = 0;
+    p->fed = p->base = 0;
+    p->line = 1;
+    p->line_start = 0;
+    p->error = (JSONError){0};
+}
+
+int json_parser_feed(JSONPushParser *p, const char *chunk, size_t len) {
+    if (p->error.code != JSON_ERROR_NONE) {
+        return 1;
+    }
+
+    if (p->carry_size > 0) {
+        bool complete;
+        size_t rest = json_push_rest(p, chunk, len, &complete);
+        if (json_push_carry(p, chunk, rest)) return 1;
+        chunk += rest;
+        len -= rest;
+        p->fed += rest;
+
+        if (!complete) {
+            return 0;
+        }
+
+        size_t consumed;
+        p->base = p->fed - p->carry_size;
+        if (json_push_lex(p, p->carry, p->carry_size, true, &consumed)) {
+            return 1;
+        }
+        p->carry_size = 0;
+    }
+
+    size_t consumed;
+    p->base = p->fed;
+    p->fed += len;
+    if (json_push_lex(p, chunk, len, false, &consumed)) {
+        return 1;
+    }
+    return json_push_carry(p, chunk + consumed, len - consumed);
+}
+
+JSONElement json_parser_finish(JSONPushParser *p, JSONError *error) {
+    size_t consumed;
+    if (p->error.code == JSON_ERROR_NONE && p->carry_size > 0) {
+        p->base = p->fed - p->carry_size;
+        json_push_lex(p, p->carry, p->carry_size, true, &consumed);
+    }
+
+    if (p->error.code == JSON_ERROR_NONE) {
+        // Fails unless the root is complete. The last chunk may be gone, the
+        // end is placed with the lines counted so far.
+        p->base = p->fed;
+        p->tokenizer.content = NULL;
+        json_push_token(p, (JSONToken){.type = END});
+    }
+
+    JSONElement root = p->builder.root;
+    free(p->carry);
+    p->carry = NULL;
+    p->carry_size = p->carry_capacity = 0;
+
+    *error = p->error;
+    if (error->code != JSON_ERROR_NONE) {
+        arena_rewind(p->arena, p->mark);
+        return (JSONElement){0};
+    }
+    return root;
+}
@@ -0,0 +1,643 @@
+#include "query.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "scan.h"
+#include "utils.h"
+
+// The state reached once every step has matched
+#define JSON_QUERY_MATCH(q) ((uint64_t)1 << (q)->count)
+
+// -----------
+// Compilation
+// -----------
+
+// Errors are placed in the path, expected may be NULL
+static int json_query_error(JSONError *error, JSONErrorCode code,
+                            const char *path, const char *at,
+                            const char *expected) {
+    if (error->code == JSON_ERROR_NONE) {
+        json_error_set(error, code, path, at - path);
+        error->expected = expected;
+    }
+    return 1;
+}
+
+static int json_query_add(JSONQuery *q, JSONStep *steps, JSONStep step,
+                          const char *path, const char *at,
+                          JSONError *error) {
+    if (q->count == JSON_QUERY_MAX_STEPS) {
+        return json_query_error(error, JSON_ERROR_SIZE, path, at, NULL);
+    }
+    if (step.type == JSON_STEP_DESCEND) {
+        q->descend |= (uint64_t)1 << q->count;
+    }
+    steps[q->count++] = step;
+    return 0;
+}
+
+// An RFC 6901 array index: digits without leading zeros
+static size_t json_pointer_index(JSONString token) {
+    if (token.length == 0 || (token.length > 1 && token.data[0] == '0')) {
+        return SIZE_MAX;
+    }
+
+    size_t index = 0;
+    for (size_t i = 0; i < token.length; i++) {
+        if (!is_digit(token.data[i]) || index > (SIZE_MAX - 9) / 10) {
+            return SIZE_MAX;
+        }
+        index = index * 10 + (token.data[i] - '0');
+    }
+    return index;
+}
+
+static int json_pointer_compile(Arena *a, JSONQuery *q, JSONStep *steps,
+                                const char *path, JSONError *error) {
+    const char *p = path;
+    while (*p != '\0') {
+        if (*p != '/') {
+            return json_query_error(error, JSON_ERROR_SYNTAX, path, p, "'/'");
+        }
+        ++p;
+
+        size_t length = strcspn(p, "/");
+        char *key = arena_alloc_aligned(a, length + 1, 1);
+        if (key == NULL) {
+            return json_query_error(error, JSON_ERROR_MEMORY, path, p, NULL);
+        }
+
+        // ~1 and ~0 stand for '/' and '~'
+        size_t j = 0;
+        for (size_t i = 0; i < length; i++) {
+            if (p[i] != '~') {
+                key[j++] = p[i];
+            } else if (i + 1 < length && (p[i + 1] == '0' || p[i + 1] == '1')) {
+                key[j++] = p[++i] == '0' ? '~' : '/';
+            } else {
+                return json_query_error(error, JSON_ERROR_STRING, path,
+                                        p + i, NULL);
+            }
+        }
+        key[j] = '\0';
+
+        JSONStep step = {.type = JSON_STEP_MEMBER,
+                         .key = {.data = key, .length = j}};
+        step.index = json_pointer_index(step.key);
+        if (json_query_add(q, steps, step, path, p, error)) {
+            return 1;
+        }
+        p += length;
+    }
+    return 0;
+}
+
+// Compiles ['name'], [3] or [*], p being just past the '['
+static const char *json_path_bracket(Arena *a, JSONQuery *q, JSONStep *steps,
+                                     const char *path, const char *p,
+                                     JSONError *error) {
+    JSONStep step = {0};
+
+    if (*p == '*') {
+        step.type = JSON_STEP_WILDCARD;
+        ++p;
+    } else if (is_digit(*p)) {
+        const char *start = p;
+        step.type = JSON_STEP_INDEX;
+        for (; is_digit(*p); ++p) {
+            if (step.index > (SIZE_MAX - 9) / 10) {
+                json_query_error(error, JSON_ERROR_NUMBER, path, start, NULL);
+                return NULL;
+            }
+            step.index = step.index * 10 + (*p - '0');
+        }
+    } else if (*p == '\'' || *p == '"') {
+        char quote = *p++;
+        char *key = arena_alloc_aligned(a, strlen(p) + 1, 1);
+        if (key == NULL) {
+            json_query_error(error, JSON_ERROR_MEMORY, path, p, NULL);
+            return NULL;
+        }
+
+        size_t j = 0;
+        for (; *p != quote; ++p) {
+            if (*p == '\\' && p[1] != '\0') {
+                ++p;
+            } else if (*p == '\0') {
+                json_query_error(error, JSON_ERROR_STRING, path, p, NULL);
+                return NULL;
+            }
+            key[j++] = *p;
+        }
+        key[j] = '\0';
+        ++p;
+
+        step.type = JSON_STEP_KEY;
+        step.key = (JSONString){.data = key, .length = j};
+    } else {
+        json_query_error(error, JSON_ERROR_SYNTAX, path, p,
+                         "a name, index or '*'");
+        return NULL;
+    }
+
+    if (*p != ']') {
+        json_query_error(error, JSON_ERROR_SYNTAX, path, p, "']'");
+        return NULL;
+    }
+    if (json_query_add(q, steps, step, path, p, error)) {
+        return NULL;
+    }
+    return p + 1;
+}
+
+// Compiles a name or * following a '.', p being just past it
+static const char *json_path_name(Arena *a, JSONQuery *q, JSONStep *steps,
+                                  const char *path, const char *p,
+                                  JSONError *error) {
+    size_t length = strcspn(p, ".[");
+    if (length == 0) {
+        json_query_error(error, JSON_ERROR_SYNTAX, path, p, "a name or '*'");
+        return NULL;
+    }
+
+    JSONStep step = {.type = JSON_STEP_WILDCARD};
+    if (length != 1 || *p != '*') {
+        char *key = arena_alloc_aligned(a, length + 1, 1);
+        if (key == NULL) {
+            json_query_error(error, JSON_ERROR_MEMORY, path, p, NULL);
+            return NULL;
+        }
+        memcpy(key, p, length);
+        key[length] = '\0';
+
+        step.type = JSON_STEP_KEY;
+        step.key = (JSONString){.data = key, .length = length};
+    }
+
+    if (json_query_add(q, steps, step, path, p, error)) {
+        return NULL;
+    }
+    return p + length;
+}
+
+static int json_path_compile(Arena *a, JSONQuery *q, JSONStep *steps,
+                             const char *path, JSONError *error) {
+    const char *p = path + 1;  // Past the $
+    while (p != NULL && *p != '\0') {
+        if (p[0] == '.' && p[1] == '.') {
+            JSONStep step = {.type = JSON_STEP_DESCEND};
+            if (json_query_add(q, steps, step, path, p, error)) {
+                return 1;
+            }
+            p += 2;
+            p = *p == '['
+                    ? json_path_bracket(a, q, steps, path, p + 1, error)
+                    : json_path_name(a, q, steps, path, p, error);
+        } else if (*p == '.') {
+            p = json_path_name(a, q, steps, path, p + 1, error);
+        } else if (*p == '[') {
+            p = json_path_bracket(a, q, steps, path, p + 1, error);
+        } else {
+            return json_query_error(error, JSON_ERROR_SYNTAX, path, p,
+                                    "'.' or '['");
+        }
+    }
+    return p == NULL;
+}
+
+JSONQuery *json_query_compile(Arena *a, const char *path,
+                              JSONError *error) {
+    *error = (JSONError){0};
+    if (path == NULL) {
+        json_error_set(error, JSON_ERROR_ARGUMENT, NULL, 0);
+        return NULL;
+    }
+
+    ArenaMark mark = arena_mark(a);
+    JSONQuery *q = arena_alloc(a, sizeof(JSONQuery));
+    JSONStep steps[JSON_QUERY_MAX_STEPS];
+    if (q == NULL) {
+        json_error_set(error, JSON_ERROR_MEMORY, NULL, 0);
+        return NULL;
+    }
+    *q = (JSONQuery){0};
+
+    int failed;
+    if (*path == '$') {
+        failed = json_path_compile(a, q, steps, path, error);
+    } else if (*path == '/' || *path == '\0') {
+        failed = json_pointer_compile(a, q, steps, path, error);
+    } else {
+        failed = json_query_error(error, JSON_ERROR_SYNTAX, path, path,
+                                  "'$' or '/'");
+    }
+
+    if (!failed && q->count > 0) {
+        q->steps = arena_alloc(a, sizeof(JSONStep) * q->count);
+        if (q->steps == NULL) {
+            failed = json_query_error(error, JSON_ERROR_MEMORY, path, path,
+                                      NULL);
+        } else {
+            memcpy(q->steps, steps, sizeof(JSONStep) * q->count);
+        }
+    }
+
+    if (failed) {
+        arena_rewind(a, mark);
+        return NULL;
+    }
+    return q;
+}
+
+// ------
+// States
+// ------
+
+// The steps of a query that are live at a value are a bit set. A .. step
+// stays live all the way down and also makes the step after it live.
+static uint64_t json_query_closure(const JSONQuery *q, uint64_t states) {
+    return states | (states & q->descend) << 1;
+}
+
+static bool json_step_key(const JSONStep *step, JSONString key) {
+    return step->key.length == key.length &&
+           memcmp(step->key.data, key.data, key.length) == 0;
+}
+
+// The steps live at the value of the pair with key
+static uint64_t json_query_key_states(const JSONQuery *q, uint64_t states,
+                                      JSONString key) {
+    uint64_t next = 0;
+    for (; states != 0; states &= states - 1) {
+        int i = __builtin_ctzll(states);
+        const JSONStep *step = &q->steps[i];
+
+        switch (step->type) {
+            case JSON_STEP_KEY:
+            case JSON_STEP_MEMBER:
+                if (json_step_key(step, key)) next |= (uint64_t)2 << i;
+                break;
+            case JSON_STEP_WILDCARD:
+                next |= (uint64_t)2 << i;
+                break;
+            case JSON_STEP_DESCEND:
+                next |= (uint64_t)1 << i;
+                break;
+            case JSON_STEP_INDEX:
+                break;
+        }
+    }
+    return json_query_closure(q, next);
+}
+
+// The steps live at the array element at index
+static uint64_t json_query_index_states(const JSONQuery *q, uint64_t states,
+                                        size_t index) {
+    uint64_t next = 0;
+    for (; states != 0; states &= states - 1) {
+        int i = __builtin_ctzll(states);
+        const JSONStep *step = &q->steps[i];
+
+        switch (step->type) {
+            case JSON_STEP_INDEX:
+            case JSON_STEP_MEMBER:
+                if (step->index == index) next |= (uint64_t)2 << i;
+                break;
+            case JSON_STEP_WILDCARD:
+                next |= (uint64_t)2 << i;
+                break;
+            case JSON_STEP_DESCEND:
+                next |= (uint64_t)1 << i;
+                break;
+            case JSON_STEP_KEY:
+                break;
+        }
+    }
+    return json_query_closure(q, next);
+}
+
+// ---
+// DOM
+// ---
+
+static int json_query_visit(const JSONQuery *q, JSONElement *element,
+                            uint64_t states, JSONQueryFn fn, void *context) {
+    if (states & JSON_QUERY_MATCH(q)) {
+        if (fn(context, element)) return 1;
+        states &= ~JSON_QUERY_MATCH(q);
+    }
+    if (states == 0) {
+        return 0;
+    }
+
+    if (element->type == JSON_ELEMENT_OBJECT) {
+        for_each_pair(element->element.object, pair) {
+            uint64_t next = json_query_key_states(q, states, pair->key);
+            if (next != 0 &&
+                json_query_visit(q, &pair->value, next, fn, context)) {
+                return 1;
+            }
+        }
+    } else if (element->type == JSON_ELEMENT_ARRAY) {
+        size_t index = 0;
+        for_each_element(element->element.array, array_element) {
+            uint64_t next = json_query_index_states(q, states, index++);
+            if (next != 0 && json_query_visit(q, &array_element->element,
+                                              next, fn, context)) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int json_query_each(const JSONQuery *q, JSONElement *root, JSONQueryFn fn,
+                    void *context) {
+    return json_query_visit(q, root, json_query_closure(q, 1), fn, context);
+}
+
+static int json_query_keep_first(void *context, JSONElement *match) {
+    *(JSONElement **)context = match;
+    return 1;
+}
+
+JSONElement *json_query_first(const JSONQuery *q, JSONElement *root) {
+    JSONElement *match = NULL;
+    json_query_each(q, root, json_query_keep_first, &match);
+    return match;
+}
+
+// ---------
+// Streaming
+// ---------
+
+typedef struct {
+    const JSONQuery *q;
+    Arena *a;       // Matches
+    Arena scratch;  // Tokens that aren't part of a match
+    JSONTokenizer tokenizer;
+    JSONParser parser;
+    JSONQueryFn fn;
+    void *context;
+    bool stopped;
+    JSONError *error;
+} JSONQueryStream;
+
+static int json_stream_fail(JSONQueryStream *s, JSONErrorCode code,
+                            size_t offset) {
+    json_error_set(s->error, code, s->tokenizer.content, offset);
+    return 1;
+}
+
+static int json_stream_unexpected(JSONQueryStream *s, size_t offset,
+                                  const char *expected, const char *got) {
+    if (s->error->code == JSON_ERROR_NONE) {
+        json_stream_fail(s, JSON_ERROR_SYNTAX, offset);
+        s->error->expected = expected;
+        s->error->got = got;
+    }
+    return 1;
+}
+
+static int json_stream_error(JSONQueryStream *s, const char *expected) {
+    JSONToken tok = s->tokenizer.current_token;
+    return json_stream_unexpected(s, tok.offset, expected,
+                                  token_names[tok.type]);
+}
+
+// Lexes the next token into a, passing on why it failed if it did
+static int json_stream_lex(JSONQueryStream *s, Arena *a) {
+    if (json_next_token(a, &s->tokenizer)) {
+        if (s->error->code == JSON_ERROR_NONE) {
+            *s->error = s->tokenizer.error;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+static int json_stream_next(JSONQueryStream *s) {
+    arena_reset(&s->scratch);
+    return json_stream_lex(s, &s->scratch);
+}
+
+// Returns the byte after the string whose opening quote is just before p,
+// or NULL if it isn't closed
+static const char *json_stream_skip_string(const char *p, const char *end) {
+    while (true) {
+        p = json_scan_string(p, end);
+        if (p == end) return NULL;
+        if (*p == '"') return p + 1;
+        if (end - p < 2) return NULL;
+        p += 2;
+    }
+}
+
+// Steps over the value at the tokenizer's position without lexing it, only
+// strings and brackets are followed
+static int json_stream_skip_value(JSONQueryStream *s) {
+    JSONTokenizer *t = &s->tokenizer;
+    json_tokenizer_skip_whitespace(t);
+
+    const char *p = t->current_char;
+    const char *string = NULL;
+    size_t depth = 0;
+    while (p < t->end) {
+        char c = *p;
+        if (c == '"') {
+            string = p;
+            p = json_stream_skip_string(p + 1, t->end);
+            if (p == NULL) break;
+            if (depth == 0) break;
+        } else if (c == '{' || c == '[') {
+            ++depth;
+            ++p;
+        } else if (c == '}' || c == ']') {
+            if (depth == 0) break;
+            ++p;
+            if (--depth == 0) break;
+        } else if (depth == 0 && (c == ',' || is_whitespace(c))) {
+            break;
+        } else {
+            ++p;
+        }
+    }
+
+    if (p == NULL) {
+        return json_stream_fail(s, JSON_ERROR_STRING, string - t->content);
+    }
+    if (depth > 0) {
+        return json_stream_unexpected(s, p - t->content,
+                                      "',' or closing bracket",
+                                      token_names[END]);
+    }
+    if (p == t->current_char) {
+        // Stopped straight away at ',', a closing bracket or the end
+        return json_stream_unexpected(s, p - t->content, "json element",
+                                      json_token_name_at(p, t->end));
+    }
+
+    t->current_char = p;
+    return 0;
+}
+
+static int json_stream_value(JSONQueryStream *s, uint64_t states,
+                             size_t depth);
+
+// Handles the value at the tokenizer's position, which hasn't been lexed
+// yet, so that values no step wants are never lexed at all
+static int json_stream_element(JSONQueryStream *s, uint64_t states,
+                               size_t depth) {
+    if (states == 0) {
+        if (json_stream_skip_value(s)) return 1;
+        return json_stream_next(s);
+    }
+
+    // The first token of a match is part of it, an unescaped string would
+    // be overwritten in the scratch arena
+    if (states & JSON_QUERY_MATCH(s->q)) {
+        if (json_stream_lex(s, s->a)) return 1;
+    } else if (json_stream_next(s)) {
+        return 1;
+    }
+    return json_stream_value(s, states, depth);
+}
+
+static int json_stream_object(JSONQueryStream *s, uint64_t states,
+                              size_t depth) {
+    JSONTokenizer *t = &s->tokenizer;
+
+    if (json_stream_next(s)) return 1;
+    if (t->current_token.type == RIGHT_CURLY) {
+        return json_stream_next(s);
+    }
+
+    while (true) {
+        if (t->current_token.type != STRING) {
+            return json_stream_error(s, token_names[STRING]);
+        }
+        uint64_t next = json_query_key_states(s->q, states,
+                                              t->current_token.value.string);
+
+        if (json_stream_next(s)) return 1;
+        if (t->current_token.type != COLON) {
+            return json_stream_error(s, token_names[COLON]);
+        }
+        if (json_stream_element(s, next, depth)) return 1;
+
+        if (t->current_token.type == RIGHT_CURLY) {
+            return json_stream_next(s);
+        }
+        if (t->current_token.type != COMMA) {
+            return json_stream_error(s, "',' or '}'");
+        }
+        if (json_stream_next(s)) return 1;
+    }
+}
+
+static int json_stream_array(JSONQueryStream *s, uint64_t states,
+                             size_t depth) {
+    JSONTokenizer *t = &s->tokenizer;
+
+    // Look for an empty array without lexing the first element
+    json_tokenizer_skip_whitespace(t);
+    if (t->current_char < t->end && *t->current_char == ']') {
+        ++t->current_char;
+        return json_stream_next(s);
+    }
+
+    for (size_t index = 0;; index++) {
+        uint64_t next = json_query_index_states(s->q, states, index);
+        if (json_stream_element(s, next, depth)) return 1;
+
+        if (t->current_token.type == RIGHT_SQUARE) {
+            return json_stream_next(s);
+        }
+        if (t->current_token.type != COMMA) {
+            return json_stream_error(s, "',' or ']'");
+        }
+    }
+}
+
+// Handles the value starting at the current token for the live steps,
+// leaving the token after it current
+static int json_stream_value(JSONQueryStream *s, uint64_t states,
+                             size_t depth) {
+    JSONTokenizer *t = &s->tokenizer;
+    const JSONQuery *q = s->q;
+
+    if (states & JSON_QUERY_MATCH(q)) {
+        // Build the match, then look inside it for the steps still live
+        JSONElement *match = arena_alloc(s->a, sizeof(JSONElement));
+        if (match == NULL) {
+            return json_stream_fail(s, JSON_ERROR_MEMORY,
+                                    t->current_token.offset);
+        }
+
+        int error = 0;
+        s->parser.current_depth = depth;
+        *match = json_parse_element(s->a, &s->parser, &error);
+        if (error) {
+            if (s->error->code == JSON_ERROR_NONE) {
+                *s->error = s->parser.error;
+            }
+            return 1;
+        }
+
+        states &= ~JSON_QUERY_MATCH(q);
+        if (s->fn(s->context, match) ||
+            json_query_visit(q, match, states, s->fn, s->context)) {
+            s->stopped = true;
+            return 1;
+        }
+        return 0;
+    }
+
+    switch (t->current_token.type) {
+        case LEFT_CURLY:
+        case LEFT_SQUARE:
+            if (depth >= JSON_MAX_DEPTH) {
+                return json_stream_fail(s, JSON_ERROR_DEPTH,
+                                        t->current_token.offset);
+            }
+            return t->current_token.type == LEFT_CURLY
+                       ? json_stream_object(s, states, depth + 1)
+                       : json_stream_array(s, states, depth + 1);
+        case STRING:
+        case NUMBER_INT:
+        case NUMBER_UINT:
+        case NUMBER_FLOAT:
+        case NUMBER_RAW:
+        case TRUE:
+        case FALSE:
+        case NULL_TOKEN:
+            return json_stream_next(s);
+        default:
+            return json_stream_error(s, "json element");
+    }
+}
+
+int json_query_stream(Arena *a, const JSONQuery *q, const char *buf,
+                      size_t len, JSONQueryFn fn, void *context,
+                      JSONError *error) {
+    *error = (JSONError){0};
+    if (buf == NULL || fn == NULL) {
+        json_error_set(error, JSON_ERROR_ARGUMENT, NULL, 0);
+        return 1;
+    }
+
+    JSONQueryStream s = {
+        .q = q, .a = a, .fn = fn, .context = context, .error = error};
+    json_tokenizer_init(&s.tokenizer, buf, len);
+    s.tokenizer.borrow = true;
+    s.parser.tokenizer = &s.tokenizer;
+
+    int failed = json_stream_element(&s, json_query_closure(q, 1), 0);
+    if (!failed && s.tokenizer.current_token.type != END) {
+        failed = json_stream_error(&s, token_names[END]);
+    }
+
+    arena_free(&s.scratch);
+    return failed;
+}
@@ -0,0 +1,350 @@
+#include "scan.h"
+
+#include <stdbool.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define JSON_SCAN_X86
+#include <immintrin.h>
+#endif
+
+typedef struct {
+    const char *name;
+    void (*classify)(const char *block, JSONBlockMasks *m);
+    // Mask of '"' and '\' bytes
+    uint64_t (*string)(const char *block);
+    // Mask of '"', '\', control and non-ASCII bytes
+    uint64_t (*string_ascii)(const char *block);
+    // Mask of whitespace bytes
+    uint64_t (*whitespace)(const char *block);
+} JSONScanKernel;
+
+// ------
+// Scalar
+// ------
+
+enum {
+    CLASS_QUOTE = 1 << 0,
+    CLASS_BACKSLASH = 1 << 1,
+    CLASS_STRUCTURAL = 1 << 2,
+    CLASS_WHITESPACE = 1 << 3,
+    CLASS_CONTROL = 1 << 4,
+};
+
+#define C CLASS_CONTROL
+#define W CLASS_WHITESPACE
+
+static const unsigned char char_class[256] = {
+    C, C, C, C, C, C, C, C, C, C | W, C | W, C, C, C | W, C, C,
+    C, C, C, C, C, C, C, C, C, C,     C,     C, C, C,     C, C,
+    [' '] = W,
+    ['"'] = CLASS_QUOTE,
+    ['\\'] = CLASS_BACKSLASH,
+    ['{'] = CLASS_STRUCTURAL,
+    ['}'] = CLASS_STRUCTURAL,
+    ['['] = CLASS_STRUCTURAL,
+    [']'] = CLASS_STRUCTURAL,
+    [','] = CLASS_STRUCTURAL,
+    [':'] = CLASS_STRUCTURAL,
+};
+
+#undef C
+#undef W
+
+static void json_classify_scalar(const char *block, JSONBlockMasks *m) {
+    *m = (JSONBlockMasks){0};
+    for (int i = 0; i < JSON_BLOCK_SIZE; i++) {
+        uint64_t c = char_class[(unsigned char)block[i]];
+        m->quote |= (c & 1) << i;
+        m->backslash |= ((c >> 1) & 1) << i;
+        m->structural |= ((c >> 2) & 1) << i;
+        m->whitespace |= ((c >> 3) & 1) << i;
+        m->control |= ((c >> 4) & 1) << i;
+    }
+}
+
+static uint64_t json_string_scalar(const char *block) {
+    uint64_t mask = 0;
+    for (int i = 0; i < JSON_BLOCK_SIZE; i++) {
+        uint64_t c = char_class[(unsigned char)block[i]];
+        mask |= (uint64_t)((c & (CLASS_QUOTE | CLASS_BACKSLASH)) != 0) << i;
+    }
+    return mask;
+}
+
+// Stops a plain run of string bytes, along with every byte above 0x7f
+#define CLASS_STRING_STOP (CLASS_QUOTE | CLASS_BACKSLASH | CLASS_CONTROL)
+
+static uint64_t json_string_ascii_scalar(const char *block) {
+    uint64_t mask = 0;
+    for (int i = 0; i < JSON_BLOCK_SIZE; i++) {
+        unsigned char c = (unsigned char)block[i];
+        mask |= (uint64_t)(c >= 0x80 || (char_class[c] & CLASS_STRING_STOP))
+                << i;
+    }
+    return mask;
+}
+
+static uint64_t json_whitespace_scalar(const char *block) {
+    uint64_t mask = 0;
+    for (int i = 0; i < JSON_BLOCK_SIZE; i++) {
+        uint64_t c = char_class[(unsigned char)block[i]];
+        mask |= ((c >> 3) & 1) << i;
+    }
+    return mask;
+}
+
+static const JSONScanKernel scalar_kernel = {
+    .name = "scalar",
+    .classify = json_classify_scalar,
+    .string = json_string_scalar,
+    .string_ascii = json_string_ascii_scalar,
+    .whitespace = json_whitespace_scalar,
+};
+
+#ifdef JSON_SCAN_X86
+
+// ----
+// AVX2
+// ----
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static inline uint64_t json_mask_avx2(__m256i lo, __m256i hi) {
+    return (uint64_t)(uint32_t)_mm256_movemask_epi8(lo) |
+           (uint64_t)(uint32_t)_mm256_movemask_epi8(hi) << 32;
+}
+
+AVX2 static inline uint64_t json_eq_avx2(__m256i lo, __m256i hi, char c) {
+    __m256i v = _mm256_set1_epi8(c);
+    return json_mask_avx2(_mm256_cmpeq_epi8(lo, v), _mm256_cmpeq_epi8(hi, v));
+}
+
+AVX2 static inline __m256i json_space_avx2(__m256i x) {
+    return _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')),
+                        _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\t'))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\n')),
+                        _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\r'))));
+}
+
+AVX2 static inline __m256i json_structural_avx2(__m256i x) {
+    // Setting bit 5 folds '[' onto '{' and ']' onto '}', ',' and ':' are
+    // unaffected
+    __m256i folded = _mm256_or_si256(x, _mm256_set1_epi8(0x20));
+    return _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(folded, _mm256_set1_epi8('{')),
+                        _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('}'))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(',')),
+                        _mm256_cmpeq_epi8(x, _mm256_set1_epi8(':'))));
+}
+
+AVX2 static inline __m256i json_control_avx2(__m256i x) {
+    __m256i limit = _mm256_set1_epi8(0x1f);
+    return _mm256_cmpeq_epi8(_mm256_max_epu8(x, limit), limit);
+}
+
+AVX2 static void json_classify_avx2(const char *block, JSONBlockMasks *m) {
+    __m256i lo = _mm256_loadu_si256((const __m256i *)block);
+    __m256i hi = _mm256_loadu_si256((const __m256i *)(block + 32));
+
+    m->quote = json_eq_avx2(lo, hi, '"');
+    m->backslash = json_eq_avx2(lo, hi, '\\');
+    m->structural =
+        json_mask_avx2(json_structural_avx2(lo), json_structural_avx2(hi));
+    m->whitespace = json_mask_avx2(json_space_avx2(lo), json_space_avx2(hi));
+    m->control = json_mask_avx2(json_control_avx2(lo), json_control_avx2(hi));
+}
+
+AVX2 static uint64_t json_string_avx2(const char *block) {
+    __m256i lo = _mm256_loadu_si256((const __m256i *)block);
+    __m256i hi = _mm256_loadu_si256((const __m256i *)(block + 32));
+    __m256i quote = _mm256_set1_epi8('"');
+    __m256i backslash = _mm256_set1_epi8('\\');
+
+    return json_mask_avx2(_mm256_or_si256(_mm256_cmpeq_epi8(lo, quote),
+                                          _mm256_cmpeq_epi8(lo, backslash)),
+                          _mm256_or_si256(_mm256_cmpeq_epi8(hi, quote),
+                                          _mm256_cmpeq_epi8(hi, backslash)));
+}
+
+AVX2 static inline __m256i json_string_ascii_stop_avx2(__m256i x) {
+    // Bytes above 0x7f already have their top bit set for the movemask
+    return _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('"')),
+                        _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\\'))),
+        _mm256_or_si256(json_control_avx2(x), x));
+}
+
+AVX2 static uint64_t json_string_ascii_avx2(const char *block) {
+    __m256i lo = _mm256_loadu_si256((const __m256i *)block);
+    __m256i hi = _mm256_loadu_si256((const __m256i *)(block + 32));
+
+    return json_mask_avx2(json_string_ascii_stop_avx2(lo),
+                          json_string_ascii_stop_avx2(hi));
+}
+
+AVX2 static uint64_t json_whitespace_avx2(const char *block) {
+    __m256i lo = _mm256_loadu_si256((const __m256i *)block);
+    __m256i hi = _mm256_loadu_si256((const __m256i *)(block + 32));
+
+    return json_mask_avx2(json_space_avx2(lo), json_space_avx2(hi));
+}
+
+static const JSONScanKernel avx2_kernel = {
+    .name = "avx2",
+    .classify = json_classify_avx2,
+    .string = json_string_avx2,
+    .string_ascii = json_string_ascii_avx2,
+    .whitespace = json_whitespace_avx2,
+};
+
+// -------
+// SSE4.2
+// -------
+
+#define SSE42 __attribute__((target("sse4.2")))
+
+// PCMPESTRM matches each byte against a small character set in one go
+#define SET_MATCH (_SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK)
+
+SSE42 static inline uint64_t json_eq_sse42(__m128i x, char c) {
+    return (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8(c)));
+}
+
+SSE42 static inline uint64_t json_space_sse42(__m128i x) {
+    const __m128i set = _mm_setr_epi8(' ', '\t', '\n', '\r', 0, 0, 0, 0, 0,
+                                      0, 0, 0, 0, 0, 0, 0);
+    return (uint16_t)_mm_cvtsi128_si32(_mm_cmpestrm(set, 4, x, 16, SET_MATCH));
+}
+
+SSE42 static void json_classify_sse42(const char *block, JSONBlockMasks *m) {
+    const __m128i structural = _mm_setr_epi8('{', '}', '[', ']', ',', ':', 0,
+                                             0, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i limit = _mm_set1_epi8(0x1f);
+
+    *m = (JSONBlockMasks){0};
+    for (int i = 0; i < 4; i++) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(block + 16 * i));
+        int shift = 16 * i;
+
+        m->quote |= json_eq_sse42(x, '"') << shift;
+        m->backslash |= json_eq_sse42(x, '\\') << shift;
+        m->whitespace |= json_space_sse42(x) << shift;
+        m->structural |= (uint64_t)(uint16_t)_mm_cvtsi128_si32(
+                             _mm_cmpestrm(structural, 6, x, 16, SET_MATCH))
+                         << shift;
+        m->control |= (uint64_t)(uint16_t)_mm_movemask_epi8(
+                          _mm_cmpeq_epi8(_mm_max_epu8(x, limit), limit))
+                      << shift;
+    }
+}
+
+SSE42 static uint64_t json_string_sse42(const char *block) {
+    uint64_t mask = 0;
+    for (int i = 0; i < 4; i++) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(block + 16 * i));
+        mask |= (json_eq_sse42(x, '"') | json_eq_sse42(x, '\\')) << (16 * i);
+    }
+    return mask;
+}
+
+SSE42 static uint64_t json_string_ascii_sse42(const char *block) {
+    const __m128i limit = _mm_set1_epi8(0x1f);
+    uint64_t mask = 0;
+    for (int i = 0; i < 4; i++) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(block + 16 * i));
+        __m128i control = _mm_cmpeq_epi8(_mm_max_epu8(x, limit), limit);
+        mask |= (json_eq_sse42(x, '"') | json_eq_sse42(x, '\\') |
+                 (uint16_t)_mm_movemask_epi8(_mm_or_si128(control, x)))
+                << (16 * i);
+    }
+    return mask;
+}
+
+SSE42 static uint64_t json_whitespace_sse42(const char *block) {
+    uint64_t mask = 0;
+    for (int i = 0; i < 4; i++) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(block + 16 * i));
+        mask |= json_space_sse42(x) << (16 * i);
+    }
+    return mask;
+}
+
+static const JSONScanKernel sse42_kernel = {
+    .name = "sse4.2",
+    .classify = json_classify_sse42,
+    .string = json_string_sse42,
+    .string_ascii = json_string_ascii_sse42,
+    .whitespace = json_whitespace_sse42,
+};
+
+#endif  // JSON_SCAN_X86
+
+// --------
+// Dispatch
+// --------
+
+static const JSONScanKernel *kernel = &scalar_kernel;
+
+__attribute__((constructor)) static void json_scan_init(void) {
+#ifdef JSON_SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        kernel = &avx2_kernel;
+    } else if (__builtin_cpu_supports("sse4.2")) {
+        kernel = &sse42_kernel;
+    }
+#endif
+}
+
+void json_classify_block(const char *block, JSONBlockMasks *m) {
+    kernel->classify(block, m);
+}
+
+const char *json_scan_kernel_name(void) { return kernel->name; }
+
+const char *json_scan_string(const char *p, const char *end) {
+    while (end - p >= JSON_BLOCK_SIZE) {
+        uint64_t mask = kernel->string(p);
+        if (mask != 0) {
+            return p + __builtin_ctzll(mask);
+        }
+        p += JSON_BLOCK_SIZE;
+    }
+
+    while (p < end && *p != '"' && *p != '\\') {
+        ++p;
+    }
+    return p;
+}
+
+const char *json_scan_string_ascii(const char *p, const char *end) {
+    while (end - p >= JSON_BLOCK_SIZE) {
+        uint64_t mask = kernel->string_ascii(p);
+        if (mask != 0) {
+            return p + __builtin_ctzll(mask);
+        }
+        p += JSON_BLOCK_SIZE;
+    }
+
+    while (p < end && (unsigned char)*p < 0x80 &&
+           !(char_class[(unsigned char)*p] & CLASS_STRING_STOP)) {
+        ++p;
+    }
+    return p;
+}
+
+const char *json_skip_whitespace(const char *p, const char *end) {
+    while (end - p >= JSON_BLOCK_SIZE) {
+        uint64_t stop = ~kernel->whitespace(p);
+        if (stop != 0) {
+            return p + __builtin_ctzll(stop);
+        }
+        p += JSON_BLOCK_SIZE;
+    }
+
+    while (p < end && (char_class[(unsigned char)*p] & CLASS_WHITESPACE)) {
+        ++p;
+    }
+    return p;
+}
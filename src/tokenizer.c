@@ -1,209 +1,412 @@
 #include "tokenizer.h"
 
-#include <errno.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "intern.h"
+#include "number.h"
+#include "scan.h"
 #include "utils.h"
 
+#ifdef JSON_STATS
+#include "stats.h"
+#endif
+
 // Max string length 1MB
 #define MAX_STRING_LENGTH (1 << 20)
 
-JSONTokenizer *json_tokenize(Arena *a, const char *content, int *error) {
-    *error = 0;
+void json_tokenizer_init(JSONTokenizer *t, const char *content,
+                         size_t length) {
+    *t = (JSONTokenizer){.content = content,
+                         .end = content + length,
+                         .current_char = content,
+                         .current_token = {0},
+                         .tokens = NULL,
+                         .token_count = 0,
+                         .borrow = false};
+}
+
+// Records why the current token failed to lex, unless a more specific
+// reason was recorded first. Returns 1 for the caller to pass on.
+static int json_tokenizer_fail(JSONTokenizer *t, JSONErrorCode code) {
+    json_error_set(&t->error, code, t->content, t->current_token.offset);
+    return 1;
+}
+
+static void json_tokenize_symbol(JSONTokenizer *t, JSONTokenType type) {
+    t->current_token.type = type;
+    ++t->current_char;
+}
+
+void json_tokenizer_skip_whitespace(JSONTokenizer *t) {
+    // Long runs such as indentation are skipped in bulk
+    if (t->current_char < t->end && is_whitespace(*t->current_char)) {
+        t->current_char = json_skip_whitespace(t->current_char, t->end);
+    }
+}
+
+const char *json_token_name_at(const char *p, const char *end) {
+    if (p == end) {
+        return token_names[END];
+    }
+    switch (*p) {
+        case '{':
+            return token_names[LEFT_CURLY];
+        case '}':
+            return token_names[RIGHT_CURLY];
+        case '[':
+            return token_names[LEFT_SQUARE];
+        case ']':
+            return token_names[RIGHT_SQUARE];
+        case ',':
+            return token_names[COMMA];
+        case ':':
+            return token_names[COLON];
+        case '"':
+            return token_names[STRING];
+        case 't':
+            return token_names[TRUE];
+        case 'f':
+            return token_names[FALSE];
+        case 'n':
+            return token_names[NULL_TOKEN];
+        default:
+            return *p == '-' || is_digit(*p) ? token_names[NUMBER_RAW] : NULL;
+    }
+}
+
+static int json_lex(Arena *a, JSONTokenizer *t) {
+    t->current_token = (JSONToken){0};
+    json_tokenizer_skip_whitespace(t);
+
+    t->current_token.offset = t->current_char - t->content;
+
+    if (t->current_char == t->end) {
+        t->current_token.type = END;
+        return 0;
+    }
+
+    switch (*t->current_char) {
+        case '{':
+            json_tokenize_symbol(t, LEFT_CURLY);
+            return 0;
+        case '}':
+            json_tokenize_symbol(t, RIGHT_CURLY);
+            return 0;
+        case '[':
+            json_tokenize_symbol(t, LEFT_SQUARE);
+            return 0;
+        case ']':
+            json_tokenize_symbol(t, RIGHT_SQUARE);
+            return 0;
+        case ',':
+            json_tokenize_symbol(t, COMMA);
+            return 0;
+        case ':':
+            json_tokenize_symbol(t, COLON);
+            return 0;
+        case '"':
+        case '\'':
+            if (json_tokenize_string(a, t)) {
+                return json_tokenizer_fail(t, JSON_ERROR_STRING);
+            }
+            return 0;
+        case '-':
+        case '0' ... '9':
+            if (json_tokenize_number(a, t)) {
+                return json_tokenizer_fail(t, JSON_ERROR_NUMBER);
+            }
+            return 0;
+        case 't':
+            if (json_tokenize_true(t)) {
+                return json_tokenizer_fail(t, JSON_ERROR_LITERAL);
+            }
+            return 0;
+        case 'f':
+            if (json_tokenize_false(t)) {
+                return json_tokenizer_fail(t, JSON_ERROR_LITERAL);
+            }
+            return 0;
+        case 'n':
+            if (json_tokenize_null(t)) {
+                return json_tokenizer_fail(t, JSON_ERROR_LITERAL);
+            }
+            return 0;
+        default:
+            return json_tokenizer_fail(t, JSON_ERROR_LITERAL);
+    }
+}
+
+#ifdef JSON_STATS
+// Times the token and counts it under its type. Numbers and escaped
+// strings are also timed on their own.
+static int json_lex_counted(Arena *a, JSONTokenizer *t) {
+    JSONStats *s = t->stats;
+    size_t unescaped = s->bytes_unescaped;
+
+    uint64_t start = json_stats_now();
+    int error = json_lex(a, t);
+    uint64_t elapsed = json_stats_now() - start;
+    s->nanoseconds[JSON_STATS_TOKENIZE] += elapsed;
+    if (error) {
+        return error;
+    }
+
+    const JSONToken *tok = &t->current_token;
+    ++s->tokens[tok->type];
+    switch (tok->type) {
+        case NUMBER_INT:
+        case NUMBER_UINT:
+        case NUMBER_FLOAT:
+        case NUMBER_RAW:
+            s->nanoseconds[JSON_STATS_NUMBER] += elapsed;
+            break;
+        case STRING:
+            if (s->bytes_unescaped != unescaped) {
+                s->nanoseconds[JSON_STATS_UNESCAPE] += elapsed;
+            }
+            s->largest_string =
+                MAX(s->largest_string, tok->value.string.length);
+            break;
+        default:
+            break;
+    }
+    return 0;
+}
+#endif
+
+int json_next_token(Arena *a, JSONTokenizer *t) {
+#ifdef JSON_STATS
+    if (t->stats != NULL) {
+        return json_lex_counted(a, t);
+    }
+#endif
+    return json_lex(a, t);
+}
+
+JSONTokenizer *json_tokenize(Arena *a, const char *content,
+                             JSONError *error) {
+    *error = (JSONError){0};
 
     if (!content) {
-        *error = 1;
+        json_error_set(error, JSON_ERROR_ARGUMENT, NULL, 0);
         return NULL;
     }
 
+    // Nothing is left in a if tokenizing fails
+    ArenaMark mark = arena_mark(a);
+
     JSONTokenizer *t = arena_alloc(a, sizeof(JSONTokenizer));
     if (!t) {
-        *error = 1;
+        json_error_set(error, JSON_ERROR_MEMORY, NULL, 0);
         return NULL;
     }
 
-    // Add +1 to ensure space for null terminator
-    size_t content_len = strlen(content) + 1;
-    char *content_copy = arena_alloc(a, sizeof(char) * content_len);
-    if (!content_copy) {
-        *error = 1;
-        return NULL;
-    }
-
-    strncpy(content_copy, content, content_len - 1);
-    content_copy[content_len - 1] = '\0';  // Ensure null termination
-
-    *t = (JSONTokenizer){.content = content_copy,
-                         .current_char = content_copy,
-                         .current_token = {0},
-                         .current_line = 1,
-                         .current_col = 1,
-                         .tokens = NULL,
-                         .token_count = 0};
+    // Strings are copied out of the input, so the tokens never refer back
+    // to it and it can be read in place
+    json_tokenizer_init(t, content, strlen(content));
 
+    // The token array is the only allocation in tmp, so it grows by
+    // rewinding and allocating again: the old tokens stay where they are
+    // when the region has room, and are copied over otherwise
     Arena tmp = {0};
+    ArenaMark tmp_mark = arena_mark(&tmp);
     size_t capacity = INIT_CAPACITY;
     size_t size = 0;
     JSONToken *tokens = arena_alloc(&tmp, sizeof(JSONToken) * INIT_CAPACITY);
-    if (!tokens) {
-        *error = 1;
-        arena_free(&tmp);
-        return t;
-    }
-
-    while (*t->current_char != '\0' && !(*error)) {
-        switch (*t->current_char) {
-            case ' ':
-            case '\t':
-            case '\r':
-                t->current_token.line = t->current_line;
-                t->current_token.col = t->current_col;
-                ++t->current_col;
-                ++t->current_char;
-                continue;
-            case '\n':
-                ++t->current_line;
-                t->current_col = 1;
-                ++t->current_char;
-                continue;
-            case '{':
-                t->current_token = (JSONToken){.type = LEFT_CURLY};
-                t->current_token.line = t->current_line;
-                t->current_token.col = t->current_col;
-                ++t->current_col;
-                ++t->current_char;
-                break;
-            case '}':
-                t->current_token = (JSONToken){.type = RIGHT_CURLY};
-                t->current_token.line = t->current_line;
-                t->current_token.col = t->current_col;
-                ++t->current_col;
-                ++t->current_char;
-                break;
-            case '[':
-                t->current_token = (JSONToken){.type = LEFT_SQUARE};
-                t->current_token.line = t->current_line;
-                t->current_token.col = t->current_col;
-                ++t->current_col;
-                ++t->current_char;
-                break;
-            case ']':
-                t->current_token = (JSONToken){.type = RIGHT_SQUARE};
-                t->current_token.line = t->current_line;
-                t->current_token.col = t->current_col;
-                ++t->current_col;
-                ++t->current_char;
-                break;
-            case ',':
-                t->current_token = (JSONToken){.type = COMMA};
-                t->current_token.line = t->current_line;
-                t->current_token.col = t->current_col;
-                ++t->current_col;
-                ++t->current_char;
-                break;
-            case ':':
-                t->current_token = (JSONToken){.type = COLON};
-                t->current_token.line = t->current_line;
-                t->current_token.col = t->current_col;
-                ++t->current_col;
-                ++t->current_char;
-                break;
-            case '"':
-            case '\'':
-                if (json_tokenize_string(a, t)) {
-                    fprintf(stderr, "Line %zu, Col %zu: Invalid string\n",
-                            t->current_line, t->current_col);
-                    *error = 1;
-                }
-                break;
-            case '-':
-            case '0' ... '9':
-                if (json_tokenize_number(a, t)) {
-                    fprintf(stderr, "Line %zu, Col %zu: Invalid number\n",
-                            t->current_line, t->current_col);
-                    *error = 1;
-                }
-                break;
-            case 't':
-                if (json_tokenize_true(t)) {
-                    fprintf(
-                        stderr,
-                        "Line %zu, Col %zu: Invalid token starting with 't'\n",
-                        t->current_line, t->current_col);
-                    *error = 1;
-                }
-                break;
-            case 'f':
-                if (json_tokenize_false(t)) {
-                    fprintf(
-                        stderr,
-                        "Line %zu, Col %zu: Invalid token starting with 'f'\n",
-                        t->current_line, t->current_col);
-                    *error = 1;
-                }
-                break;
-            case 'n':
-                if (json_tokenize_null(t)) {
-                    fprintf(
-                        stderr,
-                        "Line %zu, Col %zu: Invalid token starting with 'n'\n",
-                        t->current_line, t->current_col);
-                    *error = 1;
-                }
-                break;
-            default:
-                fprintf(stderr, "Line %zu, Col %zu: Unknown character: %c\n",
-                        t->current_line, t->current_col, *t->current_char);
-                *error = 1;
-        }
 
-        if (*error) break;
+    while (tokens != NULL) {
+        if (json_next_token(a, t)) {
+            tokens = NULL;
+            break;
+        }
 
         // Resize array if needed
         if (size + 1 >= capacity) {
             capacity *= 2;
+            arena_rewind(&tmp, tmp_mark);
             JSONToken *new_tokens =
                 arena_alloc(&tmp, sizeof(JSONToken) * capacity);
-            if (!new_tokens) {
-                *error = 1;
-                arena_free(&tmp);
-                return t;
+            if (new_tokens != NULL && new_tokens != tokens) {
+                memcpy(new_tokens, tokens, sizeof(JSONToken) * size);
             }
-            memcpy(new_tokens, tokens, sizeof(JSONToken) * size);
             tokens = new_tokens;
+            if (tokens == NULL) break;
         }
 
         // Add token to array
         tokens[size] = t->current_token;
         ++size;
-        t->current_token = (JSONToken){0};
-    }
 
-    if (!(*error)) {
-        tokens[size] = (JSONToken){.type = END};
-        ++size;
+        if (t->current_token.type == END) break;
+    }
 
+    if (tokens != NULL) {
         t->token_count = size;
         t->tokens = arena_alloc(a, sizeof(JSONToken) * size);
-        if (!t->tokens) {
-            *error = 1;
-            arena_free(&tmp);
-            return t;
+        if (t->tokens != NULL) {
+            memcpy(t->tokens, tokens, sizeof(JSONToken) * size);
         }
-        memcpy(t->tokens, tokens, sizeof(JSONToken) * size);
-    } else {
-        // Set empty token array on error
-        t->token_count = 0;
-        t->tokens = NULL;
     }
 
     arena_free(&tmp);
+
+    if (tokens == NULL || t->tokens == NULL) {
+        // A lexing error, or else the token array didn't fit
+        *error = t->error;
+        json_error_set(error, JSON_ERROR_MEMORY, content,
+                       t->current_char - content);
+        arena_rewind(a, mark);
+        return NULL;
+    }
     return t;
 }
 
+// Finds the closing quote or the next backslash of a string body
+static const char *json_find_quote_or_escape(const char *p, const char *end,
+                                             char quote) {
+    if (quote == '"') {
+        return json_scan_string(p, end);
+    }
+
+    while (p < end && *p != quote && *p != '\\') {
+        ++p;
+    }
+    return p;
+}
+
+// Whether the string closed by the quote at close goes in the intern pool:
+// keys, which the next token is a colon after, and short values
+static bool json_tokenizer_interns(const JSONTokenizer *t, const char *close,
+                                   size_t length) {
+    if (length <= t->intern->max_value_length) {
+        return true;
+    }
+
+    const char *p = close + 1;
+    while (p < t->end && is_whitespace(*p)) p++;
+    return p < t->end && *p == ':';
+}
+
+// Swaps the string just lexed for its pooled copy
+static int json_tokenizer_intern(JSONTokenizer *t) {
+    JSONString *string = &t->current_token.value.string;
+    JSONString interned = json_intern(t->intern, string->data, string->length);
+    if (interned.data == NULL) {
+        return json_tokenizer_fail(t, JSON_ERROR_MEMORY);
+    }
+    *string = interned;
+    return 0;
+}
+
+static int json_hex_digit(char c) {
+    if (is_digit(c)) return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// The code unit of the \uXXXX escape at p (the 'u'), or -1
+static long json_decode_hex4(const char *p, const char *end) {
+    if (end - p < 5 || *p != 'u') {
+        return -1;
+    }
+
+    long unit = 0;
+    for (int i = 1; i <= 4; i++) {
+        int digit = json_hex_digit(p[i]);
+        if (digit < 0) {
+            return -1;
+        }
+        unit = unit << 4 | digit;
+    }
+    return unit;
+}
+
+static size_t json_encode_utf8(unsigned long code, char *out) {
+    if (code < 0x80) {
+        out[0] = (char)code;
+        return 1;
+    }
+    if (code < 0x800) {
+        out[0] = (char)(0xc0 | code >> 6);
+        out[1] = (char)(0x80 | (code & 0x3f));
+        return 2;
+    }
+    if (code < 0x10000) {
+        out[0] = (char)(0xe0 | code >> 12);
+        out[1] = (char)(0x80 | (code >> 6 & 0x3f));
+        out[2] = (char)(0x80 | (code & 0x3f));
+        return 3;
+    }
+    out[0] = (char)(0xf0 | code >> 18);
+    out[1] = (char)(0x80 | (code >> 12 & 0x3f));
+    out[2] = (char)(0x80 | (code >> 6 & 0x3f));
+    out[3] = (char)(0x80 | (code & 0x3f));
+    return 4;
+}
+
+size_t json_decode_escape(const char *p, const char *end, char *out,
+                          size_t *used) {
+    if (p >= end) {
+        return 0;
+    }
+
+    *used = 1;
+    switch (*p) {
+        case '"':
+        case '\\':
+        case '/':
+        case '\'':  // Inside single-quoted strings
+            *out = *p;
+            return 1;
+        case 'b':
+            *out = '\b';
+            return 1;
+        case 'f':
+            *out = '\f';
+            return 1;
+        case 'n':
+            *out = '\n';
+            return 1;
+        case 'r':
+            *out = '\r';
+            return 1;
+        case 't':
+            *out = '\t';
+            return 1;
+        case 'u':
+            break;
+        default:
+            return 0;
+    }
+
+    long unit = json_decode_hex4(p, end);
+    if (unit < 0) {
+        return 0;
+    }
+    *used = 5;
+
+    unsigned long code = (unsigned long)unit;
+    if (unit >= 0xd800 && unit <= 0xdbff) {
+        // A high surrogate, paired up with the low one escaped right after
+        long low = end - p >= 7 && p[5] == '\\'
+                       ? json_decode_hex4(p + 6, end)
+                       : -1;
+        if (low >= 0xdc00 && low <= 0xdfff) {
+            code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+            *used = 11;
+        } else {
+            code = 0xfffd;
+        }
+    } else if (unit >= 0xdc00 && unit <= 0xdfff) {
+        code = 0xfffd;
+    }
+    return json_encode_utf8(code, out);
+}
+
 int json_tokenize_string(Arena *a, JSONTokenizer *t) {
-    if (!t || !t->current_char || !(*t->current_char)) {
+    if (!t || !t->current_char || t->current_char >= t->end) {
         return 1;  // Error
     }
 
@@ -212,138 +415,154 @@ int json_tokenize_string(Arena *a, JSONTokenizer *t) {
         return 1;  // Error - not a string
     }
 
-    t->current_token.line = t->current_line;
-    t->current_token.col = t->current_col;
+    t->current_token.offset = t->current_char - t->content;
 
     // Move past opening quote
     ++t->current_char;
-    ++t->current_col;
 
-    // Find the length of the string and check for closing quote
-    size_t literal_len = 0;
-    while (t->current_char[literal_len] != '\0') {
-        if (t->current_char[literal_len] == quote) {
+    // Find the length of the string and check for closing quote, jumping
+    // straight between quotes and backslashes
+    const char *cursor = t->current_char;
+    bool escaped = false;
+    while (true) {
+        cursor = json_find_quote_or_escape(cursor, t->end, quote);
+        if (cursor >= t->end || *cursor == quote) {
             break;
         }
 
         // Handle escaped characters
-        if (t->current_char[literal_len] == '\\' &&
-            t->current_char[literal_len + 1] != '\0') {
-            literal_len += 2;  // Skip the escape sequence
-        } else {
-            ++literal_len;
-        }
+        escaped = true;
+        cursor += t->end - cursor > 1 ? 2 : 1;  // Skip the escape sequence
+    }
 
-        // Check for max string length
-        if (literal_len > MAX_STRING_LENGTH) {
-            fprintf(stderr,
-                    "Line %zu, Col %zu: String exceeds maximum length\n",
-                    t->current_line, t->current_col);
-            return 1;  // Error
-        }
+    size_t literal_len = cursor - t->current_char;
+
+    // Check for max string length
+    if (literal_len > MAX_STRING_LENGTH) {
+        return 1;  // Error
     }
 
     // Check if we reached end of input without closing quote
-    if (t->current_char[literal_len] == '\0') {
-        fprintf(stderr, "Line %zu, Col %zu: Unterminated string\n",
-                t->current_line, t->current_col);
+    if (cursor >= t->end) {
         return 1;  // Error
     }
 
+    t->current_token.type = STRING;
+
+    bool pooled =
+        t->intern != NULL && json_tokenizer_interns(t, cursor, literal_len);
+
+    if (!escaped && (t->borrow || pooled)) {
+        // Nothing to decode, point straight into the input
+        t->current_token.value.string =
+            (JSONString){.data = t->current_char, .length = literal_len};
+        t->current_char += literal_len + 1;
+        return pooled ? json_tokenizer_intern(t) : 0;
+    }
+
+#ifdef JSON_STATS
+    if (escaped && t->stats != NULL) {
+        t->stats->bytes_unescaped += literal_len;
+    }
+#endif
+
+    // A pooled string is only decoded in a until it is interned
+    ArenaMark mark = pooled ? arena_mark(a) : (ArenaMark){0};
+
     // Allocate space for the string and handle escape sequences
-    char *literal = arena_alloc(a, sizeof(char) * (literal_len + 1));
+    char *literal = arena_alloc_aligned(a, literal_len + 1, 1);
     if (!literal) {
-        return 1;  // Memory allocation error
+        return json_tokenizer_fail(t, JSON_ERROR_MEMORY);
     }
 
     size_t j = 0;
     for (size_t i = 0; i < literal_len; i++) {
-        if (t->current_char[i] == '\\' && i + 1 < literal_len) {
-            // Handle escape sequences
-            i++;  // Skip the backslash
-            switch (t->current_char[i]) {
-                case '\\':
-                case '\'':
-                case '"':
-                    literal[j++] = t->current_char[i];
-                    break;
-                case 'n':
-                    literal[j++] = '\n';
-                    break;
-                case 't':
-                    literal[j++] = '\t';
-                    break;
-                case 'r':
-                    literal[j++] = '\r';
-                    break;
-                default:
-                    // Just include both characters for other sequences
-                    literal[j++] = '\\';
-                    literal[j++] = t->current_char[i];
-            }
-        } else {
-            literal[j++] = t->current_char[i];
+        // Copy everything up to the next backslash in one go
+        const char *slash =
+            memchr(t->current_char + i, '\\', literal_len - i);
+        size_t run = slash ? (size_t)(slash - t->current_char) - i
+                           : literal_len - i;
+        memcpy(literal + j, t->current_char + i, run);
+        i += run;
+        j += run;
+        if (i == literal_len) break;
+
+        // Escapes never decode to more bytes than they are written with
+        size_t used;
+        size_t decoded = json_decode_escape(t->current_char + i + 1,
+                                            t->current_char + literal_len,
+                                            literal + j, &used);
+        if (decoded == 0) {
+            if (pooled) arena_rewind(a, mark);
+            return json_tokenizer_fail(t, JSON_ERROR_STRING);
         }
+        j += decoded;
+        i += used;  // The loop steps past the backslash
     }
 
     literal[j] = '\0';  // Null terminate the string
 
-    t->current_token.value.string = literal;
-    t->current_token.type = STRING;
+    t->current_token.value.string = (JSONString){.data = literal, .length = j};
 
     // Move past the closing quote
     t->current_char += literal_len + 1;
-    t->current_col += literal_len + 1;
 
+    if (pooled) {
+        int error = json_tokenizer_intern(t);
+        arena_rewind(a, mark);
+        return error;
+    }
     return 0;  // Success
 }
 
-int json_tokenize_true(JSONTokenizer *t) {
-    if (!t || !t->current_char) {
-        return 1;  // Error
-    }
+static bool json_literal_matches(const char *p, const char *end,
+                                 const char *literal, size_t length) {
+    return (size_t)(end - p) >= length && memcmp(p, literal, length) == 0;
+}
 
-    if (strncmp(t->current_char, "true", 4) == 0) {
-        t->current_token.type = TRUE;
-        t->current_token.line = t->current_line;
-        t->current_token.col = t->current_col;
-        t->current_char += 4;
-        t->current_col += 4;
-        return 0;  // Success
+size_t json_literal_length(const char *p, const char *end) {
+    if (p >= end) {
+        return 0;
+    }
+    switch (*p) {
+        case 't':
+            return json_literal_matches(p, end, "true", 4) ? 4 : 0;
+        case 'f':
+            return json_literal_matches(p, end, "false", 5) ? 5 : 0;
+        case 'n':
+            return json_literal_matches(p, end, "null", 4) ? 4 : 0;
+        default:
+            return 0;
     }
-    return 1;  // Error
 }
 
-int json_tokenize_false(JSONTokenizer *t) {
-    if (!t || !t->current_char) {
+// Lexes the literal at the current position if it starts with first
+static int json_tokenize_literal(JSONTokenizer *t, char first,
+                                 JSONTokenType type) {
+    if (!t || !t->current_char || t->current_char == t->end ||
+        *t->current_char != first) {
         return 1;  // Error
     }
 
-    if (strncmp(t->current_char, "false", 5) == 0) {
-        t->current_token.type = FALSE;
-        t->current_token.line = t->current_line;
-        t->current_token.col = t->current_col;
-        t->current_char += 5;
-        t->current_col += 5;
-        return 0;  // Success
+    size_t length = json_literal_length(t->current_char, t->end);
+    if (length == 0) {
+        return 1;  // Error
     }
-    return 1;  // Error
+    t->current_token.type = type;
+    t->current_char += length;
+    return 0;  // Success
 }
 
-int json_tokenize_null(JSONTokenizer *t) {
-    if (!t || !t->current_char) {
-        return 1;  // Error
-    }
+int json_tokenize_true(JSONTokenizer *t) {
+    return json_tokenize_literal(t, 't', TRUE);
+}
 
-    if (strncmp(t->current_char, "null", 4) == 0) {
-        t->current_token.type = NULL_TOKEN;
-        t->current_token.line = t->current_line;
-        t->current_token.col = t->current_col;
-        t->current_char += 4;
-        t->current_col += 4;
-        return 0;  // Success
-    }
-    return 1;  // Error
+int json_tokenize_false(JSONTokenizer *t) {
+    return json_tokenize_literal(t, 'f', FALSE);
+}
+
+int json_tokenize_null(JSONTokenizer *t) {
+    return json_tokenize_literal(t, 'n', NULL_TOKEN);
 }
 
 int json_tokenize_number(Arena *a, JSONTokenizer *t) {
@@ -351,95 +570,46 @@ int json_tokenize_number(Arena *a, JSONTokenizer *t) {
         return 1;  // Error
     }
 
-    t->current_token.line = t->current_line;
-    t->current_token.col = t->current_col;
+    t->current_token.offset = t->current_char - t->content;
 
-    // Check for negative sign
-    bool negative = false;
+    JSONNumber number;
     size_t literal_len = 0;
-
-    if (t->current_char[literal_len] == '-') {
-        negative = true;
-        ++literal_len;
-    }
-
-    // Count digits before decimal point
-    while (t->current_char[literal_len] != '\0' &&
-           is_digit(t->current_char[literal_len])) {
-        ++literal_len;
-    }
-
-    // Check if we have a decimal point
-    bool is_float = false;
-    if (t->current_char[literal_len] == '.') {
-        is_float = true;
-        ++literal_len;
-
-        // Count digits after decimal point
-        while (t->current_char[literal_len] != '\0' &&
-               is_digit(t->current_char[literal_len])) {
-            ++literal_len;
-        }
-    }
-
-    // Check for at least one digit
-    if ((literal_len == 0) || (literal_len == 1 && negative)) {
-        return 1;  // Error - not a number
-    }
-
-    // Allocate memory for the number string
-    char *literal = arena_alloc(a, sizeof(char) * (literal_len + 1));
-    if (!literal) {
-        return 1;  // Memory allocation error
-    }
-
-    memcpy(literal, t->current_char, literal_len);
-    literal[literal_len] = '\0';
-
-    t->current_char += literal_len;
-    t->current_col += literal_len;
-
-    if (is_float) {
-        // Convert to float and check errors
-        char *endptr;
-        errno = 0;
-        long double value = strtold(literal, &endptr);
-
-        if (errno == ERANGE) {
-            fprintf(stderr, "Line %zu, Col %zu: Float number out of range\n",
-                    t->current_token.line, t->current_token.col);
+    switch (json_number_parse(t->current_char, t->end, &number, &literal_len)) {
+        case JSON_NUMBER_OK:
+            break;
+        case JSON_NUMBER_INVALID:
             return 1;  // Error
-        }
-
-        if (*endptr != '\0') {
-            fprintf(stderr, "Line %zu, Col %zu: Invalid float format\n",
-                    t->current_token.line, t->current_token.col);
+        case JSON_NUMBER_RANGE:
+            // Only a double overflows, the digits are fine as they are
+            if (t->raw_numbers) break;
             return 1;  // Error
-        }
+    }
 
+    if (t->raw_numbers) {
+        t->current_token.type = NUMBER_RAW;
+        t->current_token.value.string =
+            (JSONString){.data = t->current_char, .length = literal_len};
+        if (!t->borrow) {
+            char *digits = arena_alloc_aligned(a, literal_len + 1, 1);
+            if (!digits) {
+                return json_tokenizer_fail(t, JSON_ERROR_MEMORY);
+            }
+            memcpy(digits, t->current_char, literal_len);
+            digits[literal_len] = '\0';
+            t->current_token.value.string.data = digits;
+        }
+    } else if (number.is_float) {
         t->current_token.type = NUMBER_FLOAT;
-        t->current_token.value.number_float = value;
+        t->current_token.value.number_float = number.value.number_float;
+    } else if (number.is_unsigned) {
+        t->current_token.type = NUMBER_UINT;
+        t->current_token.value.number_uint = number.value.number_uint;
     } else {
-        // Convert to integer and check errors
-        char *endptr;
-        errno = 0;
-        long long value = strtoll(literal, &endptr, 10);
-
-        if (errno == ERANGE) {
-            fprintf(stderr, "Line %zu, Col %zu: Integer number out of range\n",
-                    t->current_token.line, t->current_token.col);
-            return 1;  // Error
-        }
-
-        if (*endptr != '\0') {
-            fprintf(stderr, "Line %zu, Col %zu: Invalid integer format\n",
-                    t->current_token.line, t->current_token.col);
-            return 1;  // Error
-        }
-
         t->current_token.type = NUMBER_INT;
-        t->current_token.value.number_int = value;
+        t->current_token.value.number_int = number.value.number_int;
     }
 
+    t->current_char += literal_len;
+
     return 0;  // Success
-}
\ No newline at end of file
+}
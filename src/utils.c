@@ -1,25 +1,174 @@
+// mmap, posix_madvise and fileno are POSIX
+#define _XOPEN_SOURCE 700
+
 #include "../include/utils.h"
 
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef JSON_STATS
+#include "../include/stats.h"
+#endif
+
+#define READ_CHUNK (1 << 16)
+
+// Reads until EOF rather than trusting the size reported up front, so short
+// reads are retried and pipes or special files work too
+static char *read_stream(FILE *file, size_t size_hint, size_t *size) {
+    size_t capacity = size_hint + 1 > READ_CHUNK ? size_hint + 1 : READ_CHUNK;
+    size_t length = 0;
+    char *content = malloc(capacity);
+    if (content == NULL) {
+        return NULL;
+    }
+
+    while (true) {
+        if (length + 1 == capacity) {
+            capacity *= 2;
+            char *grown = realloc(content, capacity);
+            if (grown == NULL) {
+                free(content);
+                return NULL;
+            }
+            content = grown;
+        }
+
+        size_t n = fread(content + length, 1, capacity - length - 1, file);
+        length += n;
+        if (n == 0) break;
+    }
+
+    if (ferror(file)) {
+        free(content);
+        return NULL;
+    }
+
+    content[length] = '\0';
+    *size = length;
+    return content;
+}
+
 char *read_file_content(const char *file_name) {
     FILE *file = fopen(file_name, "r");
     if (file == NULL) {
         return NULL;
     }
 
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    fseek(file, 0, SEEK_SET);
+    struct stat st;
+    size_t size_hint = 0;
+    if (fstat(fileno(file), &st) == 0 && S_ISREG(st.st_mode)) {
+        size_hint = st.st_size;
+    }
 
-    char *file_content = calloc(1, file_size + 1);
-    fread(file_content, 1, file_size, file);
-    file_content[file_size] = '\0';
+    size_t size = 0;
+    char *file_content = read_stream(file, size_hint, &size);
 
     fclose(file);
     return file_content;
 }
 
+int map_file_content(const char *file_name, FileContent *file) {
+    *file = (FileContent){0};
+
+    int fd = open(file_name, O_RDONLY);
+    if (fd < 0) {
+        return 1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return 1;
+    }
+
+    if (S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            // Pages are only read once, front to back
+            posix_madvise(data, st.st_size, POSIX_MADV_SEQUENTIAL);
+            close(fd);
+            *file = (FileContent){
+                .data = data, .size = st.st_size, .mapped = true};
+            return 0;
+        }
+    }
+
+    // Pipes, character devices and empty files can't be mapped
+    FILE *stream = fdopen(fd, "r");
+    if (stream == NULL) {
+        close(fd);
+        return 1;
+    }
+
+    size_t size_hint = S_ISREG(st.st_mode) ? (size_t)st.st_size : 0;
+    file->data = read_stream(stream, size_hint, &file->size);
+    fclose(stream);
+    return file->data == NULL;
+}
+
+void unmap_file_content(FileContent *file) {
+    if (file->mapped) {
+        munmap(file->data, file->size);
+    } else {
+        free(file->data);
+    }
+    *file = (FileContent){0};
+}
+
+size_t thread_count(size_t threads) {
+    if (threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (size_t)online : 1;
+    }
+    return threads;
+}
+
+void run_threads(void *(*work)(void *), void *args, size_t count,
+                 size_t size) {
+    pthread_t *ids = count > 1 ? calloc(count, sizeof(pthread_t)) : NULL;
+    bool *started = count > 1 ? calloc(count, sizeof(bool)) : NULL;
+
+    for (size_t i = 1; ids != NULL && started != NULL && i < count; i++) {
+        started[i] = pthread_create(&ids[i], NULL, work,
+                                    (char *)args + i * size) == 0;
+    }
+
+    work(args);
+
+    for (size_t i = 1; ids != NULL && started != NULL && i < count; i++) {
+        if (started[i]) {
+            pthread_join(ids[i], NULL);
+        }
+    }
+    free(ids);
+    free(started);
+}
+
 bool is_whitespace(char c) {
     return c == ' ' || c == '\t' || c == '\n' || c == '\r';
 }
 
-bool is_digit(char c) { return c >= '0' && c <= '9'; }
\ No newline at end of file
+bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+size_t hash_bytes(const char *data, size_t length) {
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return (size_t)hash;
+}
+
+#ifdef JSON_STATS
+uint64_t json_stats_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+#endif
@@ -0,0 +1,198 @@
+#include "validate.h"
+
+#include <stdbool.h>
+
+#include "grammar.h"
+#include "number.h"
+#include "scan.h"
+#include "utils.h"
+
+typedef struct {
+    const char *buf;
+    const char *end;
+    JSONError *error;
+} JSONValidator;
+
+static int json_validate_fail(const JSONValidator *v, JSONErrorCode code,
+                              const char *at) {
+    json_error_set(v->error, code, v->buf, at - v->buf);
+    return 1;
+}
+
+static int json_validate_unexpected(const JSONValidator *v, const char *at,
+                                    const JSONGrammar *g) {
+    const char *got = json_token_name_at(at, v->end);
+    if (got == NULL) {
+        // Not the start of any token, as the tokenizer reports it
+        return json_validate_fail(v, JSON_ERROR_LITERAL, at);
+    }
+    json_validate_fail(v, JSON_ERROR_SYNTAX, at);
+    v->error->expected = json_grammar_expected(g);
+    v->error->got = got;
+    return 1;
+}
+
+// Checks the escape sequence at p as the tokenizer decodes it, returns the
+// byte after it or NULL
+static const char *json_validate_escape(const JSONValidator *v,
+                                        const char *p) {
+    char decoded[4];
+    size_t used;
+    // The tokenizer also takes \' for its single-quoted strings
+    if (v->end - p >= 2 && p[1] != '\'' &&
+        json_decode_escape(p + 1, v->end, decoded, &used) != 0) {
+        return p + 1 + used;
+    }
+    json_validate_fail(v, JSON_ERROR_STRING, p);
+    return NULL;
+}
+
+// Checks the UTF-8 sequence at p, returns the byte after it or NULL.
+// Overlong forms, surrogates and code points past U+10FFFF are rejected,
+// following table 3-7 of the Unicode standard.
+static const char *json_validate_utf8(const JSONValidator *v,
+                                      const char *p) {
+    const unsigned char *s = (const unsigned char *)p;
+    unsigned char lead = s[0];
+    // Range of the second byte, the others are always 0x80 to 0xbf
+    unsigned char low = 0x80;
+    unsigned char high = 0xbf;
+    size_t length;
+
+    if (lead >= 0xc2 && lead <= 0xdf) {
+        length = 2;
+    } else if (lead >= 0xe0 && lead <= 0xef) {
+        length = 3;
+        if (lead == 0xe0) low = 0xa0;
+        if (lead == 0xed) high = 0x9f;
+    } else if (lead >= 0xf0 && lead <= 0xf4) {
+        length = 4;
+        if (lead == 0xf0) low = 0x90;
+        if (lead == 0xf4) high = 0x8f;
+    } else {
+        json_validate_fail(v, JSON_ERROR_STRING, p);
+        return NULL;
+    }
+
+    if ((size_t)(v->end - p) < length || s[1] < low || s[1] > high) {
+        json_validate_fail(v, JSON_ERROR_STRING, p);
+        return NULL;
+    }
+    for (size_t i = 2; i < length; i++) {
+        if ((s[i] & 0xc0) != 0x80) {
+            json_validate_fail(v, JSON_ERROR_STRING, p + i);
+            return NULL;
+        }
+    }
+    return p + length;
+}
+
+// Checks the string whose opening quote is at p, returns the byte after its
+// closing quote or NULL
+static const char *json_validate_string(const JSONValidator *v,
+                                        const char *p) {
+    const char *open = p++;
+    while (true) {
+        // Printable ASCII is skipped a block at a time
+        p = json_scan_string_ascii(p, v->end);
+        if (p == v->end) {
+            json_validate_fail(v, JSON_ERROR_STRING, open);
+            return NULL;
+        }
+
+        unsigned char c = *p;
+        if (c == '"') {
+            return p + 1;
+        } else if (c == '\\') {
+            p = json_validate_escape(v, p);
+        } else if (c < 0x20) {
+            json_validate_fail(v, JSON_ERROR_STRING, p);
+            return NULL;
+        } else {
+            p = json_validate_utf8(v, p);
+        }
+
+        if (p == NULL) {
+            return NULL;
+        }
+    }
+}
+
+// Checks the string, number or literal at p, returns the byte after it or
+// NULL
+static const char *json_validate_scalar(const JSONValidator *v,
+                                        const char *p) {
+    if (*p == '"') {
+        return json_validate_string(v, p);
+    }
+    if (*p == '-' || is_digit(*p)) {
+        size_t length = json_number_length(p, v->end);
+        if (length != 0) return p + length;
+        json_validate_fail(v, JSON_ERROR_NUMBER, p);
+        return NULL;
+    }
+
+    size_t length = json_literal_length(p, v->end);
+    if (length != 0) return p + length;
+    json_validate_fail(v, JSON_ERROR_LITERAL, p);
+    return NULL;
+}
+
+// Most tokens follow the last without whitespace, or after a single space
+static const char *json_validate_skip(const char *p, const char *end) {
+    if (p < end && (unsigned char)*p > ' ') {
+        return p;
+    }
+    if (end - p >= 2 && *p == ' ' && (unsigned char)p[1] > ' ') {
+        return p + 1;
+    }
+    return json_skip_whitespace(p, end);
+}
+
+int json_validate_depth(const char *buf, size_t len, size_t max_depth,
+                        JSONError *error) {
+    *error = (JSONError){0};
+    if (buf == NULL) {
+        json_error_set(error, JSON_ERROR_ARGUMENT, NULL, 0);
+        return 1;
+    }
+
+    JSONValidator v = {.buf = buf, .end = buf + len, .error = error};
+    JSONGrammar g;
+    json_grammar_init(&g, max_depth);
+
+    const char *p = json_validate_skip(buf, v.end);
+    while (p < v.end) {
+        switch (json_grammar_step(&g, *p)) {
+            case JSON_GRAMMAR_PUNCT:
+            case JSON_GRAMMAR_OPEN:
+            case JSON_GRAMMAR_CLOSE:
+                ++p;
+                break;
+            case JSON_GRAMMAR_KEY:
+                p = json_validate_string(&v, p);
+                break;
+            case JSON_GRAMMAR_VALUE:
+                p = json_validate_scalar(&v, p);
+                break;
+            case JSON_GRAMMAR_DEPTH:
+                return json_validate_fail(&v, JSON_ERROR_DEPTH, p);
+            case JSON_GRAMMAR_UNEXPECTED:
+                return json_validate_unexpected(&v, p, &g);
+        }
+
+        if (p == NULL) {
+            return 1;
+        }
+        p = json_validate_skip(p, v.end);
+    }
+
+    if (!json_grammar_done(&g)) {
+        return json_validate_unexpected(&v, p, &g);
+    }
+    return 0;
+}
+
+int json_validate(const char *buf, size_t len, JSONError *error) {
+    return json_validate_depth(buf, len, JSON_MAX_DEPTH, error);
+}
@@ -0,0 +1,400 @@
+#include "writer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef JSON_STATS
+#include "stats.h"
+#endif
+
+static int json_write_file(void *context, const char *data, size_t length) {
+    FILE *file = context;
+    return fwrite(data, 1, length, file) != length;
+}
+
+JSONWriter json_writer_buffer(JSONWriteStyle style) {
+    return (JSONWriter){.style = style, .indent = 2};
+}
+
+JSONWriter json_writer_file(FILE *file, JSONWriteStyle style) {
+    return json_writer_callback(json_write_file, file, style);
+}
+
+JSONWriter json_writer_callback(JSONWriteFn write, void *context,
+                                JSONWriteStyle style) {
+    return (JSONWriter){
+        .style = style, .indent = 2, .write = write, .context = context};
+}
+
+int json_writer_flush(JSONWriter *w) {
+    if (w->write == NULL || w->size == 0 || w->error) {
+        return w->error;
+    }
+
+    if (w->write(w->context, w->buffer, w->size)) {
+        w->error = 1;
+    }
+    w->size = 0;
+    return w->error;
+}
+
+void json_writer_free(JSONWriter *w) {
+    free(w->buffer);
+    w->buffer = NULL;
+    w->size = 0;
+    w->capacity = 0;
+}
+
+static int json_writer_reserve(JSONWriter *w, size_t length) {
+    if (w->size + length <= w->capacity) {
+        return 0;
+    }
+
+    if (w->write != NULL) {
+        // Streaming, make room by handing the pending bytes to the sink
+        if (json_writer_flush(w)) return 1;
+        if (length <= w->capacity) return 0;
+    }
+
+    size_t capacity = w->capacity ? w->capacity : JSON_WRITER_CHUNK;
+    while (capacity < w->size + length) {
+        capacity *= 2;
+    }
+
+    char *buffer = realloc(w->buffer, capacity);
+    if (buffer == NULL) {
+        w->error = 1;
+        return 1;
+    }
+
+    w->buffer = buffer;
+    w->capacity = capacity;
+    return 0;
+}
+
+static void json_writer_put(JSONWriter *w, const char *data, size_t length) {
+    if (length == 0 || w->error || json_writer_reserve(w, length)) return;
+    memcpy(w->buffer + w->size, data, length);
+    w->size += length;
+}
+
+static void json_writer_putc(JSONWriter *w, char c) {
+    if (w->error || json_writer_reserve(w, 1)) return;
+    w->buffer[w->size++] = c;
+}
+
+static void json_write_newline(JSONWriter *w) {
+    if (w->style != JSON_STYLE_PRETTY) return;
+
+    size_t width = w->depth * w->indent;
+    if (w->error || json_writer_reserve(w, width + 1)) return;
+    w->buffer[w->size++] = '\n';
+    memset(w->buffer + w->size, ' ', width);
+    w->size += width;
+}
+
+static void json_write_separator(JSONWriter *w) {
+    switch (w->style) {
+        case JSON_STYLE_INLINE:
+            json_writer_put(w, ", ", 2);
+            break;
+        case JSON_STYLE_COMPACT:
+            json_writer_putc(w, ',');
+            break;
+        case JSON_STYLE_PRETTY:
+            json_writer_putc(w, ',');
+            json_write_newline(w);
+            break;
+    }
+}
+
+static void json_write_quoted(JSONWriter *w, JSONString string) {
+    static const char hex[] = "0123456789abcdef";
+
+    json_writer_putc(w, '"');
+
+    // Copy runs of plain characters in one go, only escapes are split out
+    const char *run = string.data;
+    const char *end = string.data + string.length;
+    for (const char *c = run; c < end; ++c) {
+        unsigned char ch = (unsigned char)*c;
+        if (ch >= 0x20 && ch != '"' && ch != '\\') continue;
+
+        json_writer_put(w, run, c - run);
+        run = c + 1;
+
+        switch (ch) {
+            case '"':
+                json_writer_put(w, "\\\"", 2);
+                break;
+            case '\\':
+                json_writer_put(w, "\\\\", 2);
+                break;
+            case '\n':
+                json_writer_put(w, "\\n", 2);
+                break;
+            case '\t':
+                json_writer_put(w, "\\t", 2);
+                break;
+            case '\r':
+                json_writer_put(w, "\\r", 2);
+                break;
+            default: {
+                char escape[6] = {'\\', 'u', '0', '0', hex[ch >> 4],
+                                  hex[ch & 0xf]};
+                json_writer_put(w, escape, sizeof(escape));
+            }
+        }
+    }
+    json_writer_put(w, run, end - run);
+
+    json_writer_putc(w, '"');
+}
+
+// Writes what goes before a value: nothing after a key or at the root, a
+// line break before the first value of a container, a separator otherwise
+static void json_write_begin(JSONWriter *w) {
+    if (w->key) {
+        w->key = false;
+        return;
+    }
+    if (w->depth == 0) return;
+
+    if (w->first) {
+        json_write_newline(w);
+    } else {
+        json_write_separator(w);
+    }
+    w->first = false;
+}
+
+static void json_write_open(JSONWriter *w, char open) {
+    json_write_begin(w);
+    json_writer_putc(w, open);
+    ++w->depth;
+    w->first = true;
+}
+
+static void json_write_close(JSONWriter *w, char close) {
+    --w->depth;
+    if (!w->first) {
+        json_write_newline(w);
+    }
+    json_writer_putc(w, close);
+    w->first = false;
+}
+
+void json_write_object_start(JSONWriter *w) { json_write_open(w, '{'); }
+
+void json_write_object_end(JSONWriter *w) { json_write_close(w, '}'); }
+
+void json_write_array_start(JSONWriter *w) { json_write_open(w, '['); }
+
+void json_write_array_end(JSONWriter *w) { json_write_close(w, ']'); }
+
+void json_write_key(JSONWriter *w, JSONString key) {
+    json_write_begin(w);
+    json_write_quoted(w, key);
+    if (w->style == JSON_STYLE_COMPACT) {
+        json_writer_putc(w, ':');
+    } else {
+        json_writer_put(w, ": ", 2);
+    }
+    w->key = true;
+}
+
+void json_write_string(JSONWriter *w, JSONString value) {
+    json_write_begin(w);
+    json_write_quoted(w, value);
+}
+
+void json_write_int(JSONWriter *w, long long value) {
+    char number[32];
+    int length = snprintf(number, sizeof(number), "%lld", value);
+    json_write_begin(w);
+    json_writer_put(w, number, length);
+}
+
+void json_write_uint(JSONWriter *w, unsigned long long value) {
+    char number[32];
+    int length = snprintf(number, sizeof(number), "%llu", value);
+    json_write_begin(w);
+    json_writer_put(w, number, length);
+}
+
+// The shortest of 15 to 17 significant digits that reads back as value,
+// always with a point or exponent so it stays a float
+static int json_format_exact(char *number, size_t size, double value) {
+    int length = 0;
+    for (int precision = 15; precision <= 17; precision++) {
+        length = snprintf(number, size, "%.*g", precision, value);
+        if (strtod(number, NULL) == value) break;
+    }
+    if (strpbrk(number, ".eE") == NULL) {
+        length += snprintf(number + length, size - length, ".0");
+    }
+    return length;
+}
+
+void json_write_float(JSONWriter *w, double value) {
+    if (!isfinite(value)) {
+        // JSON has no way to write NaN or infinity
+        w->error = 1;
+        return;
+    }
+
+    char number[64];
+    int length;
+    if (w->exact) {
+        length = json_format_exact(number, sizeof(number), value);
+    } else {
+        length = snprintf(number, sizeof(number), "%f", value);
+        if (length >= (int)sizeof(number)) {
+            // Huge magnitudes don't fit the fixed notation buffer
+            length = snprintf(number, sizeof(number), "%g", value);
+        }
+    }
+    json_write_begin(w);
+    json_writer_put(w, number, length);
+}
+
+void json_write_number(JSONWriter *w, JSONString digits) {
+    json_write_begin(w);
+    json_writer_put(w, digits.data, digits.length);
+}
+
+void json_write_bool(JSONWriter *w, bool value) {
+    json_write_begin(w);
+    if (value) {
+        json_writer_put(w, "true", 4);
+    } else {
+        json_writer_put(w, "false", 5);
+    }
+}
+
+void json_write_null(JSONWriter *w) {
+    json_write_begin(w);
+    json_writer_put(w, "null", 4);
+}
+
+static void json_write_value(JSONWriter *w, JSONValue value) {
+    switch (value.type) {
+        case JSON_VALUE_STRING:
+            json_write_string(w, value.value.string);
+            break;
+        case JSON_VALUE_NUMBER_INT:
+            json_write_int(w, value.value.number_int);
+            break;
+        case JSON_VALUE_NUMBER_UINT:
+            json_write_uint(w, value.value.number_uint);
+            break;
+        case JSON_VALUE_NUMBER_FLOAT:
+            json_write_float(w, value.value.number_float);
+            break;
+        case JSON_VALUE_NUMBER_RAW:
+            json_write_number(w, value.value.string);
+            break;
+        case JSON_VALUE_BOOLEAN:
+            json_write_bool(w, value.value.boolean);
+            break;
+        case JSON_VALUE_NULL:
+            json_write_null(w);
+            break;
+    }
+}
+
+static void json_write_element(JSONWriter *w, JSONElement element) {
+    switch (element.type) {
+        case JSON_ELEMENT_OBJECT:
+            json_write_object_start(w);
+            for_each_pair(element.element.object, pair) {
+                json_write_key(w, pair->key);
+                json_write_element(w, pair->value);
+            }
+            json_write_object_end(w);
+            break;
+        case JSON_ELEMENT_ARRAY:
+            json_write_array_start(w);
+            for_each_element(element.element.array, item) {
+                json_write_element(w, item->element);
+            }
+            json_write_array_end(w);
+            break;
+        case JSON_ELEMENT_VALUE:
+            json_write_value(w, element.element.value);
+            break;
+        case JSON_ELEMENT_END:
+            break;
+    }
+}
+
+int json_write(JSONWriter *w, JSONElement element) {
+    json_write_element(w, element);
+    if (w->write != NULL) {
+        json_writer_flush(w);
+    }
+    return w->error;
+}
+
+char *json_stringify(Arena *a, JSONElement element) {
+    JSONWriter w = json_writer_buffer(JSON_STYLE_INLINE);
+
+    if (json_write(&w, element)) {
+        json_writer_free(&w);
+        return NULL;
+    }
+
+    char *result = arena_alloc(a, w.size + 1);
+    if (result != NULL) {
+        if (w.size > 0) memcpy(result, w.buffer, w.size);
+        result[w.size] = '\0';
+    }
+
+    json_writer_free(&w);
+    return result;
+}
+
+#ifdef JSON_STATS
+static void json_write_count(JSONWriter *w, const char *key,
+                             unsigned long long value) {
+    json_write_key(w, (JSONString){key, strlen(key)});
+    json_write_uint(w, value);
+}
+
+int json_stats_write(JSONWriter *w, const JSONStats *stats) {
+    static const char *phases[] = {"tokenize", "number", "unescape",
+                                   "build", "arena"};
+
+    json_write_object_start(w);
+    json_write_count(w, "bytes", stats->bytes);
+    json_write_count(w, "nanoseconds", stats->total_nanoseconds);
+
+    json_write_key(w, (JSONString){"phases", 6});
+    json_write_object_start(w);
+    for (size_t i = 0; i < JSON_STATS_PHASES; i++) {
+        json_write_count(w, phases[i], stats->nanoseconds[i]);
+    }
+    json_write_object_end(w);
+
+    // Keyed by token_names, e.g. "{" or "string"
+    json_write_key(w, (JSONString){"tokens", 6});
+    json_write_object_start(w);
+    for (size_t i = 0; i <= END; i++) {
+        json_write_count(w, token_names[i], stats->tokens[i]);
+    }
+    json_write_object_end(w);
+
+    json_write_count(w, "bytes_unescaped", stats->bytes_unescaped);
+    json_write_count(w, "regions", stats->regions);
+    json_write_count(w, "max_depth", stats->max_depth);
+    json_write_count(w, "largest_string", stats->largest_string);
+    json_write_object_end(w);
+
+    if (w->write != NULL) {
+        json_writer_flush(w);
+    }
+    return w->error;
+}
+#endif
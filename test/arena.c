@@ -0,0 +1,139 @@
+/*
+    Arena rewind test: malformed documents, each file cut short at every
+    byte plus a few fixed ones, are parsed over and over into one
+    long-lived arena. A rejected parse must leave nothing behind, so the
+    arena may not grow after the first round.
+
+    Usage: ./arena <file>...
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/parser.h"
+#include "../include/utils.h"
+
+#define ROUNDS 100
+
+static const char *malformed[] = {
+    "[1, 2,",       "{\"a\": }",      "[\"abc",       "{\"a\" 1}",
+    "[1, 2]]",      "[tru]",          "[1.e5]",       "{\"a\": [1, {",
+    "\"unterminated", "[01]",
+};
+#define MALFORMED (sizeof(malformed) / sizeof(malformed[0]))
+
+// Parses every malformed document once with each entry point. Returns
+// non-zero if one of them was accepted or left bytes in the arena.
+static int parse_round(Arena *a, char **files, size_t *sizes, size_t count) {
+    JSONError error;
+    char copy[64];
+
+    for (size_t i = 0; i < MALFORMED; i++) {
+        size_t len = strlen(malformed[i]);
+        json_parse_buffer(a, malformed[i], len, &error);
+        if (!error.code || a->used != 0) return 1;
+
+        strcpy(copy, malformed[i]);
+        json_parse(a, copy, &error);
+        if (!error.code || a->used != 0) return 1;
+
+        strcpy(copy, malformed[i]);
+        json_parse_tokenized(a, copy, &error);
+        if (!error.code || a->used != 0) return 1;
+    }
+
+    // Every proper prefix of a document whose root is a container is
+    // malformed
+    for (size_t f = 0; f < count; f++) {
+        for (size_t len = 0; len < sizes[f]; len++) {
+            json_parse_buffer(a, files[f], len, &error);
+            if (!error.code || a->used != 0) return 1;
+        }
+    }
+    return 0;
+}
+
+// An oversized allocation gets a region of its own, the next region grown
+// has to double the one before it rather than the oversized one
+static int test_growth(void) {
+    Arena a = {0};
+    arena_alloc(&a, REGION_CAPACITY / 2);
+    arena_alloc(&a, REGION_CAPACITY * 8);
+    size_t oversized = a.last->capacity;
+    arena_alloc(&a, REGION_CAPACITY);
+    size_t grown = a.last->capacity;
+    arena_free(&a);
+
+    if (oversized <= REGION_CAPACITY * 8 || grown != REGION_CAPACITY * 2) {
+        printf("regions grew to %zu then %zu bytes\n", oversized, grown);
+        return 1;
+    }
+    return 0;
+}
+
+// Freeing an arena keeps the alignment it was set up with
+static int test_free(void) {
+    Arena a = {.alignment = 64};
+    arena_alloc(&a, 1);
+    arena_free(&a);
+    arena_alloc(&a, 1);
+    char *p = arena_alloc(&a, 1);
+    arena_free(&a);
+
+    if (a.alignment != 64 || (uintptr_t)p % 64 != 0) {
+        printf("alignment lost when the arena was freed\n");
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    size_t count = argc - 1;
+    char **files = calloc(count ? count : 1, sizeof(char *));
+    size_t *sizes = calloc(count ? count : 1, sizeof(size_t));
+    for (size_t f = 0; f < count; f++) {
+        files[f] = read_file_content(argv[f + 1]);
+        if (files[f] == NULL) {
+            printf("%s: failed to read\n", argv[f + 1]);
+            return 1;
+        }
+        // Trailing whitespace would make the shorter prefixes valid
+        sizes[f] = strlen(files[f]);
+        while (sizes[f] > 0 && is_whitespace(files[f][sizes[f] - 1])) {
+            --sizes[f];
+        }
+    }
+
+    int grew = test_growth() | test_free();
+
+    Arena a = {0};
+    int failed = parse_round(&a, files, sizes, count);
+
+    ArenaStats first;
+    arena_stats(&a, &first);
+    for (int round = 1; !failed && round < ROUNDS; round++) {
+        failed = parse_round(&a, files, sizes, count);
+    }
+
+    ArenaStats last;
+    arena_stats(&a, &last);
+    if (failed) {
+        printf("a malformed document was accepted or left bytes behind\n");
+    } else if (last.reserved != first.reserved) {
+        printf("arena grew from %zu to %zu bytes over %d rounds\n",
+               first.reserved, last.reserved, ROUNDS);
+        failed = 1;
+    }
+
+    arena_free(&a);
+    for (size_t f = 0; f < count; f++) {
+        free(files[f]);
+    }
+    free(files);
+    free(sizes);
+    failed |= grew;
+    printf("arena: %s\n", failed ? "FAILED" : "ok");
+    return failed;
+}
@@ -0,0 +1,227 @@
+/*
+    Binary document test: each file is parsed, encoded, opened and written
+    back, which has to give what json_stringify gives for the parsed tree.
+    Headers that are cut short or don't match are refused, and
+    json_binary_verify has to refuse broken offsets and counts and leave
+    nothing it accepts that can't be written back.
+
+    Usage: ./binary <file>...
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/binary.h"
+#include "../include/parser.h"
+#include "../include/utils.h"
+#include "../include/writer.h"
+
+// Opens, verifies and writes the document back, NULL if any of it fails
+static char *binary_stringify(Arena *a, const char *data, size_t size,
+                              JSONError *error) {
+    JSONBinary doc;
+    if (json_binary_open(&doc, data, size, error) ||
+        json_binary_verify(&doc, error)) {
+        return NULL;
+    }
+
+    JSONWriter w = json_writer_buffer(JSON_STYLE_INLINE);
+    char *result = NULL;
+    if (json_binary_write(&w, json_binary_root(&doc)) == 0) {
+        result = arena_alloc(a, w.size + 1);
+        if (result != NULL) {
+            memcpy(result, w.buffer, w.size);
+            result[w.size] = '\0';
+        }
+    }
+    json_writer_free(&w);
+    json_binary_close(&doc);
+    return result;
+}
+
+static char *encode(const char *json, size_t *size) {
+    Arena a = {0};
+    JSONError error;
+    char *data = NULL;
+    JSONElement root = json_parse_buffer(&a, json, strlen(json), &error);
+    if (error.code || json_binary_encode(root, &data, size, &error)) {
+        data = NULL;
+    }
+    arena_free(&a);
+    return data;
+}
+
+static int expect_binary(const char *what, JSONError *error, int result) {
+    if (!result || error->code != JSON_ERROR_BINARY) {
+        printf("%s: not refused\n", what);
+        return 1;
+    }
+    return 0;
+}
+
+static int test_header(void) {
+    size_t size;
+    char *data = encode("[1, \"a\"]", &size);
+    if (data == NULL) {
+        printf("header: failed to encode\n");
+        return 1;
+    }
+
+    int failed = 0;
+    JSONBinary doc;
+    JSONError error;
+    JSONBinaryHeader *h = (JSONBinaryHeader *)data;
+
+    failed |= expect_binary(
+        "short header", &error,
+        json_binary_open(&doc, data, sizeof(JSONBinaryHeader) - 1, &error));
+    failed |= expect_binary(
+        "short document", &error,
+        json_binary_open(&doc, data, size - 1, &error));
+
+    uint64_t real_size = h->size;
+    h->size = sizeof(JSONBinaryHeader) - 1;
+    failed |= expect_binary("size inside the header", &error,
+                            json_binary_open(&doc, data, size, &error));
+    h->size = real_size;
+
+    h->version++;
+    failed |= expect_binary("other version", &error,
+                            json_binary_open(&doc, data, size, &error));
+    h->version--;
+
+    h->magic[0] ^= 1;
+    failed |= expect_binary("bad magic", &error,
+                            json_binary_open(&doc, data, size, &error));
+    h->magic[0] ^= 1;
+
+    if (json_binary_open(&doc, data, size, &error) ||
+        json_binary_verify(&doc, &error)) {
+        printf("header: intact document refused\n");
+        failed = 1;
+    }
+    free(data);
+    return failed;
+}
+
+// Breaks one node of a fresh copy of the document, which verify must refuse
+typedef enum {
+    BREAK_OFFSET_BACK,   // Children before their container
+    BREAK_OFFSET_OUT,    // Children past the end
+    BREAK_COUNT,         // More pairs than the block holds
+    BREAK_KEY_TYPE,      // A key that isn't a string
+    BREAK_STRING_LONG,   // String running past its NUL
+    BREAK_NUMBER,        // Raw digits that aren't a number
+    BREAK_TYPE,          // No such node type
+    BREAK_COUNT_OF_CASES,
+} Break;
+
+static int test_verify(void) {
+    int failed = 0;
+    for (int b = 0; b < BREAK_COUNT_OF_CASES; b++) {
+        Arena a = {0};
+        JSONError error;
+        const char *json = "{\"a\": [1, \"xy\"], \"b\": 2.50}";
+        JSONElement root = json_parse_exact(&a, json, strlen(json), &error);
+        char *data;
+        size_t size;
+        if (error.code || json_binary_encode(root, &data, &size, &error)) {
+            printf("verify: failed to encode\n");
+            arena_free(&a);
+            return 1;
+        }
+        arena_free(&a);
+
+        JSONBinaryHeader *h = (JSONBinaryHeader *)data;
+        JSONBinaryNode *pairs =
+            (JSONBinaryNode *)json_binary_children(&h->root);
+        JSONBinaryNode *array =
+            (JSONBinaryNode *)json_binary_children(&pairs[1]);
+        switch ((Break)b) {
+            case BREAK_OFFSET_BACK:
+                pairs[1].value.offset = -(int64_t)sizeof(JSONBinaryNode);
+                break;
+            case BREAK_OFFSET_OUT:
+                h->root.value.offset = (int64_t)size;
+                break;
+            case BREAK_COUNT:
+                h->root.count++;
+                break;
+            case BREAK_KEY_TYPE:
+                pairs[2].type = JSON_BINARY_INT;
+                break;
+            case BREAK_STRING_LONG:
+                array[1].count++;
+                break;
+            case BREAK_NUMBER:
+                data[(char *)&pairs[3] - data + pairs[3].value.offset] = 'x';
+                break;
+            case BREAK_TYPE:
+                array[0].type = JSON_BINARY_NULL + 1;
+                break;
+            case BREAK_COUNT_OF_CASES:
+                break;
+        }
+
+        JSONBinary doc;
+        if (json_binary_open(&doc, data, size, &error) ||
+            !json_binary_verify(&doc, &error) ||
+            error.code != JSON_ERROR_BINARY) {
+            printf("verify: broken document %d not refused\n", b);
+            failed = 1;
+        }
+        free(data);
+    }
+    return failed;
+}
+
+static int test_file(const char *file_name) {
+    FileContent file;
+    if (map_file_content(file_name, &file)) {
+        printf("%s: failed to read\n", file_name);
+        return 1;
+    }
+
+    Arena a = {0};
+    JSONError error;
+    JSONElement root = json_parse_buffer(&a, file.data, file.size, &error);
+    char *data = NULL;
+    size_t size = 0;
+    int failed = 0;
+
+    char *text = error.code ? NULL : json_stringify(&a, root);
+    if (text == NULL || json_binary_encode(root, &data, &size, &error)) {
+        printf("%s: failed to parse or encode\n", file_name);
+        failed = 1;
+    } else {
+        char *written = binary_stringify(&a, data, size, &error);
+        if (written == NULL || strcmp(text, written) != 0) {
+            printf("%s: differs after a round trip\n", file_name);
+            failed = 1;
+        }
+    }
+
+    // Each byte flipped in turn: whatever verify lets through is written
+    // back without reading outside the document
+    for (size_t i = 0; i < size && !failed; i++) {
+        data[i] ^= 0xff;
+        binary_stringify(&a, data, size, &error);
+        data[i] ^= 0xff;
+        arena_reset(&a);
+    }
+
+    free(data);
+    arena_free(&a);
+    unmap_file_content(&file);
+    return failed;
+}
+
+int main(int argc, char *argv[]) {
+    int failed = test_header() | test_verify();
+    for (int i = 1; i < argc; i++) {
+        failed |= test_file(argv[i]);
+    }
+    printf("binary: %s\n", failed ? "FAILED" : "ok");
+    return failed;
+}
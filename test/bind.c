@@ -0,0 +1,203 @@
+/*
+    Struct binding test: an order with nested structs, arrays of structs and
+    of strings is decoded and encoded again, which has to give what
+    json_stringify gives for the tree json_parse_buffer builds. Values of
+    the wrong type have to be refused at the value, naming their field, and
+    the document cut short at every byte has to be refused like
+    json_parse_buffer refuses it.
+
+    Usage: ./bind <file>...
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../include/bind.h"
+#include "../include/parser.h"
+
+typedef struct {
+    JSONString city;
+    int zip;
+} Address;
+
+typedef struct {
+    JSONString name;
+    Address address;
+} Customer;
+
+typedef struct {
+    JSONString sku;
+    int qty;
+    double price;
+} Item;
+
+typedef struct {
+    long long id;
+    Customer customer;
+    Item *items;
+    size_t item_count;
+    JSONString *tags;
+    size_t tag_count;
+    bool paid;
+    double total;
+} Order;
+
+static const JSONField address_fields[] = {
+    JSON_BIND_FIELD(Address, city, JSON_FIELD_STRING),
+    JSON_BIND_FIELD(Address, zip, JSON_FIELD_INT),
+};
+static JSONStruct address_struct = JSON_BIND(Address, address_fields);
+
+static const JSONField customer_fields[] = {
+    JSON_BIND_FIELD(Customer, name, JSON_FIELD_STRING),
+    JSON_BIND_STRUCT(Customer, address, address_struct),
+};
+static JSONStruct customer_struct = JSON_BIND(Customer, customer_fields);
+
+static const JSONField item_fields[] = {
+    JSON_BIND_FIELD(Item, sku, JSON_FIELD_STRING),
+    JSON_BIND_FIELD(Item, qty, JSON_FIELD_INT),
+    JSON_BIND_FIELD(Item, price, JSON_FIELD_DOUBLE),
+};
+static JSONStruct item_struct = JSON_BIND(Item, item_fields);
+
+static const JSONField order_fields[] = {
+    JSON_BIND_FIELD(Order, id, JSON_FIELD_INT64),
+    JSON_BIND_STRUCT(Order, customer, customer_struct),
+    JSON_BIND_ARRAY(Order, items, item_count, JSON_FIELD_STRUCT,
+                    &item_struct),
+    JSON_BIND_ARRAY(Order, tags, tag_count, JSON_FIELD_STRING, NULL),
+    JSON_BIND_FIELD(Order, paid, JSON_FIELD_BOOL),
+    JSON_BIND_FIELD(Order, total, JSON_FIELD_DOUBLE),
+};
+static JSONStruct order_struct = JSON_BIND(Order, order_fields);
+
+// Every field in descriptor order, so encoding gives the same text back
+static const char *order =
+    "{\"id\": 9007199254740993, "
+    "\"customer\": {\"name\": \"Ada \\\"L\\\"\", "
+    "\"address\": {\"city\": \"London\", \"zip\": 1815}}, "
+    "\"items\": [{\"sku\": \"a-1\", \"qty\": 2, \"price\": 2.5}, "
+    "{\"sku\": \"b\\u00e9\", \"qty\": -1, \"price\": 0.125}], "
+    "\"tags\": [\"x\", \"\", \"y\"], \"paid\": true, \"total\": 4.875}";
+
+// The same order with keys the struct doesn't bind, nulls and reordering
+static const char *extra =
+    "{\"note\": {\"a\": [1, {\"b\": null}], \"c\": \"}\"}, "
+    "\"total\": 4.875, \"id\": 9007199254740993, \"paid\": true, "
+    "\"customer\": {\"address\": {\"zip\": 1815, \"city\": \"London\", "
+    "\"extra\": []}, \"name\": \"Ada \\\"L\\\"\"}, "
+    "\"items\": [{\"price\": 2.5, \"sku\": \"a-1\", \"qty\": 2}, "
+    "{\"qty\": -1, \"sku\": \"b\\u00e9\", \"price\": 0.125, \"x\": 1}], "
+    "\"tags\": [\"x\", \"\", \"y\"], \"more\": null}";
+
+typedef struct {
+    const char *json;
+    const char *field;
+    const char *value;  // Where the error is, found in json
+} WrongCase;
+
+static const WrongCase wrong[] = {
+    {"{\"customer\": {\"address\": {\"zip\": \"1815\"}}}", "zip", "\"1815"},
+    {"{\"customer\": {\"address\": {\"zip\": 3000000000}}}", "zip", "3000"},
+    {"{\"customer\": {\"address\": []}}", "address", "[]"},
+    {"{\"customer\": \"Ada\"}", "customer", "\"Ada"},
+    {"{\"items\": [{\"qty\": 1}, {\"qty\": 1.5}]}", "qty", "1.5"},
+    {"{\"items\": [{\"sku\": 7}]}", "sku", "7"},
+    {"{\"items\": [[]]}", "items", "[]]"},
+    {"{\"items\": {}}", "items", "{}"},
+    {"{\"tags\": [\"x\", 1]}", "tags", "1]"},
+    {"{\"paid\": 1}", "paid", "1"},
+    {"{\"id\": 1.0}", "id", "1.0"},
+    {"{\"total\": \"4\"}", "total", "\"4"},
+};
+#define WRONG (sizeof(wrong) / sizeof(wrong[0]))
+
+static char *encode(Arena *a, const Order *o) {
+    JSONWriter w = json_writer_buffer(JSON_STYLE_INLINE);
+    char *result = NULL;
+    json_encode(&w, &order_struct, o);
+    if (!w.error) {
+        result = arena_alloc(a, w.size + 1);
+        if (result != NULL) {
+            memcpy(result, w.buffer, w.size);
+            result[w.size] = '\0';
+        }
+    }
+    json_writer_free(&w);
+    return result;
+}
+
+static int test_decode(Arena *a) {
+    JSONError error;
+    char *want = json_stringify(
+        a, json_parse_buffer(a, order, strlen(order), &error));
+
+    int failed = 0;
+    const char *docs[] = {order, extra};
+    for (size_t i = 0; i < 2; i++) {
+        Order o;
+        char *got = NULL;
+        if (!json_decode(a, &order_struct, docs[i], strlen(docs[i]), &o,
+                         &error)) {
+            got = encode(a, &o);
+        }
+        if (want == NULL || got == NULL || strcmp(want, got) != 0) {
+            printf("%s: decoded wrong\n", docs[i]);
+            failed = 1;
+        }
+    }
+    return failed;
+}
+
+static int test_wrong(Arena *a) {
+    int failed = 0;
+    for (size_t i = 0; i < WRONG; i++) {
+        const WrongCase *c = &wrong[i];
+        size_t offset = strstr(c->json, c->value) - c->json;
+
+        JSONError parsed, error;
+        Order o;
+        json_parse_buffer(a, c->json, strlen(c->json), &parsed);
+        json_decode(a, &order_struct, c->json, strlen(c->json), &o, &error);
+        if (parsed.code != JSON_ERROR_NONE ||
+            error.code != JSON_ERROR_SYNTAX || error.offset != offset ||
+            error.field == NULL || strcmp(error.field, c->field) != 0) {
+            printf("%s: error %d at %zu for %s, not at %zu for %s\n",
+                   c->json, error.code, error.offset,
+                   error.field ? error.field : "nothing", offset, c->field);
+            failed = 1;
+        }
+    }
+    return failed;
+}
+
+static int test_cut(Arena *a) {
+    size_t size = strlen(extra);
+    for (size_t len = 0; len < size; len++) {
+        JSONError parsed, error;
+        Order o;
+        json_parse_buffer(a, extra, len, &parsed);
+        json_decode(a, &order_struct, extra, len, &o, &error);
+        if (error.code == JSON_ERROR_NONE || error.code != parsed.code) {
+            printf("cut at byte %zu: error %d, not %d\n", len, error.code,
+                   parsed.code);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(void) {
+    JSONError error;
+    if (json_struct_init(&order_struct, &error)) {
+        printf("bind: descriptor refused\n");
+        return 1;
+    }
+
+    Arena a = {0};
+    int failed = test_decode(&a) | test_wrong(&a) | test_cut(&a);
+    arena_free(&a);
+    printf("bind: %s\n", failed ? "FAILED" : "ok");
+    return failed;
+}
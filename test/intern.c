@@ -0,0 +1,156 @@
+/*
+    Interning test: each file, and an object big enough to be indexed, is
+    parsed twice through one pool. Both trees have to match the one
+    json_parse_buffer builds, share their pooled strings, and find every
+    key with json_object_get_interned. A string the pool would take but
+    whose escapes don't decode leaves nothing behind in the arena it was
+    decoded in.
+
+    Usage: ./intern <file>...
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/intern.h"
+#include "../include/object.h"
+#include "../include/tokenizer.h"
+#include "../include/utils.h"
+
+#define MAX_VALUE_LENGTH 64
+// An escape is at most six bytes of input for one of the string
+#define SURELY_POOLED (MAX_VALUE_LENGTH / 6)
+
+// Whether a string was copied out of the pool
+static bool pooled(JSONInternPool *pool, JSONString string) {
+    JSONString found = json_intern(pool, string.data, string.length);
+    return found.data == string.data;
+}
+
+// Walks two trees parsed from the same input through pool side by side:
+// keys and short strings are the same pooled copies, and every key is
+// found by its pooled string
+static int check_shared(Arena *a, JSONInternPool *pool, JSONElement first,
+                        JSONElement second) {
+    if (first.type == JSON_ELEMENT_OBJECT) {
+        JSONObject *object = second.element.object;
+        JSONPair *other = object->head;
+        for_each_pair(first.element.object, pair) {
+            if (pair->key.data != other->key.data ||
+                !pooled(pool, pair->key) ||
+                json_object_get_interned(a, object, pair->key) !=
+                    json_object_get_n(a, object, pair->key.data,
+                                      pair->key.length) ||
+                check_shared(a, pool, pair->value, other->value)) {
+                printf("%s: key not pooled\n", pair->key.data);
+                return 1;
+            }
+            other = other->next;
+        }
+    } else if (first.type == JSON_ELEMENT_ARRAY) {
+        JSONArrayElement *other = second.element.array->head;
+        for_each_element(first.element.array, item) {
+            if (check_shared(a, pool, item->element, other->element)) {
+                return 1;
+            }
+            other = other->next;
+        }
+    } else if (first.element.value.type == JSON_VALUE_STRING) {
+        JSONString string = first.element.value.value.string;
+        if (string.length <= SURELY_POOLED &&
+            (string.data != second.element.value.value.string.data ||
+             !pooled(pool, string))) {
+            printf("%s: value not pooled\n", string.data);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int test_document(const char *name, const char *buf, size_t len) {
+    Arena a = {0};
+    JSONInternPool pool;
+    json_intern_init(&pool, MAX_VALUE_LENGTH);
+
+    JSONError error;
+    char *want = json_stringify(&a, json_parse_buffer(&a, buf, len, &error));
+    JSONElement first = json_parse_interned(&a, &pool, buf, len, &error);
+    size_t count = pool.count;
+    JSONElement second = json_parse_interned(&a, &pool, buf, len, &error);
+
+    int failed = 0;
+    char *got = json_stringify(&a, first);
+    char *again = json_stringify(&a, second);
+    if (want == NULL || got == NULL || again == NULL ||
+        strcmp(want, got) != 0 || strcmp(want, again) != 0) {
+        printf("%s: differs from json_parse_buffer\n", name);
+        failed = 1;
+    } else if (pool.count != count ||
+               check_shared(&a, &pool, first, second) ||
+               pool.count != count) {
+        printf("%s: strings not shared through the pool\n", name);
+        failed = 1;
+    }
+
+    json_intern_free(&pool);
+    arena_free(&a);
+    return failed;
+}
+
+static int test_indexed(void) {
+    char buf[2048];
+    size_t n = 0;
+    buf[n++] = '{';
+    for (int i = 0; i < 40; i++) {
+        n += sprintf(buf + n, "%s\"key%d\": \"v%d\"", i ? ", " : "", i % 35,
+                     i);
+    }
+    buf[n++] = '}';
+    return test_document("indexed", buf, n);
+}
+
+static int test_bad_escape(void) {
+    const char *strings[] = {"\"a\\x\"", "\"\\u12\"", "\"ab\\ud83d\\u1\""};
+    Arena a = {0};
+    JSONInternPool pool;
+    json_intern_init(&pool, 16);
+
+    int failed = 0;
+    for (size_t i = 0; i < sizeof(strings) / sizeof(strings[0]); i++) {
+        JSONTokenizer t;
+        json_tokenizer_init(&t, strings[i], strlen(strings[i]));
+        t.intern = &pool;
+
+        size_t used = a.used;
+        if (json_tokenize_string(&a, &t) == 0 || a.used != used) {
+            printf("%s: %zu bytes left in the arena\n", strings[i],
+                   a.used - used);
+            failed = 1;
+        }
+    }
+
+    json_intern_free(&pool);
+    arena_free(&a);
+    return failed;
+}
+
+static int test_file(const char *file_name) {
+    FileContent file;
+    if (map_file_content(file_name, &file)) {
+        printf("%s: failed to read\n", file_name);
+        return 1;
+    }
+    int failed = test_document(file_name, file.data, file.size);
+    unmap_file_content(&file);
+    return failed;
+}
+
+int main(int argc, char *argv[]) {
+    int failed = test_bad_escape() | test_indexed();
+    for (int i = 1; i < argc; i++) {
+        failed |= test_file(argv[i]);
+    }
+    printf("intern: %s\n", failed ? "FAILED" : "ok");
+    return failed;
+}
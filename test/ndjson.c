@@ -0,0 +1,174 @@
+/*
+    NDJSON test: each file is written on one line and repeated, with blank
+    lines in between, across several chunks. Every record has to be the
+    tree json_parse_buffer gives for the line, in input order. With one
+    broken line, the first failed record has to be on that line with the
+    error json_parse_buffer gives for it.
+
+    Usage: ./ndjson <file>...
+*/
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/ndjson.h"
+#include "../include/utils.h"
+
+#define THREADS 4
+#define SIZE (JSON_NDJSON_CHUNK_SIZE * 5 / 2)
+
+// Lines of line with a blank one after every third, and broken in place of
+// the record in the middle unless it's NULL. Returns the buffer, the number
+// of records in it and the line broken is on.
+static char *lines(const char *line, const char *broken, size_t *size,
+                   size_t *records, size_t *broken_line) {
+    size_t length = strlen(line);
+    size_t count = SIZE / (length + 1) + 1;
+    char *buf = malloc(count * (length + 3) +
+                       (broken != NULL ? strlen(broken) : 0) + 1);
+    if (buf == NULL) return NULL;
+
+    size_t n = 0;
+    size_t number = 0;
+    *records = 0;
+    for (size_t i = 0; i < count; i++) {
+        const char *copy = line;
+        ++number;
+        if (broken != NULL && i == count / 2) {
+            copy = broken;
+            *broken_line = number;
+        }
+        n += sprintf(buf + n, "%s\n", copy);
+        ++*records;
+        if (i % 3 == 2) {
+            n += sprintf(buf + n, " \r\n");
+            ++number;
+        }
+    }
+    *size = n;
+    return buf;
+}
+
+static size_t line_of(const char *buf, size_t offset) {
+    size_t line = 1;
+    for (size_t i = 0; i < offset; i++) {
+        line += buf[i] == '\n';
+    }
+    return line;
+}
+
+static int test_valid(Arena *a, const char *name, const char *line) {
+    size_t size, expected;
+    char *buf = lines(line, NULL, &size, &expected, NULL);
+    if (buf == NULL) return 1;
+
+    JSONError error;
+    char *want = json_stringify(
+        a, json_parse_buffer(a, line, strlen(line), &error));
+
+    size_t count;
+    int failed;
+    JSONRecord *records =
+        json_parse_ndjson(a, buf, size, THREADS, &count, &failed);
+    if (failed || records == NULL || count != expected) {
+        printf("%s: %zu records, not %zu\n", name, count, expected);
+        failed = 1;
+    }
+
+    for (size_t i = 0; i < count && !failed; i++) {
+        char *got = json_stringify(a, records[i].root);
+        if (got == NULL || strcmp(got, want) != 0 ||
+            (i > 0 && records[i].offset <= records[i - 1].offset) ||
+            strncmp(buf + records[i].offset, line, strlen(line)) != 0) {
+            printf("%s: record %zu differs\n", name, i);
+            failed = 1;
+        }
+    }
+    free(buf);
+    return failed;
+}
+
+static int count_record(void *context, const JSONRecord *record, Arena *a) {
+    (void)record;
+    (void)a;
+    atomic_fetch_add((atomic_size_t *)context, 1);
+    return 0;
+}
+
+static int test_broken(Arena *a, const char *name, const char *line) {
+    const char *broken = "{\"a\": [1, 2}";
+    size_t size, expected;
+    size_t broken_line;
+    char *buf = lines(line, broken, &size, &expected, &broken_line);
+    if (buf == NULL) return 1;
+
+    JSONError want;
+    json_parse_buffer(a, broken, strlen(broken), &want);
+
+    size_t count;
+    int error;
+    JSONRecord *records =
+        json_parse_ndjson(a, buf, size, THREADS, &count, &error);
+    int failed = 0;
+    if (!error || records == NULL || count != expected) {
+        printf("%s: broken line not reported\n", name);
+        failed = 1;
+    }
+
+    size_t i = 0;
+    while (i < count && records[i].error.code == JSON_ERROR_NONE) ++i;
+    if (!failed &&
+        (i == count || line_of(buf, records[i].offset) != broken_line ||
+         records[i].error.code != want.code ||
+         records[i].error.offset != want.offset ||
+         records[i].error.col != want.col)) {
+        printf("%s: first error not on line %zu\n", name, broken_line);
+        failed = 1;
+    }
+
+    atomic_size_t streamed = 0;
+    if (!json_parse_ndjson_each(buf, size, THREADS, count_record,
+                                &streamed) ||
+        atomic_load(&streamed) != expected) {
+        printf("%s: %zu records streamed, not %zu\n", name,
+               atomic_load(&streamed), expected);
+        failed = 1;
+    }
+    free(buf);
+    return failed;
+}
+
+static int test_file(const char *file_name) {
+    FileContent file;
+    if (map_file_content(file_name, &file)) {
+        printf("%s: failed to read\n", file_name);
+        return 1;
+    }
+
+    Arena a = {0};
+    JSONError error;
+    JSONElement root = json_parse_buffer(&a, file.data, file.size, &error);
+    char *line = error.code ? NULL : json_stringify(&a, root);
+    int failed = line == NULL || strchr(line, '\n') != NULL;
+    if (failed) {
+        printf("%s: failed to write on one line\n", file_name);
+    } else {
+        failed = test_valid(&a, file_name, line) ||
+                 test_broken(&a, file_name, line);
+    }
+
+    arena_free(&a);
+    unmap_file_content(&file);
+    return failed;
+}
+
+int main(int argc, char *argv[]) {
+    int failed = 0;
+    for (int i = 1; i < argc; i++) {
+        failed |= test_file(argv[i]);
+    }
+    printf("ndjson: %s\n", failed ? "FAILED" : "ok");
+    return failed;
+}
@@ -0,0 +1,149 @@
+/*
+    Object lookup test: every key of every object in the tree
+    json_parse_buffer builds, and a few keys that aren't there, are looked
+    up with json_object_get and have to find the first pair with that key.
+    Objects of 16 keys or more are checked before their index is built and
+    again after, smaller ones must never get one.
+
+    Usage: ./object <file>...
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/object.h"
+#include "../include/utils.h"
+
+// What a lookup has to find, by a linear scan
+static JSONElement *first_pair(JSONObject *object, JSONString key) {
+    for_each_pair(object, pair) {
+        if (pair->key.length == key.length &&
+            memcmp(pair->key.data, key.data, key.length) == 0) {
+            return &pair->value;
+        }
+    }
+    return NULL;
+}
+
+static int check_object(Arena *a, JSONObject *object) {
+    static const JSONString missing[] = {
+        {"", 0}, {"missing", 7}, {"k1x", 3}, {"\0", 1},
+    };
+
+    int failed = 0;
+    bool indexed = object->count >= JSON_OBJECT_INDEX_THRESHOLD;
+    for (int round = 0; round < 2; round++) {
+        for_each_pair(object, pair) {
+            JSONElement *found =
+                json_object_get_n(a, object, pair->key.data, pair->key.length);
+            if (found != first_pair(object, pair->key)) {
+                printf("%.*s: found the wrong pair with%s an index\n",
+                       (int)pair->key.length, pair->key.data,
+                       round ? "" : "out");
+                failed = 1;
+            }
+        }
+        for (size_t i = 0; i < sizeof(missing) / sizeof(missing[0]); i++) {
+            if (json_object_get_n(a, object, missing[i].data,
+                                  missing[i].length) !=
+                first_pair(object, missing[i])) {
+                printf("%s: wrong result for a missing key\n",
+                       missing[i].data);
+                failed = 1;
+            }
+        }
+        if ((object->index != NULL) != indexed) {
+            printf("object of %zu keys %s an index\n", object->count,
+                   indexed ? "without" : "with");
+            failed = 1;
+        }
+    }
+    return failed;
+}
+
+static int check_element(Arena *a, JSONElement element) {
+    int failed = 0;
+    if (element.type == JSON_ELEMENT_OBJECT) {
+        JSONObject *object = element.element.object;
+        if (object->count >= JSON_OBJECT_INDEX_THRESHOLD &&
+            object->index != NULL) {
+            printf("object indexed before its first lookup\n");
+            failed = 1;
+        }
+        failed |= check_object(a, object);
+        for_each_pair(object, pair) {
+            failed |= check_element(a, pair->value);
+        }
+    } else if (element.type == JSON_ELEMENT_ARRAY) {
+        for_each_element(element.element.array, item) {
+            failed |= check_element(a, item->element);
+        }
+    }
+    return failed;
+}
+
+// Objects around the threshold, with duplicate, escaped and empty keys
+static int test_sizes(Arena *a) {
+    const size_t sizes[] = {0, 1, 15, 16, 17, 100, 1000};
+    char *buf = malloc(64 * 1000 + 64);
+    if (buf == NULL) return 1;
+
+    int failed = 0;
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t n = 0;
+        buf[n++] = '{';
+        for (size_t i = 0; i < sizes[s]; i++) {
+            if (i > 0) buf[n++] = ',';
+            if (i == 3) {
+                n += sprintf(buf + n, "\"\": %zu", i);
+            } else if (i == 5) {
+                n += sprintf(buf + n, "\"k\\u0031\": %zu", i);
+            } else {
+                n += sprintf(buf + n, "\"k%zu\": %zu", i % 40, i);
+            }
+        }
+        buf[n++] = '}';
+
+        JSONError error;
+        JSONElement root = json_parse_buffer(a, buf, n, &error);
+        if (error.code) {
+            printf("object of %zu keys: failed to parse\n", sizes[s]);
+            failed = 1;
+        } else {
+            failed |= check_element(a, root);
+        }
+        arena_reset(a);
+    }
+    free(buf);
+    return failed;
+}
+
+static int test_file(Arena *a, const char *file_name) {
+    FileContent file;
+    if (map_file_content(file_name, &file)) {
+        printf("%s: failed to read\n", file_name);
+        return 1;
+    }
+
+    JSONError error;
+    JSONElement root = json_parse_buffer(a, file.data, file.size, &error);
+    int failed = error.code != JSON_ERROR_NONE || check_element(a, root);
+    if (failed) {
+        printf("%s: lookups failed\n", file_name);
+    }
+    arena_reset(a);
+    unmap_file_content(&file);
+    return failed;
+}
+
+int main(int argc, char *argv[]) {
+    Arena a = {0};
+    int failed = test_sizes(&a);
+    for (int i = 1; i < argc; i++) {
+        failed |= test_file(&a, argv[i]);
+    }
+    arena_free(&a);
+    printf("object: %s\n", failed ? "FAILED" : "ok");
+    return failed;
+}
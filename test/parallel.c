@@ -0,0 +1,113 @@
+/*
+    Parallel parse test: documents past JSON_PARALLEL_MIN_SIZE, an array or
+    object of many copies of each file and of strings full of brackets,
+    commas and escaped quotes, have to give the tree json_parse_buffer
+    gives. With one broken item in the middle they have to fail with the
+    same error, found by the serial fallback.
+
+    Usage: ./parallel <file>...
+*/
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/parallel.h"
+#include "../include/utils.h"
+
+#define THREADS 4
+
+// An array or object of copies of item, with broken in place of the one in
+// the middle unless it's NULL, long enough to be parsed in parallel
+static char *repeat(const char *item, const char *broken, bool object,
+                    size_t *size) {
+    size_t length = strlen(item);
+    size_t count = JSON_PARALLEL_MIN_SIZE / (length + 2) + 2;
+    size_t capacity = count * (length + 16) + strlen(broken ? broken : "");
+    char *buf = malloc(capacity + 2);
+    if (buf == NULL) return NULL;
+
+    size_t n = 0;
+    buf[n++] = object ? '{' : '[';
+    for (size_t i = 0; i < count; i++) {
+        if (i > 0) buf[n++] = ',';
+        if (object) n += sprintf(buf + n, "\"k%zu\": ", i);
+        const char *copy = broken != NULL && i == count / 2 ? broken : item;
+        memcpy(buf + n, copy, strlen(copy));
+        n += strlen(copy);
+    }
+    buf[n++] = object ? '}' : ']';
+    *size = n;
+    return buf;
+}
+
+// Parses buf both ways and compares the trees or the errors
+static int compare(const char *name, const char *buf, size_t size) {
+    Arena a = {0};
+    JSONError serial, parallel;
+    JSONElement expected = json_parse_buffer(&a, buf, size, &serial);
+    JSONElement root = json_parse_parallel(&a, buf, size, THREADS, &parallel);
+
+    int failed = 0;
+    if (serial.code != parallel.code || serial.offset != parallel.offset ||
+        serial.line != parallel.line || serial.col != parallel.col) {
+        printf("%s: error %d at %zu, not %d at %zu\n", name, parallel.code,
+               parallel.offset, serial.code, serial.offset);
+        failed = 1;
+    } else if (serial.code == JSON_ERROR_NONE) {
+        char *want = json_stringify(&a, expected);
+        char *got = json_stringify(&a, root);
+        if (want == NULL || got == NULL || strcmp(want, got) != 0) {
+            printf("%s: different tree\n", name);
+            failed = 1;
+        }
+    }
+    arena_free(&a);
+    return failed;
+}
+
+static int test_item(const char *name, const char *item, const char *broken) {
+    int failed = 0;
+    for (int object = 0; object <= 1; object++) {
+        size_t size;
+        char *buf = repeat(item, broken, object, &size);
+        if (buf == NULL) return 1;
+        failed |= compare(name, buf, size);
+        free(buf);
+    }
+    return failed;
+}
+
+static int test_strings(void) {
+    const char *item = "[\"a,]}\\\"[{\", \"\\\\\", {\"}\": \"\\\\\\\"\"}]";
+    return test_item("strings", item, NULL) |
+           test_item("unterminated", item, "[\"a, 1]") |
+           test_item("mismatched", item, "[1, 2}") |
+           test_item("stray comma", item, "[1,]") |
+           test_item("bad literal", item, "[nul]");
+}
+
+static int test_file(const char *file_name) {
+    char *content = read_file_content(file_name);
+    if (content == NULL) {
+        printf("%s: failed to read\n", file_name);
+        return 1;
+    }
+
+    // Small enough to be parsed serially as it is
+    int failed = compare(file_name, content, strlen(content));
+    failed |= test_item(file_name, content, NULL);
+    failed |= test_item(file_name, content, "{\"a\" 1}");
+    free(content);
+    return failed;
+}
+
+int main(int argc, char *argv[]) {
+    int failed = test_strings();
+    for (int i = 1; i < argc; i++) {
+        failed |= test_file(argv[i]);
+    }
+    printf("parallel: %s\n", failed ? "FAILED" : "ok");
+    return failed;
+}
@@ -0,0 +1,153 @@
+/*
+    Push parser test: each file is fed to json_parser_feed split in two at
+    every byte offset, and one byte at a time. Every tree has to stringify
+    the same as the one-shot parse, and a few malformed documents and ones
+    nested right up to the depth limit have to end the same way.
+
+    Usage: ./push <file>...
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../include/push.h"
+#include "../include/utils.h"
+
+static const char *malformed[] = {
+    "[1, 2,",
+    "{\"a\": }",
+    "[\"ab\\x\"]",
+    "{\n  \"a\": 1\n  \"b\": 2\n}",
+    "[\n  tru\n]",
+    "[1, 2]]",
+    "\n\n  [01]",
+    "{\"a\":\n [1, {",
+};
+#define MALFORMED (sizeof(malformed) / sizeof(malformed[0]))
+
+// Feeds buf in chunks of at most chunk bytes, the first one split bytes
+static char *push_parse(Arena *a, const char *buf, size_t len, size_t split,
+                        size_t chunk, JSONError *error) {
+    JSONPushParser p;
+    json_parser_init(&p, a);
+
+    size_t fed = 0;
+    size_t next = split;
+    while (fed < len) {
+        size_t n = next < len - fed ? next : len - fed;
+        if (json_parser_feed(&p, buf + fed, n)) break;
+        fed += n;
+        next = chunk;
+    }
+
+    JSONElement root = json_parser_finish(&p, error);
+    return error->code ? NULL : json_stringify(a, root);
+}
+
+static bool same_error(const JSONError *a, const JSONError *b) {
+    return a->code == b->code && a->offset == b->offset &&
+           a->line == b->line && a->col == b->col;
+}
+
+// Feeds buf split at every byte, then byte by byte, and checks each parse
+// ends the way json_parse_buffer's does. Returns non-zero if one doesn't.
+static int test_failure(Arena *a, const char *buf, size_t len,
+                        const char *name) {
+    JSONError expected;
+    json_parse_buffer(a, buf, len, &expected);
+
+    for (size_t split = 0; split <= len + 1; split++) {
+        JSONError error;
+        size_t first = split <= len ? split : 1;
+        size_t chunk = split <= len ? len : 1;
+        ArenaMark mark = arena_mark(a);
+        push_parse(a, buf, len, first, chunk, &error);
+        arena_rewind(a, mark);
+        if (!same_error(&error, &expected)) {
+            printf("%s: failed at %zu:%zu, not %zu:%zu\n", name, error.line,
+                   error.col, expected.line, expected.col);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int test_malformed(void) {
+    Arena a = {0};
+    int failed = 0;
+    for (size_t i = 0; i < MALFORMED; i++) {
+        failed |= test_failure(&a, malformed[i], strlen(malformed[i]),
+                               malformed[i]);
+    }
+    arena_free(&a);
+    return failed;
+}
+
+// Scalars count towards the depth limit as much as containers do
+static int test_depth(void) {
+    char buf[JSON_MAX_DEPTH * 2 + 2];
+    Arena a = {0};
+    int failed = 0;
+    for (size_t depth = JSON_MAX_DEPTH - 1; depth <= JSON_MAX_DEPTH;
+         depth++) {
+        memset(buf, '[', depth);
+        buf[depth] = '1';
+        memset(buf + depth + 1, ']', depth);
+        size_t len = depth * 2 + 1;
+
+        char name[64];
+        snprintf(name, sizeof(name), "%zu nested arrays", depth);
+        failed |= test_failure(&a, buf, len, name);
+    }
+    arena_free(&a);
+    return failed;
+}
+
+static int test_file(const char *file_name) {
+    FileContent file;
+    if (map_file_content(file_name, &file)) {
+        printf("%s: failed to read\n", file_name);
+        return 1;
+    }
+
+    Arena a = {0};
+    int failed = 0;
+    JSONError error;
+    JSONElement root = json_parse_buffer(&a, file.data, file.size, &error);
+    char *expected = error.code ? NULL : json_stringify(&a, root);
+    if (expected == NULL) {
+        printf("%s: one-shot parse failed\n", file_name);
+        failed = 1;
+    }
+
+    for (size_t split = 0; !failed && split <= file.size; split++) {
+        ArenaMark mark = arena_mark(&a);
+        char *out =
+            push_parse(&a, file.data, file.size, split, file.size, &error);
+        if (out == NULL || strcmp(out, expected) != 0) {
+            printf("%s: differs when split at byte %zu\n", file_name, split);
+            failed = 1;
+        }
+        arena_rewind(&a, mark);
+    }
+
+    char *out =
+        failed ? NULL : push_parse(&a, file.data, file.size, 1, 1, &error);
+    if (!failed && (out == NULL || strcmp(out, expected) != 0)) {
+        printf("%s: differs when fed byte by byte\n", file_name);
+        failed = 1;
+    }
+
+    arena_free(&a);
+    unmap_file_content(&file);
+    return failed;
+}
+
+int main(int argc, char *argv[]) {
+    int failed = test_malformed() | test_depth();
+    for (int i = 1; i < argc; i++) {
+        failed |= test_file(argv[i]);
+    }
+    printf("push: %s\n", failed ? "FAILED" : "ok");
+    return failed;
+}
@@ -0,0 +1,198 @@
+/*
+    Query test: json_query_stream has to find the same matches as running
+    the query over the parsed tree, for every file and a few documents
+    whose matches are escaped strings. Bad paths and documents have to be
+    reported where they go wrong.
+
+    Usage: ./query <file>...
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../include/query.h"
+#include "../include/utils.h"
+
+static const char *file_queries[] = {"$", "$..*", "$.*", ""};
+#define FILE_QUERIES (sizeof(file_queries) / sizeof(file_queries[0]))
+
+typedef struct {
+    const char *json;
+    const char *path;
+    const char *expected;  // The matches stringified, one per line
+} QueryCase;
+
+// Escaped tokens after a match are decoded too, they mustn't overwrite it
+static const QueryCase cases[] = {
+    {"{\"a\": \"ab\\ncd\", \"b\\n\": \"QQQQQ\\n\"}", "$.a",
+     "\"ab\\ncd\"\n"},
+    {"[\"x\\\"y\", 1, \"\\u00e9\\t\", {\"\\u0051\\u0051\": 0}]", "$[*]",
+     "\"x\\\"y\"\n1\n\"\xc3\xa9\\t\"\n{\"QQ\": 0}\n"},
+    {"{\"k\\u0041\": {\"b\": \"\\\\\", \"\\\\c\": 1}}", "/kA/b",
+     "\"\\\\\"\n"},
+    {"\"\\ud83d\\ude00\"", "$", "\"\xf0\x9f\x98\x80\"\n"},
+};
+#define CASES (sizeof(cases) / sizeof(cases[0]))
+
+typedef struct {
+    const char *json;  // NULL to only compile the path
+    const char *path;
+    JSONErrorCode code;
+    size_t offset;  // Into the path, or the document once it's compiled
+} ErrorCase;
+
+static const ErrorCase errors[] = {
+    {NULL, "a", JSON_ERROR_SYNTAX, 0},
+    {NULL, "$.", JSON_ERROR_SYNTAX, 2},
+    {NULL, "$.a[", JSON_ERROR_SYNTAX, 4},
+    {NULL, "/a~2", JSON_ERROR_STRING, 2},
+    {NULL, "$[99999999999999999999]", JSON_ERROR_NUMBER, 2},
+    {"{\"a\": [1, \"x", "$.a", JSON_ERROR_STRING, 10},
+    {"{\"b\": [1, \"x", "$.a", JSON_ERROR_STRING, 10},
+    {"{\"a\": 1 \"b\": 2}", "$.b", JSON_ERROR_SYNTAX, 8},
+    {"[1, 2", "$[5]", JSON_ERROR_SYNTAX, 5},
+    // Values that aren't selected still have to be there
+    {"[1,]", "$[0]", JSON_ERROR_SYNTAX, 3},
+    {"{\"x\": ,\"a\": 1}", "$.a", JSON_ERROR_SYNTAX, 6},
+    {"{\"x\": }", "$.a", JSON_ERROR_SYNTAX, 6},
+    {"{\"x\": ", "$.a", JSON_ERROR_SYNTAX, 6},
+    {"[[1], ]", "$[0]", JSON_ERROR_SYNTAX, 6},
+};
+#define ERRORS (sizeof(errors) / sizeof(errors[0]))
+
+// Matches are kept and only written out once the query is done
+typedef struct {
+    JSONElement *matches[256];
+    size_t count;
+    char out[1 << 16];
+} Matches;
+
+static int collect(void *context, JSONElement *match) {
+    Matches *m = context;
+    if (m->count == sizeof(m->matches) / sizeof(m->matches[0])) {
+        return 1;
+    }
+    m->matches[m->count++] = match;
+    return 0;
+}
+
+// Writes the matches to m->out one per line, returns non-zero if they
+// don't fit
+static int write_matches(Arena *a, Matches *m) {
+    size_t size = 0;
+    m->out[0] = '\0';
+    for (size_t i = 0; i < m->count; i++) {
+        char *text = json_stringify(a, *m->matches[i]);
+        size_t length = text ? strlen(text) : 0;
+        if (text == NULL || size + length + 1 >= sizeof(m->out)) {
+            return 1;
+        }
+        memcpy(m->out + size, text, length);
+        size += length;
+        m->out[size++] = '\n';
+        m->out[size] = '\0';
+    }
+    return 0;
+}
+
+// Runs path over len bytes of buf both ways, streamed matches go in
+// streamed and the tree's in tree. Returns non-zero on error.
+static int run_query(Arena *a, const char *buf, size_t len, const char *path,
+                     Matches *streamed, Matches *tree) {
+    streamed->count = 0;
+    tree->count = 0;
+
+    JSONError error;
+    JSONQuery *q = json_query_compile(a, path, &error);
+    if (q == NULL) {
+        return 1;
+    }
+    if (json_query_stream(a, q, buf, len, collect, streamed, &error)) {
+        return 1;
+    }
+
+    JSONElement root = json_parse_buffer(a, buf, len, &error);
+    if (error.code) {
+        return 1;
+    }
+    json_query_each(q, &root, collect, tree);
+    return write_matches(a, streamed) || write_matches(a, tree);
+}
+
+static int test_cases(Arena *a, Matches *streamed, Matches *tree) {
+    int failed = 0;
+    for (size_t i = 0; i < CASES; i++) {
+        const QueryCase *c = &cases[i];
+        if (run_query(a, c->json, strlen(c->json), c->path, streamed,
+                      tree) ||
+            strcmp(streamed->out, c->expected) != 0 ||
+            strcmp(tree->out, c->expected) != 0) {
+            printf("%s on %s: got %s and %s\n", c->path, c->json,
+                   streamed->out, tree->out);
+            failed = 1;
+        }
+        arena_reset(a);
+    }
+    return failed;
+}
+
+static int ignore(void *context, JSONElement *match) {
+    (void)context;
+    (void)match;
+    return 0;
+}
+
+static int test_errors(Arena *a) {
+    int failed = 0;
+    for (size_t i = 0; i < ERRORS; i++) {
+        const ErrorCase *c = &errors[i];
+        JSONError error;
+        JSONQuery *q = json_query_compile(a, c->path, &error);
+        if (q != NULL && c->json != NULL) {
+            json_query_stream(a, q, c->json, strlen(c->json), ignore, NULL,
+                              &error);
+        }
+        if (error.code != c->code || error.offset != c->offset) {
+            printf("%s on %s: error %d at %zu\n", c->path,
+                   c->json ? c->json : "nothing", error.code, error.offset);
+            failed = 1;
+        }
+        arena_reset(a);
+    }
+    return failed;
+}
+
+static int test_file(Arena *a, const char *file_name, Matches *streamed,
+                     Matches *tree) {
+    FileContent file;
+    if (map_file_content(file_name, &file)) {
+        printf("%s: failed to read\n", file_name);
+        return 1;
+    }
+
+    int failed = 0;
+    for (size_t i = 0; i < FILE_QUERIES; i++) {
+        if (run_query(a, file.data, file.size, file_queries[i], streamed,
+                      tree) ||
+            strcmp(streamed->out, tree->out) != 0) {
+            printf("%s: %s streamed differently\n", file_name,
+                   file_queries[i]);
+            failed = 1;
+        }
+        arena_reset(a);
+    }
+    unmap_file_content(&file);
+    return failed;
+}
+
+int main(int argc, char *argv[]) {
+    static Matches streamed, tree;
+    Arena a = {0};
+    int failed = test_cases(&a, &streamed, &tree) | test_errors(&a);
+    for (int i = 1; i < argc; i++) {
+        failed |= test_file(&a, argv[i], &streamed, &tree);
+    }
+    arena_free(&a);
+    printf("query: %s\n", failed ? "FAILED" : "ok");
+    return failed;
+}
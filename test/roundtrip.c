@@ -0,0 +1,118 @@
+/*
+    Round trip test: each file is parsed and stringified, and the output
+    parsed and stringified again, which has to give the same text. A table
+    of escapes checks what they decode to, and the writer has to refuse
+    numbers JSON can't hold.
+
+    Usage: ./roundtrip <file>...
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../include/parser.h"
+#include "../include/utils.h"
+#include "../include/writer.h"
+
+typedef struct {
+    const char *json;
+    const char *decoded;  // NULL if the string must be rejected
+    size_t length;
+} EscapeCase;
+
+static const EscapeCase escapes[] = {
+    {"\"\\\" \\\\ \\/\"", "\" \\ /", 5},
+    {"\"\\b\\f\\n\\r\\t\"", "\b\f\n\r\t", 5},
+    {"\"\\u0041\\u00e9\"", "A\xc3\xa9", 3},
+    {"\"\\u20AC\"", "\xe2\x82\xac", 3},
+    {"\"\\u0000x\"", "\0x", 2},
+    {"\"\\ud83d\\ude00\"", "\xf0\x9f\x98\x80", 4},
+    {"\"\\ud800x\"", "\xef\xbf\xbdx", 4},
+    {"\"\\udc00\\ud800\"", "\xef\xbf\xbd\xef\xbf\xbd", 6},
+    {"\"\\x41\"", NULL, 0},
+    {"\"\\u12\"", NULL, 0},
+    {"\"\\u12g4\"", NULL, 0},
+};
+#define ESCAPES (sizeof(escapes) / sizeof(escapes[0]))
+
+static int test_escapes(void) {
+    Arena a = {0};
+    int failed = 0;
+    for (size_t i = 0; i < ESCAPES; i++) {
+        const EscapeCase *c = &escapes[i];
+        JSONError error;
+        JSONElement root =
+            json_parse_buffer(&a, c->json, strlen(c->json), &error);
+
+        if (c->decoded == NULL) {
+            if (error.code != JSON_ERROR_STRING) {
+                printf("%s: not rejected\n", c->json);
+                failed = 1;
+            }
+            continue;
+        }
+
+        JSONValue *value = &root.element.value;
+        if (error.code || root.type != JSON_ELEMENT_VALUE ||
+            value->type != JSON_VALUE_STRING ||
+            value->value.string.length != c->length ||
+            memcmp(value->value.string.data, c->decoded, c->length) != 0) {
+            printf("%s: decoded wrong\n", c->json);
+            failed = 1;
+        }
+    }
+    arena_free(&a);
+    return failed;
+}
+
+static int test_non_finite(void) {
+    const double values[] = {NAN, INFINITY, -INFINITY};
+    int failed = 0;
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        JSONWriter w = json_writer_buffer(JSON_STYLE_COMPACT);
+        json_write_float(&w, values[i]);
+        if (!w.error) {
+            printf("%f: written\n", values[i]);
+            failed = 1;
+        }
+        json_writer_free(&w);
+    }
+    return failed;
+}
+
+static int test_file(const char *file_name) {
+    FileContent file;
+    if (map_file_content(file_name, &file)) {
+        printf("%s: failed to read\n", file_name);
+        return 1;
+    }
+
+    Arena a = {0};
+    JSONError error;
+    JSONElement root = json_parse_buffer(&a, file.data, file.size, &error);
+    char *first = error.code ? NULL : json_stringify(&a, root);
+
+    char *second = NULL;
+    if (first != NULL) {
+        root = json_parse_buffer(&a, first, strlen(first), &error);
+        second = error.code ? NULL : json_stringify(&a, root);
+    }
+
+    int failed = second == NULL || strcmp(first, second) != 0;
+    if (failed) {
+        printf("%s: differs after a round trip\n", file_name);
+    }
+    arena_free(&a);
+    unmap_file_content(&file);
+    return failed;
+}
+
+int main(int argc, char *argv[]) {
+    int failed = test_escapes() | test_non_finite();
+    for (int i = 1; i < argc; i++) {
+        failed |= test_file(argv[i]);
+    }
+    printf("roundtrip: %s\n", failed ? "FAILED" : "ok");
+    return failed;
+}
@@ -0,0 +1,184 @@
+/*
+    Statistics test, for builds with STATS=1: each file is parsed with
+    json_parse_buffer_stats, which has to build the tree json_parse_buffer
+    builds and count exactly the tokens, depth and longest string found by
+    walking that tree. A hook has to see every parse, valid or not, with
+    the error the parse returned, and no more once it is removed.
+
+    Usage: ./stats <file>...
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../include/parser.h"
+#include "../include/stats.h"
+#include "../include/utils.h"
+
+#ifdef JSON_STATS
+
+// What the stats of a parse that built element have to say
+typedef struct {
+    size_t tokens[END + 1];
+    size_t max_depth;
+    size_t largest_string;
+} Counted;
+
+static void count_string(Counted *c, JSONString string) {
+    ++c->tokens[STRING];
+    c->largest_string = MAX(c->largest_string, string.length);
+}
+
+// Every element is a level, scalars included, like the parser's depth
+static void count(Counted *c, JSONElement element, size_t depth) {
+    c->max_depth = MAX(c->max_depth, depth + 1);
+    switch (element.type) {
+        case JSON_ELEMENT_OBJECT: {
+            JSONObject *object = element.element.object;
+            ++c->tokens[LEFT_CURLY];
+            ++c->tokens[RIGHT_CURLY];
+            for_each_pair(object, pair) {
+                count_string(c, pair->key);
+                ++c->tokens[COLON];
+                count(c, pair->value, depth + 1);
+            }
+            c->tokens[COMMA] += object->count > 0 ? object->count - 1 : 0;
+            break;
+        }
+        case JSON_ELEMENT_ARRAY: {
+            size_t n = 0;
+            ++c->tokens[LEFT_SQUARE];
+            ++c->tokens[RIGHT_SQUARE];
+            for_each_element(element.element.array, item) {
+                count(c, item->element, depth + 1);
+                n++;
+            }
+            c->tokens[COMMA] += n > 0 ? n - 1 : 0;
+            break;
+        }
+        case JSON_ELEMENT_VALUE: {
+            JSONValue *value = &element.element.value;
+            switch (value->type) {
+                case JSON_VALUE_STRING:
+                    count_string(c, value->value.string);
+                    break;
+                case JSON_VALUE_NUMBER_INT:
+                    ++c->tokens[NUMBER_INT];
+                    break;
+                case JSON_VALUE_NUMBER_UINT:
+                    ++c->tokens[NUMBER_UINT];
+                    break;
+                case JSON_VALUE_NUMBER_FLOAT:
+                    ++c->tokens[NUMBER_FLOAT];
+                    break;
+                case JSON_VALUE_NUMBER_RAW:
+                    ++c->tokens[NUMBER_RAW];
+                    break;
+                case JSON_VALUE_BOOLEAN:
+                    ++c->tokens[value->value.boolean ? TRUE : FALSE];
+                    break;
+                case JSON_VALUE_NULL:
+                    ++c->tokens[NULL_TOKEN];
+                    break;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static bool matches(const JSONStats *stats, const Counted *c, size_t bytes) {
+    return memcmp(stats->tokens, c->tokens, sizeof(c->tokens)) == 0 &&
+           stats->max_depth == c->max_depth &&
+           stats->largest_string == c->largest_string &&
+           stats->bytes == bytes;
+}
+
+typedef struct {
+    size_t calls;
+    JSONStats stats;
+    JSONError error;
+} Hooked;
+
+static void hook(void *context, const char *source, const JSONStats *stats,
+                 const JSONError *error) {
+    (void)source;
+    Hooked *h = context;
+    h->calls++;
+    h->stats = *stats;
+    h->error = *error;
+}
+
+static int test_file(Arena *a, const char *file_name) {
+    FileContent file;
+    if (map_file_content(file_name, &file)) {
+        printf("%s: failed to read\n", file_name);
+        return 1;
+    }
+
+    JSONError error;
+    JSONStats stats;
+    JSONElement root = json_parse_buffer(a, file.data, file.size, &error);
+    char *want = error.code ? NULL : json_stringify(a, root);
+    root = json_parse_buffer_stats(a, file.data, file.size, &stats, &error);
+    char *got = error.code ? NULL : json_stringify(a, root);
+
+    int failed = 0;
+    Counted counted = {.tokens[END] = 1};
+    count(&counted, root, 0);
+    if (want == NULL || got == NULL || strcmp(want, got) != 0) {
+        printf("%s: differs from json_parse_buffer\n", file_name);
+        failed = 1;
+    } else if (!matches(&stats, &counted, file.size)) {
+        printf("%s: counted wrong\n", file_name);
+        failed = 1;
+    }
+
+    // The hook sees parses that didn't ask for stats, and failed ones
+    Hooked h = {0};
+    json_stats_hook(hook, &h);
+    json_parse_buffer(a, file.data, file.size, &error);
+    if (h.calls != 1 || h.error.code != JSON_ERROR_NONE ||
+        !matches(&h.stats, &counted, file.size)) {
+        printf("%s: hook not called with the stats\n", file_name);
+        failed = 1;
+    }
+    json_parse_buffer(a, file.data, file.size / 2, &error);
+    if (h.calls != 2 || error.code == JSON_ERROR_NONE ||
+        h.error.code != error.code || h.error.offset != error.offset ||
+        h.stats.bytes != file.size / 2) {
+        printf("%s: hook not called with the error\n", file_name);
+        failed = 1;
+    }
+    json_stats_hook(NULL, NULL);
+    json_parse_buffer(a, file.data, file.size, &error);
+    if (h.calls != 2) {
+        printf("%s: hook called after it was removed\n", file_name);
+        failed = 1;
+    }
+
+    arena_reset(a);
+    unmap_file_content(&file);
+    return failed;
+}
+
+int main(int argc, char *argv[]) {
+    Arena a = {0};
+    int failed = 0;
+    for (int i = 1; i < argc; i++) {
+        failed |= test_file(&a, argv[i]);
+    }
+    arena_free(&a);
+    printf("stats: %s\n", failed ? "FAILED" : "ok");
+    return failed;
+}
+
+#else
+
+int main(void) {
+    printf("stats: skipped, build with STATS=1\n");
+    return 0;
+}
+
+#endif
@@ -0,0 +1,173 @@
+/*
+    Validator test: a table of documents RFC 8259 accepts or rejects, the
+    depth limit, and every file cut short at each byte, which json_validate
+    has to accept or reject the same way json_parse_buffer does.
+
+    Usage: ./validate <file>...
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/utils.h"
+#include "../include/validate.h"
+
+typedef struct {
+    const char *json;
+    JSONErrorCode code;  // JSON_ERROR_NONE if it's valid
+    size_t offset;
+} ValidateCase;
+
+static const ValidateCase cases[] = {
+    {"{\"a\": [1, {\"b\": null}], \"c\": true}", JSON_ERROR_NONE, 0},
+    {" \t\r\n[ ] ", JSON_ERROR_NONE, 0},
+    {"\"\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80\"", JSON_ERROR_NONE, 0},
+    {"\"\\u00e9 \\ud83d\\ude00 \\/\"", JSON_ERROR_NONE, 0},
+    // Escaped lone surrogates follow the grammar
+    {"\"\\ud800\"", JSON_ERROR_NONE, 0},
+    {"\"\\udc00\\ud800\"", JSON_ERROR_NONE, 0},
+    {"[0, -0, 10, 1.5, -1E-2, 1e+10, 0.5e0]", JSON_ERROR_NONE, 0},
+
+    // Overlong, surrogate, past U+10FFFF and truncated UTF-8
+    {"\"\xc0\xaf\"", JSON_ERROR_STRING, 1},
+    {"\"\xe0\x80\xaf\"", JSON_ERROR_STRING, 1},
+    {"\"\xf0\x80\x80\xaf\"", JSON_ERROR_STRING, 1},
+    {"\"\xed\xa0\x80\"", JSON_ERROR_STRING, 1},
+    {"\"\xf4\x90\x80\x80\"", JSON_ERROR_STRING, 1},
+    {"\"\xc3\"", JSON_ERROR_STRING, 1},
+    {"\"ab\xe2\x82\"", JSON_ERROR_STRING, 5},
+    {"\"\xf0\x9f\x98", JSON_ERROR_STRING, 1},
+    {"\"\x80\"", JSON_ERROR_STRING, 1},
+
+    // Bad escapes, also after a lone surrogate
+    {"\"\\x41\"", JSON_ERROR_STRING, 1},
+    {"\"\\'\"", JSON_ERROR_STRING, 1},
+    {"\"\\u12\"", JSON_ERROR_STRING, 1},
+    {"\"\\ud83d\\u12\"", JSON_ERROR_STRING, 7},
+    {"\"ab\\", JSON_ERROR_STRING, 3},
+
+    // Raw control characters
+    {"\"a\tb\"", JSON_ERROR_STRING, 2},
+    {"\"a\nb\"", JSON_ERROR_STRING, 2},
+    {"[\"\x01\"]", JSON_ERROR_STRING, 2},
+
+    // The number grammar
+    {"01", JSON_ERROR_NUMBER, 0},
+    {"[-01]", JSON_ERROR_NUMBER, 1},
+    {"1.", JSON_ERROR_NUMBER, 0},
+    {"[1.]", JSON_ERROR_NUMBER, 1},
+    {".5", JSON_ERROR_LITERAL, 0},
+    {"-", JSON_ERROR_NUMBER, 0},
+    {"1e", JSON_ERROR_NUMBER, 0},
+    {"1e+", JSON_ERROR_NUMBER, 0},
+    {"+1", JSON_ERROR_LITERAL, 0},
+
+    // Single quotes, which json_lex takes
+    {"'a'", JSON_ERROR_LITERAL, 0},
+    {"{'a': 1}", JSON_ERROR_LITERAL, 1},
+
+    // Trailing and missing commas
+    {"[1,]", JSON_ERROR_SYNTAX, 3},
+    {"{\"a\": 1,}", JSON_ERROR_SYNTAX, 8},
+    {"[,]", JSON_ERROR_SYNTAX, 1},
+    {"[1,,2]", JSON_ERROR_SYNTAX, 3},
+    {"[1 2]", JSON_ERROR_SYNTAX, 3},
+
+    {"", JSON_ERROR_SYNTAX, 0},
+    {"[1] [2]", JSON_ERROR_SYNTAX, 4},
+    {"{\"a\" 1}", JSON_ERROR_SYNTAX, 5},
+    {"{1: 2}", JSON_ERROR_SYNTAX, 1},
+    {"[1}", JSON_ERROR_SYNTAX, 2},
+    {"nul", JSON_ERROR_LITERAL, 0},
+    {"truex", JSON_ERROR_LITERAL, 4},
+};
+#define CASES (sizeof(cases) / sizeof(cases[0]))
+
+static int test_cases(void) {
+    int failed = 0;
+    for (size_t i = 0; i < CASES; i++) {
+        const ValidateCase *c = &cases[i];
+        JSONError error;
+        json_validate(c->json, strlen(c->json), &error);
+        if (error.code != c->code || error.offset != c->offset) {
+            printf("%s: error %d at %zu, not %d at %zu\n", c->json,
+                   error.code, error.offset, c->code, c->offset);
+            failed = 1;
+        }
+    }
+    return failed;
+}
+
+// A number inside depth arrays
+static char *nested(size_t depth) {
+    char *buf = malloc(depth * 2 + 2);
+    if (buf == NULL) return NULL;
+    memset(buf, '[', depth);
+    buf[depth] = '1';
+    memset(buf + depth + 1, ']', depth);
+    buf[depth * 2 + 1] = '\0';
+    return buf;
+}
+
+static int test_depth(void) {
+    char *deepest = nested(JSON_MAX_DEPTH);
+    char *deeper = nested(JSON_MAX_DEPTH + 1);
+    if (deepest == NULL || deeper == NULL) {
+        free(deepest);
+        free(deeper);
+        return 1;
+    }
+
+    JSONError valid, invalid, tighter;
+    json_validate(deepest, strlen(deepest), &valid);
+    json_validate(deeper, strlen(deeper), &invalid);
+    json_validate_depth("[[[1]]]", 7, 2, &tighter);
+    free(deepest);
+    free(deeper);
+
+    if (valid.code != JSON_ERROR_NONE ||
+        invalid.code != JSON_ERROR_DEPTH ||
+        invalid.offset != JSON_MAX_DEPTH ||
+        tighter.code != JSON_ERROR_DEPTH || tighter.offset != 2) {
+        printf("depth limit not where it should be\n");
+        return 1;
+    }
+    return 0;
+}
+
+static int test_file(Arena *a, const char *file_name) {
+    char *content = read_file_content(file_name);
+    if (content == NULL) {
+        printf("%s: failed to read\n", file_name);
+        return 1;
+    }
+
+    int failed = 0;
+    size_t size = strlen(content);
+    for (size_t len = 0; len <= size && !failed; len++) {
+        JSONError validated, parsed;
+        json_validate(content, len, &validated);
+        json_parse_buffer(a, content, len, &parsed);
+        arena_reset(a);
+        if (validated.code != parsed.code) {
+            printf("%s: cut at byte %zu, validated with error %d but "
+                   "parsed with %d\n",
+                   file_name, len, validated.code, parsed.code);
+            failed = 1;
+        }
+    }
+    free(content);
+    return failed;
+}
+
+int main(int argc, char *argv[]) {
+    int failed = test_cases() | test_depth();
+    Arena a = {0};
+    for (int i = 1; i < argc; i++) {
+        failed |= test_file(&a, argv[i]);
+    }
+    arena_free(&a);
+    printf("validate: %s\n", failed ? "FAILED" : "ok");
+    return failed;
+}